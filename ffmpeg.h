@@ -352,6 +352,9 @@ typedef struct InputFile {
     int non_blocking;           /* reading packets from the thread should not block */
     int joined;                 /* the thread has been joined */
     int thread_queue_size;      /* maximum number of queued packets */
+    /* >> vgtmpeg */
+    struct NLPacketQueue *in_pkt_queue; /* replaces in_thread_queue in vgtmpeg */
+    /* << vgtmpeg */
 #endif
 } InputFile;
 
@@ -461,6 +464,7 @@ typedef struct OutputFile {
 	/* >> vgtmpeg */
     int wrote_header; /* flag indicated that the header was already written.  --vgtmpeg */
     int wrote_trailer; /* flag indicating that trailer was written */
+    struct NLMuxThread *mux_thread; /* writes the packets when muxing asynchronously */
 	/* << vgtmpeg */
 
     int shortest;
@@ -27,6 +27,10 @@ int output_xml = 0;
 int server_mode = 0;
 int banner = 1;
 int default_program_id = -1;
+int analyze_samples = 0;
+int parallel_segments = 0;
+const char *program_path = NULL;
+int mux_queue_size = 0;
 /* << vgtmpeg */
 
 #include "cmdutils.h"
@@ -821,6 +825,7 @@ static int parse_input_file(OptionsContext *o, const char *filename)
     char *subtitle_codec_name = NULL;
     char *    data_codec_name = NULL;
     int scan_all_pmts_set = 0;
+    AVDictionary *analyze_opts = NULL;
 
     if (o->format) {
         if (!(file_iformat = av_find_input_format(o->format))) {
@@ -904,6 +909,11 @@ static int parse_input_file(OptionsContext *o, const char *filename)
         av_dict_set(&o->g->format_opts, "scan_all_pmts", "1", AV_DICT_DONT_OVERWRITE);
         scan_all_pmts_set = 1;
     }
+    /* --vgtmpeg */
+    if( analyze_samples > 0 )
+        av_dict_copy(&analyze_opts, o->g->format_opts, 0);
+    /* --vgtmpeg */
+
     /* open the input file with generic avformat function */
     err = avformat_open_input(&ic, filename, file_iformat, &o->g->format_opts);
     if (err < 0) {
@@ -957,6 +967,9 @@ static int parse_input_file(OptionsContext *o, const char *filename)
   	/* --vgtmpeg */
     if( output_xml )
         dump_nlformat(ic, nb_input_files, filename, 0);
+    if( analyze_samples > 0 )
+        nl_analyze_input(filename, ic->iformat, analyze_opts, nb_input_files, analyze_samples);
+    av_dict_free(&analyze_opts);
 	/* --vgtmpeg */
 
     GROW_ARRAY(input_files, nb_input_files);
@@ -2860,6 +2873,23 @@ int ffmpeg_parse_options(int argc, char **argv)
         goto fail;
     }
 
+    /* --vgtmpeg */
+    if (parallel_segments > 1) {
+        if (octx.groups[GROUP_OUTFILE].nb_groups == 1)
+            assert_file_overwrite(octx.groups[GROUP_OUTFILE].groups[0].arg);
+        ret = nl_parallel_segments(&octx.groups[GROUP_INFILE], &octx.groups[GROUP_OUTFILE],
+                                   argc, argv, parallel_segments);
+        if (ret != AVERROR(ENOSYS)) {
+            if (ret < 0)
+                av_log(NULL, AV_LOG_FATAL, "Error encoding in segments: ");
+            goto fail;
+        }
+        /* run as a single encode */
+        parallel_segments = 0;
+        ret = 0;
+    }
+    /* --vgtmpeg */
+
     /* open input files */
     ret = open_files(&octx.groups[GROUP_INFILE], "input", open_input_file);
     if (ret < 0) {
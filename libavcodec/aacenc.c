@@ -512,15 +512,158 @@ static void copy_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+typedef struct ThreadData {
+    FFPsyWindowInfo *windows;
+    int have_lookahead;
+} ThreadData;
+
+/**
+ * Find the channel element a channel belongs to and its index inside it.
+ */
+static void get_channel_element(const AACEncContext *s, int channel,
+                                int *el, int *el_start_ch)
+{
+    int i, start_ch = 0;
+
+    for (i = 0; i < s->chan_map[0]; i++) {
+        int chans = s->chan_map[i+1] == TYPE_CPE ? 2 : 1;
+        if (channel < start_ch + chans)
+            break;
+        start_ch += chans;
+    }
+    *el          = i;
+    *el_start_ch = start_ch;
+}
+
+/**
+ * Return the context the quantizer search should use in a given thread.
+ * The copies only differ from the main context in their scratch buffers.
+ */
+static AACEncContext *get_thread_context(AACEncContext *s, int threadnr)
+{
+    AACEncContext *ts;
+
+    if (!s->thread_context)
+        return s;
+    ts = s->thread_context[threadnr];
+    memcpy(ts, s, offsetof(AACEncContext, qcoefs));
+    return ts;
+}
+
+static int window_and_mdct_thread(AVCodecContext *avctx, void *arg,
+                                  int channel, int threadnr)
+{
+    AACEncContext *s = avctx->priv_data;
+    ThreadData *td   = arg;
+    FFPsyWindowInfo *wi = &td->windows[channel];
+    float *overlap   = &s->planar_samples[channel][0];
+    float *samples2  = overlap + 1024;
+    float *la        = td->have_lookahead ? samples2 + (448+64) : NULL;
+    int el, start_ch, w;
+    SingleChannelElement *sce;
+    IndividualChannelStream *ics;
+    int tag;
+
+    get_channel_element(s, channel, &el, &start_ch);
+    tag = s->chan_map[el+1];
+    sce = &s->cpe[el].ch[channel - start_ch];
+    ics = &sce->ics;
+
+    if (tag == TYPE_LFE) {
+        wi->window_type[0] = ONLY_LONG_SEQUENCE;
+        wi->window_shape   = 0;
+        wi->num_windows    = 1;
+        wi->grouping[0]    = 1;
+
+        /* Only the lowest 12 coefficients are used in a LFE channel.
+         * The expression below results in only the bottom 8 coefficients
+         * being used for 11.025kHz to 16kHz sample rates.
+         */
+        ics->num_swb = s->samplerate_index >= 8 ? 1 : 3;
+    } else {
+        *wi = s->psy.model->window(&s->psy, samples2, la, channel,
+                                   ics->window_sequence[0]);
+    }
+    ics->window_sequence[1] = ics->window_sequence[0];
+    ics->window_sequence[0] = wi->window_type[0];
+    ics->use_kb_window[1]   = ics->use_kb_window[0];
+    ics->use_kb_window[0]   = wi->window_shape;
+    ics->num_windows        = wi->num_windows;
+    ics->swb_sizes          = s->psy.bands    [ics->num_windows == 8];
+    ics->num_swb            = tag == TYPE_LFE ? ics->num_swb : s->psy.num_bands[ics->num_windows == 8];
+    for (w = 0; w < ics->num_windows; w++)
+        ics->group_len[w] = wi->grouping[w];
+
+    apply_window_and_mdct(s, sce, overlap);
+    return 0;
+}
+
+static int search_quantizers_thread(AVCodecContext *avctx, void *arg,
+                                    int channel, int threadnr)
+{
+    AACEncContext *s  = avctx->priv_data;
+    AACEncContext *ts = get_thread_context(s, threadnr);
+    int el, start_ch;
+
+    get_channel_element(s, channel, &el, &start_ch);
+    ts->cur_channel = channel;
+    s->coder->search_for_quantizers(avctx, ts, &s->cpe[el].ch[channel - start_ch],
+                                    s->lambda);
+    return 0;
+}
+
+static int stereo_decision_thread(AVCodecContext *avctx, void *arg,
+                                  int el, int threadnr)
+{
+    AACEncContext *s  = avctx->priv_data;
+    ThreadData *td    = arg;
+    ChannelElement *cpe = &s->cpe[el];
+    int chans = s->chan_map[el+1] == TYPE_CPE ? 2 : 1;
+    int start_ch = 0, w, g;
+    FFPsyWindowInfo *wi;
+
+    for (g = 0; g < el; g++)
+        start_ch += s->chan_map[g+1] == TYPE_CPE ? 2 : 1;
+    wi = td->windows + start_ch;
+
+    cpe->common_window = 0;
+    if (chans > 1
+        && wi[0].window_type[0] == wi[1].window_type[0]
+        && wi[0].window_shape   == wi[1].window_shape) {
+
+        cpe->common_window = 1;
+        for (w = 0; w < wi[0].num_windows; w++) {
+            if (wi[0].grouping[w] != wi[1].grouping[w]) {
+                cpe->common_window = 0;
+                break;
+            }
+        }
+    }
+    if (s->options.stereo_mode && cpe->common_window) {
+        if (s->options.stereo_mode > 0) {
+            IndividualChannelStream *ics = &cpe->ch[0].ics;
+            for (w = 0; w < ics->num_windows; w += ics->group_len[w])
+                for (g = 0;  g < ics->num_swb; g++)
+                    cpe->ms_mask[w*16+g] = 1;
+        } else if (s->coder->search_for_ms) {
+            AACEncContext *ts = get_thread_context(s, threadnr);
+            ts->cur_channel = start_ch;
+            s->coder->search_for_ms(ts, cpe, s->lambda);
+        }
+    }
+    adjust_frame_information(cpe, chans);
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
     AACEncContext *s = avctx->priv_data;
-    float **samples = s->planar_samples, *samples2, *la, *overlap;
     ChannelElement *cpe;
-    int i, ch, w, g, chans, tag, start_ch, ret, ms_mode = 0;
+    int i, ch, chans, tag, start_ch, ret, ms_mode = 0;
     int chan_el_counter[4];
     FFPsyWindowInfo windows[AAC_MAX_CHANNELS];
+    ThreadData td = { windows, !!frame };
 
     if (s->last_frame == 2)
         return 0;
@@ -538,52 +681,13 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
     if (!avctx->frame_number)
         return 0;
 
-    start_ch = 0;
+    /* window decision and MDCT only depend on the channel's own history */
+    avctx->execute2(avctx, window_and_mdct_thread, &td, NULL, s->channels);
     for (i = 0; i < s->chan_map[0]; i++) {
-        FFPsyWindowInfo* wi = windows + start_ch;
-        tag      = s->chan_map[i+1];
-        chans    = tag == TYPE_CPE ? 2 : 1;
-        cpe      = &s->cpe[i];
-        for (ch = 0; ch < chans; ch++) {
-            IndividualChannelStream *ics = &cpe->ch[ch].ics;
-            int cur_channel = start_ch + ch;
-            overlap  = &samples[cur_channel][0];
-            samples2 = overlap + 1024;
-            la       = samples2 + (448+64);
-            if (!frame)
-                la = NULL;
-            if (tag == TYPE_LFE) {
-                wi[ch].window_type[0] = ONLY_LONG_SEQUENCE;
-                wi[ch].window_shape   = 0;
-                wi[ch].num_windows    = 1;
-                wi[ch].grouping[0]    = 1;
-
-                /* Only the lowest 12 coefficients are used in a LFE channel.
-                 * The expression below results in only the bottom 8 coefficients
-                 * being used for 11.025kHz to 16kHz sample rates.
-                 */
-                ics->num_swb = s->samplerate_index >= 8 ? 1 : 3;
-            } else {
-                wi[ch] = s->psy.model->window(&s->psy, samples2, la, cur_channel,
-                                              ics->window_sequence[0]);
-            }
-            ics->window_sequence[1] = ics->window_sequence[0];
-            ics->window_sequence[0] = wi[ch].window_type[0];
-            ics->use_kb_window[1]   = ics->use_kb_window[0];
-            ics->use_kb_window[0]   = wi[ch].window_shape;
-            ics->num_windows        = wi[ch].num_windows;
-            ics->swb_sizes          = s->psy.bands    [ics->num_windows == 8];
-            ics->num_swb            = tag == TYPE_LFE ? ics->num_swb : s->psy.num_bands[ics->num_windows == 8];
-            for (w = 0; w < ics->num_windows; w++)
-                ics->group_len[w] = wi[ch].grouping[w];
-
-            apply_window_and_mdct(s, &cpe->ch[ch], overlap);
-            if (isnan(cpe->ch->coeffs[0])) {
-                av_log(avctx, AV_LOG_ERROR, "Input contains NaN\n");
-                return AVERROR(EINVAL);
-            }
+        if (isnan(s->cpe[i].ch->coeffs[0])) {
+            av_log(avctx, AV_LOG_ERROR, "Input contains NaN\n");
+            return AVERROR(EINVAL);
         }
-        start_ch += chans;
     }
     if ((ret = ff_alloc_packet2(avctx, avpkt, 8192 * s->channels)) < 0)
         return ret;
@@ -594,48 +698,31 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 
         if ((avctx->frame_number & 0xFF)==1 && !(avctx->flags & CODEC_FLAG_BITEXACT))
             put_bitstream_info(s, LIBAVCODEC_IDENT);
+
+        /* the psychoacoustic model carries state from one channel element
+         * to the next, so it runs first and serially; the quantizer and M/S
+         * searches only read its per-channel results */
         start_ch = 0;
-        memset(chan_el_counter, 0, sizeof(chan_el_counter));
         for (i = 0; i < s->chan_map[0]; i++) {
-            FFPsyWindowInfo* wi = windows + start_ch;
             const float *coeffs[2];
+            chans    = s->chan_map[i+1] == TYPE_CPE ? 2 : 1;
+            cpe      = &s->cpe[i];
+            for (ch = 0; ch < chans; ch++)
+                coeffs[ch] = cpe->ch[ch].coeffs;
+            s->psy.model->analyze(&s->psy, start_ch, coeffs, windows + start_ch);
+            start_ch += chans;
+        }
+        avctx->execute2(avctx, search_quantizers_thread, &td, NULL, s->channels);
+        avctx->execute2(avctx, stereo_decision_thread, &td, NULL, s->chan_map[0]);
+
+        start_ch = 0;
+        memset(chan_el_counter, 0, sizeof(chan_el_counter));
+        for (i = 0; i < s->chan_map[0]; i++) {
             tag      = s->chan_map[i+1];
             chans    = tag == TYPE_CPE ? 2 : 1;
             cpe      = &s->cpe[i];
             put_bits(&s->pb, 3, tag);
             put_bits(&s->pb, 4, chan_el_counter[tag]++);
-            for (ch = 0; ch < chans; ch++)
-                coeffs[ch] = cpe->ch[ch].coeffs;
-            s->psy.model->analyze(&s->psy, start_ch, coeffs, wi);
-            for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch + ch;
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
-            }
-            cpe->common_window = 0;
-            if (chans > 1
-                && wi[0].window_type[0] == wi[1].window_type[0]
-                && wi[0].window_shape   == wi[1].window_shape) {
-
-                cpe->common_window = 1;
-                for (w = 0; w < wi[0].num_windows; w++) {
-                    if (wi[0].grouping[w] != wi[1].grouping[w]) {
-                        cpe->common_window = 0;
-                        break;
-                    }
-                }
-            }
-            s->cur_channel = start_ch;
-            if (s->options.stereo_mode && cpe->common_window) {
-                if (s->options.stereo_mode > 0) {
-                    IndividualChannelStream *ics = &cpe->ch[0].ics;
-                    for (w = 0; w < ics->num_windows; w += ics->group_len[w])
-                        for (g = 0;  g < ics->num_swb; g++)
-                            cpe->ms_mask[w*16+g] = 1;
-                } else if (s->coder->search_for_ms) {
-                    s->coder->search_for_ms(s, cpe, s->lambda);
-                }
-            }
-            adjust_frame_information(cpe, chans);
             if (chans == 2) {
                 put_bits(&s->pb, 1, cpe->common_window);
                 if (cpe->common_window) {
@@ -695,6 +782,7 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 static av_cold int aac_encode_end(AVCodecContext *avctx)
 {
     AACEncContext *s = avctx->priv_data;
+    int i;
 
     ff_mdct_end(&s->mdct1024);
     ff_mdct_end(&s->mdct128);
@@ -704,6 +792,11 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
     av_freep(&s->buffer.samples);
     av_freep(&s->cpe);
     av_freep(&s->fdsp);
+    if (s->thread_context) {
+        for (i = 0; i < avctx->thread_count; i++)
+            av_freep(&s->thread_context[i]);
+        av_freep(&s->thread_context);
+    }
     ff_af_queue_close(&s->afq);
     return 0;
 }
@@ -716,6 +809,8 @@ static av_cold int dsp_init(AVCodecContext *avctx, AACEncContext *s)
     if (!s->fdsp)
         return AVERROR(ENOMEM);
 
+    ff_aac_dsp_init(s);
+
     // window init
     ff_kbd_window_init(ff_aac_kbd_long_1024, 4.0, 1024);
     ff_kbd_window_init(ff_aac_kbd_short_128, 6.0, 128);
@@ -740,6 +835,13 @@ static av_cold int alloc_buffers(AVCodecContext *avctx, AACEncContext *s)
     for(ch = 0; ch < s->channels; ch++)
         s->planar_samples[ch] = s->buffer.samples + 3 * 1024 * ch;
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        FF_ALLOCZ_ARRAY_OR_GOTO(avctx, s->thread_context, avctx->thread_count,
+                                sizeof(*s->thread_context), alloc_fail);
+        for (ch = 0; ch < avctx->thread_count; ch++)
+            FF_ALLOCZ_OR_GOTO(avctx, s->thread_context[ch], sizeof(AACEncContext), alloc_fail);
+    }
+
     return 0;
 alloc_fail:
     return AVERROR(ENOMEM);
@@ -831,6 +933,7 @@ static const AVOption aacenc_options[] = {
         {"anmr",     "ANMR method",               0, AV_OPT_TYPE_CONST, {.i64 = AAC_CODER_ANMR},    INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
         {"twoloop",  "Two loop searching method", 0, AV_OPT_TYPE_CONST, {.i64 = AAC_CODER_TWOLOOP}, INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
         {"fast",     "Constant quantizer",        0, AV_OPT_TYPE_CONST, {.i64 = AAC_CODER_FAST},    INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
+    {"twoloop_its", "Maximum number of outer loop iterations of the twoloop coder", offsetof(AACEncContext, options.twoloop_its), AV_OPT_TYPE_INT, {.i64 = 10}, 1, 10, AACENC_FLAGS},
     {NULL}
 };
 
@@ -859,7 +962,7 @@ AVCodec ff_aac_encoder = {
     .close          = aac_encode_end,
     .supported_samplerates = mpeg4audio_sample_rates,
     .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY |
-                      CODEC_CAP_EXPERIMENTAL,
+                      CODEC_CAP_EXPERIMENTAL | CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                      AV_SAMPLE_FMT_NONE },
     .priv_class     = &aacenc_class,
@@ -42,6 +42,7 @@ typedef enum AACCoder {
 typedef struct AACEncOptions {
     int stereo_mode;
     int aac_coder;
+    int twoloop_its;
 } AACEncOptions;
 
 struct AACEncContext;
@@ -82,16 +83,27 @@ typedef struct AACEncContext {
     int last_frame;
     float lambda;
     AudioFrameQueue afq;
-    DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
-    DECLARE_ALIGNED(32, float, scoefs)[1024];    ///< scaled coefficients
 
     struct {
         float *samples;
     } buffer;
+
+    struct AACEncContext **thread_context;       ///< per-thread copies used by the quantizer search
+
+    void (*abs_pow34)(float *out, const float *in, const int size);
+    void (*quant_bands)(int *out, const float *in, const float *scaled,
+                        int size, float Q34, int is_signed, int maxval);
+
+    /* per-thread scratch, must stay at the end of the context */
+    DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
+    DECLARE_ALIGNED(32, float, scoefs)[1024];    ///< scaled coefficients
 } AACEncContext;
 
 extern float ff_aac_pow34sf_tab[428];
 
 void ff_aac_coder_init_mips(AACEncContext *c);
 
+void ff_aac_dsp_init(AACEncContext *s);
+void ff_aac_dsp_init_x86(AACEncContext *s);
+
 #endif /* AVCODEC_AACENC_H */
@@ -38,6 +38,7 @@
 #include "avcodec.h"
 #include "me_cmp.h"
 #include "put_bits.h"
+#include "thread.h"
 #include "audiodsp.h"
 #include "ac3dsp.h"
 #include "ac3.h"
@@ -1018,15 +1019,27 @@ static void count_mantissa_bits_update_ch(AC3EncodeContext *s, int ch,
                                           uint16_t mant_cnt[AC3_MAX_BLOCKS][16],
                                           int start, int end)
 {
-    int blk;
+    int blk, i;
+    uint8_t *last_bap = NULL;
+    int last_len = 0;
+    uint16_t ch_cnt[16];
 
     for (blk = 0; blk < s->num_blocks; blk++) {
         AC3Block *block = &s->blocks[blk];
+        int len;
         if (ch == CPL_CH && !block->cpl_in_use)
             continue;
-        s->ac3dsp.update_bap_counts(mant_cnt[blk],
-                                    s->ref_bap[ch][blk] + start,
-                                    FFMIN(end, block->end_freq[ch]) - start);
+        len = FFMIN(end, block->end_freq[ch]) - start;
+        /* blocks reusing exponents share the bap values of the previous
+           block, so their counts only have to be computed once */
+        if (s->ref_bap[ch][blk] != last_bap || len != last_len) {
+            last_bap = s->ref_bap[ch][blk];
+            last_len = len;
+            memset(ch_cnt, 0, sizeof(ch_cnt));
+            s->ac3dsp.update_bap_counts(ch_cnt, last_bap + start, len);
+        }
+        for (i = 0; i < 16; i++)
+            mant_cnt[blk][i] += ch_cnt[i];
     }
 }
 
@@ -2008,15 +2021,12 @@ int ff_ac3_validate_metadata(AC3EncodeContext *s)
 }
 
 
-/**
- * Finalize encoding and free any memory allocated by the encoder.
- *
- * @param avctx  Codec context
+/*
+ * Free the buffers and the MDCT of an encoder context.
  */
-av_cold int ff_ac3_encode_close(AVCodecContext *avctx)
+static av_cold void free_buffers(AC3EncodeContext *s)
 {
     int blk, ch;
-    AC3EncodeContext *s = avctx->priv_data;
 
     av_freep(&s->windowed_samples);
     if (s->planar_samples)
@@ -2035,7 +2045,6 @@ av_cold int ff_ac3_encode_close(AVCodecContext *avctx)
     av_freep(&s->qmant_buffer);
     av_freep(&s->cpl_coord_exp_buffer);
     av_freep(&s->cpl_coord_mant_buffer);
-    av_freep(&s->fdsp);
     for (blk = 0; blk < s->num_blocks; blk++) {
         AC3Block *block = &s->blocks[blk];
         av_freep(&block->mdct_coef);
@@ -2051,6 +2060,31 @@ av_cold int ff_ac3_encode_close(AVCodecContext *avctx)
     }
 
     s->mdct_end(s);
+}
+
+
+/**
+ * Finalize encoding and free any memory allocated by the encoder.
+ *
+ * @param avctx  Codec context
+ */
+av_cold int ff_ac3_encode_close(AVCodecContext *avctx)
+{
+    AC3EncodeContext *s = avctx->priv_data;
+    int i;
+
+    for (i = 0; s->frame_ctx && i < s->options.parallel_frames; i++) {
+        if (s->frame_ctx[i])
+            free_buffers(s->frame_ctx[i]);
+        av_freep(&s->frame_ctx[i]);
+    }
+    for (i = 0; s->frame_pkt && i < s->options.parallel_frames; i++)
+        av_free_packet(&s->frame_pkt[i]);
+    av_freep(&s->frame_ctx);
+    av_freep(&s->frame_pkt);
+
+    free_buffers(s);
+    av_freep(&s->fdsp);
 
     return 0;
 }
@@ -2419,6 +2453,55 @@ alloc_fail:
 }
 
 
+/*
+ * Set up the contexts used to encode several frames in parallel.
+ * Each of them starts as a copy of the main context and gets its own MDCT
+ * and buffers, so this must be done before those of the main context are
+ * initialized.
+ */
+static av_cold int init_frame_contexts(AC3EncodeContext *s)
+{
+    int i, ret;
+
+    if (s->options.parallel_frames <= 1)
+        return 0;
+    if (s->options.allow_per_frame_metadata) {
+        av_log(s->avctx, AV_LOG_WARNING, "per_frame_metadata cannot be used "
+               "with parallel_frames, encoding one frame at a time\n");
+        return 0;
+    }
+
+    s->frame_ctx = av_mallocz_array(s->options.parallel_frames, sizeof(*s->frame_ctx));
+    s->frame_pkt = av_mallocz_array(s->options.parallel_frames, sizeof(*s->frame_pkt));
+    if (!s->frame_ctx || !s->frame_pkt)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->options.parallel_frames; i++) {
+        AC3EncodeContext *fs = av_malloc(sizeof(*fs));
+        if (!fs)
+            return AVERROR(ENOMEM);
+        memcpy(fs, s, sizeof(*fs));
+        fs->frame_ctx   = NULL;
+        fs->frame_pkt   = NULL;
+        s->frame_ctx[i] = fs;
+
+        ret = fs->mdct_init(fs);
+        if (ret)
+            return ret;
+        ret = allocate_buffers(fs);
+        if (ret)
+            return ret;
+
+        /* large enough for the padded frames at 44.1 kHz */
+        ret = av_new_packet(&s->frame_pkt[i], s->frame_size_min + 2);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+
 av_cold int ff_ac3_encode_init(AVCodecContext *avctx)
 {
     AC3EncodeContext *s = avctx->priv_data;
@@ -2473,6 +2556,24 @@ av_cold int ff_ac3_encode_init(AVCodecContext *avctx)
 
     bit_alloc_init(s);
 
+    ff_audiodsp_init(&s->adsp);
+    ff_me_cmp_init(&s->mecc, avctx);
+    ff_ac3dsp_init(&s->ac3dsp, avctx->flags & CODEC_FLAG_BITEXACT);
+
+    ret = init_frame_contexts(s);
+    if (ret)
+        goto init_fail;
+
+    /* the slice threads are only used to encode several frames in parallel,
+     * do not keep them idle for the whole encode */
+    if (HAVE_THREADS && !s->frame_ctx &&
+        (avctx->active_thread_type & FF_THREAD_SLICE)) {
+        ff_thread_free(avctx);
+        avctx->active_thread_type = 0;
+        avctx->execute            = avcodec_default_execute;
+        avctx->execute2           = avcodec_default_execute2;
+    }
+
     ret = s->mdct_init(s);
     if (ret)
         goto init_fail;
@@ -2481,10 +2582,6 @@ av_cold int ff_ac3_encode_init(AVCodecContext *avctx)
     if (ret)
         goto init_fail;
 
-    ff_audiodsp_init(&s->adsp);
-    ff_me_cmp_init(&s->mecc, avctx);
-    ff_ac3dsp_init(&s->ac3dsp, avctx->flags & CODEC_FLAG_BITEXACT);
-
     dprint_options(s);
 
     return 0;
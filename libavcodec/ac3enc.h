@@ -45,6 +45,8 @@
 #define CONFIG_AC3ENC_FLOAT 0
 #endif
 
+#define AC3_MAX_PARALLEL_FRAMES 64
+
 #define OFFSET(param) offsetof(AC3EncodeContext, options.param)
 #define AC3ENC_PARAM (AV_OPT_FLAG_AUDIO_PARAM | AV_OPT_FLAG_ENCODING_PARAM)
 
@@ -125,6 +127,7 @@ typedef struct AC3EncOptions {
     int stereo_rematrixing;
     int channel_coupling;
     int cpl_start;
+    int parallel_frames;
 } AC3EncOptions;
 
 /**
@@ -255,6 +258,13 @@ typedef struct AC3EncodeContext {
     uint8_t *ref_bap     [AC3_MAX_CHANNELS][AC3_MAX_BLOCKS]; ///< bit allocation pointers (bap)
     int ref_bap_set;                                         ///< indicates if ref_bap pointers have been set
 
+    /* parallel frame encoding */
+    struct AC3EncodeContext **frame_ctx;    ///< per-frame contexts, NULL if frames are encoded one at a time
+    AVPacket *frame_pkt;                    ///< packets of the per-frame contexts
+    int nb_queued_frames;                   ///< number of frames waiting in the per-frame contexts
+    int nb_frame_pkts;                      ///< number of packets encoded in the last batch
+    int next_frame_pkt;                     ///< index of the next packet to return
+
     /* fixed vs. float function pointers */
     void (*mdct_end)(struct AC3EncodeContext *s);
     int  (*mdct_init)(struct AC3EncodeContext *s);
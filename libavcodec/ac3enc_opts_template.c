@@ -73,6 +73,7 @@ static const AVOption ac3_options[] = {
     {"auto", "Selected by the Encoder", 0, AV_OPT_TYPE_CONST, {.i64 = AC3ENC_OPT_AUTO }, INT_MIN, INT_MAX, AC3ENC_PARAM, "channel_coupling"},
 {"cpl_start_band", "Coupling Start Band", OFFSET(cpl_start), AV_OPT_TYPE_INT, {.i64 = AC3ENC_OPT_AUTO }, AC3ENC_OPT_AUTO, 15, AC3ENC_PARAM, "cpl_start_band"},
     {"auto", "Selected by the Encoder", 0, AV_OPT_TYPE_CONST, {.i64 = AC3ENC_OPT_AUTO }, INT_MIN, INT_MAX, AC3ENC_PARAM, "cpl_start_band"},
+{"parallel_frames", "Number of Frames Encoded in Parallel", OFFSET(parallel_frames), AV_OPT_TYPE_INT, {.i64 = 1 }, 1, AC3_MAX_PARALLEL_FRAMES, AC3ENC_PARAM},
 {NULL}
 };
 
@@ -388,23 +388,14 @@ static void compute_rematrixing_strategy(AC3EncodeContext *s)
 }
 
 
-int AC3_NAME(encode_frame)(AVCodecContext *avctx, AVPacket *avpkt,
-                           const AVFrame *frame, int *got_packet_ptr)
+/*
+ * Encode the samples in planar_samples up to the quantized mantissas, ready
+ * for ff_ac3_output_frame().
+ */
+static int encode_samples(AC3EncodeContext *s)
 {
-    AC3EncodeContext *s = avctx->priv_data;
     int ret;
 
-    if (s->options.allow_per_frame_metadata) {
-        ret = ff_ac3_validate_metadata(s);
-        if (ret)
-            return ret;
-    }
-
-    if (s->bit_alloc.sr_code == 1 || s->eac3)
-        ff_ac3_adjust_frame_size(s);
-
-    copy_input_samples(s, (SampleType **)frame->extended_data);
-
     apply_mdct(s);
 
     if (s->fixed_point)
@@ -430,7 +421,7 @@ int AC3_NAME(encode_frame)(AVCodecContext *avctx, AVPacket *avpkt,
 
     ret = ff_ac3_compute_bit_allocation(s);
     if (ret) {
-        av_log(avctx, AV_LOG_ERROR, "Bit allocation failed. Try increasing the bitrate.\n");
+        av_log(s->avctx, AV_LOG_ERROR, "Bit allocation failed. Try increasing the bitrate.\n");
         return ret;
     }
 
@@ -438,12 +429,140 @@ int AC3_NAME(encode_frame)(AVCodecContext *avctx, AVPacket *avpkt,
 
     ff_ac3_quantize_mantissas(s);
 
+    return 0;
+}
+
+
+static int encode_frame_thread(AVCodecContext *avctx, void *arg,
+                               int jobnr, int threadnr)
+{
+    AC3EncodeContext *s  = avctx->priv_data;
+    AC3EncodeContext *fs = s->frame_ctx[jobnr];
+    int ret;
+
+    ret = encode_samples(fs);
+    if (ret)
+        return ret;
+    ff_ac3_output_frame(fs, s->frame_pkt[jobnr].data);
+
+    return 0;
+}
+
+
+/*
+ * Encode using the per-frame contexts.
+ * Input frames are queued until all per-frame contexts are in use, then
+ * encoded together in slice threads, and the packets are returned one per
+ * call. The frame size and the samples overlapping the previous frame are
+ * taken care of by the main context, and the SNR offset search of each batch
+ * starts where the previous batch ended, so the output does not depend on
+ * the number of threads.
+ */
+static int encode_frames_parallel(AVCodecContext *avctx, AVPacket *avpkt,
+                                  const AVFrame *frame, int *got_packet_ptr)
+{
+    AC3EncodeContext *s = avctx->priv_data;
+    int rets[AC3_MAX_PARALLEL_FRAMES];
+    int ch, i, ret;
+
+    if (frame) {
+        AC3EncodeContext *fs = s->frame_ctx[s->nb_queued_frames];
+        AVPacket *pkt        = &s->frame_pkt[s->nb_queued_frames];
+
+        if (s->bit_alloc.sr_code == 1 || s->eac3)
+            ff_ac3_adjust_frame_size(s);
+
+        copy_input_samples(s, (SampleType **)frame->extended_data);
+        for (ch = 0; ch < s->channels; ch++)
+            memcpy(fs->planar_samples[ch], s->planar_samples[ch],
+                   (AC3_FRAME_SIZE + AC3_BLOCK_SIZE) * sizeof(**s->planar_samples));
+        fs->frame_size = s->frame_size;
+
+        pkt->size     = s->frame_size;
+        pkt->pts      = AV_NOPTS_VALUE;
+        if (frame->pts != AV_NOPTS_VALUE)
+            pkt->pts  = frame->pts - ff_samples_to_time_base(avctx, avctx->initial_padding);
+        pkt->duration = ff_samples_to_time_base(avctx, frame->nb_samples);
+
+        s->nb_queued_frames++;
+    }
+
+    if (s->next_frame_pkt == s->nb_frame_pkts && s->nb_queued_frames &&
+        (!frame || s->nb_queued_frames == s->options.parallel_frames)) {
+        AC3EncodeContext *last = s->frame_ctx[s->nb_queued_frames - 1];
+
+        for (i = 0; i < s->nb_queued_frames; i++) {
+            AC3EncodeContext *fs  = s->frame_ctx[i];
+            fs->coarse_snr_offset = s->coarse_snr_offset;
+            memcpy(fs->fine_snr_offset, s->fine_snr_offset,
+                   sizeof(s->fine_snr_offset));
+        }
+
+        avctx->execute2(avctx, encode_frame_thread, NULL, rets,
+                        s->nb_queued_frames);
+        for (i = 0; i < s->nb_queued_frames; i++)
+            if (rets[i])
+                return rets[i];
+
+        s->coarse_snr_offset = last->coarse_snr_offset;
+        memcpy(s->fine_snr_offset, last->fine_snr_offset,
+               sizeof(s->fine_snr_offset));
+
+        s->nb_frame_pkts    = s->nb_queued_frames;
+        s->next_frame_pkt   = 0;
+        s->nb_queued_frames = 0;
+    }
+
+    if (s->next_frame_pkt < s->nb_frame_pkts) {
+        AVPacket *pkt = &s->frame_pkt[s->next_frame_pkt++];
+
+        if ((ret = ff_alloc_packet2(avctx, avpkt, pkt->size)) < 0)
+            return ret;
+        memcpy(avpkt->data, pkt->data, pkt->size);
+        avpkt->pts      = pkt->pts;
+        avpkt->duration = pkt->duration;
+        *got_packet_ptr = 1;
+    }
+
+    return 0;
+}
+
+
+int AC3_NAME(encode_frame)(AVCodecContext *avctx, AVPacket *avpkt,
+                           const AVFrame *frame, int *got_packet_ptr)
+{
+    AC3EncodeContext *s = avctx->priv_data;
+    int ret;
+
+    if (s->frame_ctx)
+        return encode_frames_parallel(avctx, avpkt, frame, got_packet_ptr);
+
+    /* nothing is buffered when encoding one frame at a time */
+    if (!frame)
+        return 0;
+
+    if (s->options.allow_per_frame_metadata) {
+        ret = ff_ac3_validate_metadata(s);
+        if (ret)
+            return ret;
+    }
+
+    if (s->bit_alloc.sr_code == 1 || s->eac3)
+        ff_ac3_adjust_frame_size(s);
+
+    copy_input_samples(s, (SampleType **)frame->extended_data);
+
+    ret = encode_samples(s);
+    if (ret)
+        return ret;
+
     if ((ret = ff_alloc_packet2(avctx, avpkt, s->frame_size)) < 0)
         return ret;
     ff_ac3_output_frame(s, avpkt->data);
 
     if (frame->pts != AV_NOPTS_VALUE)
         avpkt->pts = frame->pts - ff_samples_to_time_base(avctx, avctx->initial_padding);
+    avpkt->duration = ff_samples_to_time_base(avctx, frame->nb_samples);
 
     *got_packet_ptr = 1;
     return 0;
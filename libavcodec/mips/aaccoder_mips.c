@@ -2306,7 +2306,7 @@ static void search_for_quantizers_twoloop_mips(AVCodecContext *avctx,
             }
         }
         its++;
-    } while (fflag && its < 10);
+    } while (fflag && its < s->options.twoloop_its);
 }
 
 static void search_for_ms_mips(AACEncContext *s, ChannelElement *cpe,
@@ -66,6 +66,8 @@ typedef struct Mpeg1Context {
     int tmpgexs;
     int first_slice;
     int extradata_decoded;
+    int pic_started;            /* a picture or field was started by the current packet */
+    int progress_row;           /* next MB row to report to other frame threads */
 } Mpeg1Context;
 
 #define MB_TYPE_ZERO_MV   0x20000000
@@ -1140,6 +1142,7 @@ static av_cold int mpeg_decode_init(AVCodecContext *avctx)
     s->repeat_field                = 0;
     s->mpeg_enc_ctx.codec_id       = avctx->codec->id;
     avctx->color_range             = AVCOL_RANGE_MPEG;
+    avctx->internal->allocate_progress = 1;
     if (avctx->codec->id == AV_CODEC_ID_MPEG1VIDEO)
         avctx->chroma_sample_location = AVCHROMA_LOC_CENTER;
     else
@@ -1166,6 +1169,21 @@ static int mpeg_decode_update_thread_context(AVCodecContext *avctx,
     if (!ctx->mpeg_enc_ctx_allocated)
         memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
 
+    /* sequence and GOP level state parsed by the previous thread */
+    ctx->save_aspect          = ctx_from->save_aspect;
+    ctx->save_width           = ctx_from->save_width;
+    ctx->save_height          = ctx_from->save_height;
+    ctx->save_progressive_seq = ctx_from->save_progressive_seq;
+    ctx->frame_rate_ext       = ctx_from->frame_rate_ext;
+    ctx->sync                 = ctx_from->sync;
+    ctx->tmpgexs              = ctx_from->tmpgexs;
+    ctx->extradata_decoded    = ctx_from->extradata_decoded;
+    s->closed_gop             = s1->closed_gop;
+    memcpy(s->intra_matrix,        s1->intra_matrix,        sizeof(s->intra_matrix));
+    memcpy(s->chroma_intra_matrix, s1->chroma_intra_matrix, sizeof(s->chroma_intra_matrix));
+    memcpy(s->inter_matrix,        s1->inter_matrix,        sizeof(s->inter_matrix));
+    memcpy(s->chroma_inter_matrix, s1->chroma_inter_matrix, sizeof(s->chroma_inter_matrix));
+
     if (!(s->pict_type == AV_PICTURE_TYPE_B || s->low_delay))
         s->picture_number++;
 
@@ -1631,6 +1649,8 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
     Mpeg1Context *s1      = (Mpeg1Context *) s;
     int ret;
 
+    s1->pic_started = 1;
+
     /* start frame decoding */
     if (s->first_field || s->picture_structure == PICT_FRAME) {
         AVFrameSideData *pan_scan;
@@ -1638,6 +1658,8 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
         if ((ret = ff_mpv_frame_start(s, avctx)) < 0)
             return ret;
 
+        s1->progress_row = 0;
+
         ff_mpeg_er_frame_start(s);
 
         /* first check if we must repeat the frame */
@@ -1689,7 +1711,11 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
             s1->has_afd = 0;
         }
 
-        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
+        /* For field pictures, the next thread may only start once the
+         * second field has begun, otherwise it would inherit first_field
+         * in the middle of a frame. */
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+            s->picture_structure == PICT_FRAME)
             ff_thread_finish_setup(avctx);
     } else { // second field
         int i;
@@ -1712,6 +1738,9 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
                 s->current_picture.f->data[i] +=
                     s->current_picture_ptr->f->linesize[i];
         }
+
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
+            ff_thread_finish_setup(avctx);
     }
 
     if (avctx->hwaccel) {
@@ -1882,7 +1911,17 @@ static int mpeg_decode_slice(MpegEncContext *s, int mb_y,
             const int mb_size = 16 >> s->avctx->lowres;
 
             ff_mpeg_draw_horiz_band(s, mb_size * (s->mb_y >> field_pic), mb_size);
-            ff_mpv_report_decode_progress(s);
+            /* Rows of field pictures only become final with the second
+             * field, and rows are only reported without gaps so that the
+             * error concealment of missing slices is never read early. */
+            if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+                !field_pic) {
+                Mpeg1Context *s1 = (Mpeg1Context *) s;
+                if (s->mb_y == s1->progress_row) {
+                    ff_mpv_report_decode_progress(s);
+                    s1->progress_row++;
+                }
+            }
 
             s->mb_x  = 0;
             s->mb_y += 1 << field_pic;
@@ -2398,6 +2437,15 @@ static void mpeg_decode_gop(AVCodecContext *avctx,
     }
 }
 
+/* A first field that is not followed by its second field is final, let the
+ * frame threads waiting on it continue. */
+static void release_lone_field(MpegEncContext *s)
+{
+    if (HAVE_THREADS && (s->avctx->active_thread_type & FF_THREAD_FRAME) &&
+        s->first_field && s->current_picture_ptr)
+        ff_thread_report_progress(&s->current_picture_ptr->tf, INT_MAX, 0);
+}
+
 static int decode_chunks(AVCodecContext *avctx, AVFrame *picture,
                          int *got_output, const uint8_t *buf, int buf_size)
 {
@@ -2560,6 +2608,7 @@ static int decode_chunks(AVCodecContext *avctx, AVFrame *picture,
             break;
         case GOP_START_CODE:
             if (last_code == 0) {
+                release_lone_field(s2);
                 s2->first_field = 0;
                 mpeg_decode_gop(avctx, buf_ptr, input_size);
                 s->sync = 1;
@@ -2591,6 +2640,7 @@ static int decode_chunks(AVCodecContext *avctx, AVFrame *picture,
                     av_log(s2->avctx, AV_LOG_WARNING, "invalid frame_pred_frame_dct\n");
 
                 if (s2->picture_structure == PICT_FRAME) {
+                    release_lone_field(s2);
                     s2->first_field = 0;
                     s2->v_edge_pos  = 16 * s2->mb_height;
                 } else {
@@ -2784,7 +2834,12 @@ static int mpeg_decode_frame(AVCodecContext *avctx, void *data,
         }
     }
 
+    s->pic_started = 0;
     ret = decode_chunks(avctx, picture, got_output, buf, buf_size);
+    /* a picture abandoned halfway must not block the other frame threads */
+    if (HAVE_THREADS && ret < 0 && s->pic_started && s2->current_picture_ptr &&
+        (avctx->active_thread_type & FF_THREAD_FRAME))
+        ff_thread_report_progress(&s2->current_picture_ptr->tf, INT_MAX, 0);
     if (ret<0 || *got_output)
         s2->current_picture_ptr = NULL;
 
@@ -2833,7 +2888,7 @@ AVCodec ff_mpeg1video_decoder = {
     .decode                = mpeg_decode_frame,
     .capabilities          = CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 |
                              CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY |
-                             CODEC_CAP_SLICE_THREADS,
+                             CODEC_CAP_SLICE_THREADS | CODEC_CAP_FRAME_THREADS,
     .flush                 = flush,
     .max_lowres            = 3,
     .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context)
@@ -2850,10 +2905,11 @@ AVCodec ff_mpeg2video_decoder = {
     .decode         = mpeg_decode_frame,
     .capabilities   = CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 |
                       CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY |
-                      CODEC_CAP_SLICE_THREADS,
+                      CODEC_CAP_SLICE_THREADS | CODEC_CAP_FRAME_THREADS,
     .flush          = flush,
     .max_lowres     = 3,
     .profiles       = NULL_IF_CONFIG_SMALL(mpeg2_video_profiles),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context)
 };
 
 //legacy decoder
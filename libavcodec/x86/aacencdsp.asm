@@ -0,0 +1,106 @@
+;******************************************************************************
+;* AAC encoder SIMD quantization helpers
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA
+
+ps_abs_mask:  times 4 dd 0x7fffffff
+pd_rounding:  times 2 dq 0.4054
+
+SECTION_TEXT
+
+;*******************************************************************
+; void ff_abs_pow34_sse2(float *out, const float *in, int size)
+; size must be a positive multiple of 4
+;*******************************************************************
+; Same operations as the C version in the same order, so the results are
+; bit-exact: sqrtps is correctly rounded like sqrtf().
+INIT_XMM sse2
+cglobal abs_pow34, 3, 3, 3, out, in, size
+    mova         m2, [ps_abs_mask]
+    movsxdifnidn sizeq, sized
+    shl       sizeq, 2
+    add         inq, sizeq
+    add        outq, sizeq
+    neg       sizeq
+.loop:
+    movu         m0, [inq+sizeq]
+    andps        m0, m2
+    sqrtps       m1, m0
+    mulps        m0, m1
+    sqrtps       m0, m0
+    movu [outq+sizeq], m0
+    add       sizeq, mmsize
+    jl .loop
+    REP_RET
+
+;*******************************************************************
+; void ff_aac_quantize_bands_sse2(int *out, const float *in,
+;                                 const float *scaled, int size,
+;                                 int is_signed, int maxval,
+;                                 const float Q34)
+; size must be a positive multiple of 4
+;*******************************************************************
+; The rounding offset and the clipping are done in double precision like
+; in the C version; the sign is applied as (q ^ m) - m with m the mask of
+; the negative inputs.
+INIT_XMM sse2
+cglobal aac_quantize_bands, 6, 6, 8, out, in, scaled, size, is_signed, maxval, Q34
+%if UNIX64 == 0
+    movss        m0, Q34m
+%endif
+    shufps       m0, m0, 0
+    cvtsi2sd     m5, maxvald
+    unpcklpd     m5, m5
+    mova         m6, [pd_rounding]
+    neg  is_signedd
+    sbb  is_signedd, is_signedd
+    movd         m7, is_signedd
+    pshufd       m7, m7, 0
+    xorps        m3, m3
+    movsxdifnidn sizeq, sized
+    shl       sizeq, 2
+    add         inq, sizeq
+    add        outq, sizeq
+    add     scaledq, sizeq
+    neg       sizeq
+.loop:
+    movu         m1, [scaledq+sizeq]
+    mulps        m1, m0
+    cvtps2pd     m2, m1
+    movhlps      m1, m1
+    cvtps2pd     m1, m1
+    addpd        m2, m6
+    addpd        m1, m6
+    minpd        m2, m5
+    minpd        m1, m5
+    cvttpd2dq    m2, m2
+    cvttpd2dq    m1, m1
+    punpcklqdq   m2, m1
+    movu         m4, [inq+sizeq]
+    cmpltps      m4, m3
+    pand         m4, m7
+    pxor         m2, m4
+    psubd        m2, m4
+    movu [outq+sizeq], m2
+    add       sizeq, mmsize
+    jl .loop
+    REP_RET
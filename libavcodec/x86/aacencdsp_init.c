@@ -0,0 +1,79 @@
+/*
+ * AAC encoder SIMD quantization helpers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <math.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/aacenc.h"
+
+void ff_abs_pow34_sse2(float *out, const float *in, int size);
+void ff_aac_quantize_bands_sse2(int *out, const float *in, const float *scaled,
+                                int size, int is_signed, int maxval,
+                                const float Q34);
+
+#if HAVE_YASM
+/* The asm versions work on multiples of 4 values, the C code below does
+ * the rest in the same way as the C versions. */
+static void abs_pow34_sse2(float *out, const float *in, const int size)
+{
+    const int size4 = size & ~3;
+    int j;
+
+    if (size4)
+        ff_abs_pow34_sse2(out, in, size4);
+
+    for (j = size4; j < size; j++) {
+        float a = fabsf(in[j]);
+        out[j] = sqrtf(a * sqrtf(a));
+    }
+}
+
+static void quantize_bands_sse2(int *out, const float *in, const float *scaled,
+                                int size, float Q34, int is_signed, int maxval)
+{
+    const int size4 = size & ~3;
+    int j;
+
+    if (size4)
+        ff_aac_quantize_bands_sse2(out, in, scaled, size4, is_signed, maxval, Q34);
+
+    for (j = size4; j < size; j++) {
+        double qc = scaled[j] * Q34;
+        out[j] = (int)FFMIN(qc + 0.4054, (double)maxval);
+        if (is_signed && in[j] < 0.0f)
+            out[j] = -out[j];
+    }
+}
+#endif /* HAVE_YASM */
+
+av_cold void ff_aac_dsp_init_x86(AACEncContext *s)
+{
+#if HAVE_YASM
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE2(cpu_flags)) {
+        s->abs_pow34   = abs_pow34_sse2;
+        s->quant_bands = quantize_bands_sse2;
+    }
+#endif
+}
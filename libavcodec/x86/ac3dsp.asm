@@ -39,6 +39,11 @@ pd_151: times 4 dd 151
 pb_revwords: SHUFFLE_MASK_W 7, 6, 5, 4, 3, 2, 1, 0
 pd_16384: times 4 dd 16384
 
+; used in ff_ac3_bap_lookup()
+pb_16:   times 16 db 16
+pb_63:   times 16 db 63
+pb_0x70: times 16 db 0x70
+
 SECTION .text
 
 ;-----------------------------------------------------------------------------
@@ -550,3 +555,55 @@ INIT_XMM ssse3
 APPLY_WINDOW_INT16 1
 INIT_XMM ssse3, atom
 APPLY_WINDOW_INT16 1
+
+;-----------------------------------------------------------------------------
+; void ff_ac3_bap_lookup(uint8_t *bap, const int16_t *psd, const int16_t *mask,
+;                        const uint8_t *bap_tab, int len)
+;
+; len must be a positive multiple of 16. The 64-entry table is held in m4-m7
+; and each quarter of it is indexed with pshufb. Adding 0x70 with unsigned
+; saturation sets the high bit of the out-of-range indexes, so that they
+; return 0.
+;-----------------------------------------------------------------------------
+
+%macro BAP_LOOKUP 2 ; dst, table quarter
+    paddusb     m1, m0, [pb_0x70]
+    pshufb      %1, %2, m1
+%endmacro
+
+INIT_XMM ssse3
+cglobal ac3_bap_lookup, 5, 5, 8, bap, psd, mask, bap_tab, len
+    movu        m4, [bap_tabq]
+    movu        m5, [bap_tabq+16]
+    movu        m6, [bap_tabq+32]
+    movu        m7, [bap_tabq+48]
+    movsxdifnidn lenq, lend
+    add       bapq, lenq
+    lea       psdq, [psdq+lenq*2]
+    lea      maskq, [maskq+lenq*2]
+    neg       lenq
+.loop:
+    movu        m0, [psdq+lenq*2]
+    movu        m1, [psdq+lenq*2+16]
+    movu        m2, [maskq+lenq*2]
+    movu        m3, [maskq+lenq*2+16]
+    psubsw      m0, m2
+    psubsw      m1, m3
+    psraw       m0, 5
+    psraw       m1, 5
+    packuswb    m0, m1
+    pminub      m0, [pb_63]
+    BAP_LOOKUP  m2, m4
+    psubb       m0, [pb_16]
+    BAP_LOOKUP  m3, m5
+    por         m2, m3
+    psubb       m0, [pb_16]
+    BAP_LOOKUP  m3, m6
+    por         m2, m3
+    psubb       m0, [pb_16]
+    BAP_LOOKUP  m3, m7
+    por         m2, m3
+    movu  [bapq+lenq], m2
+    add       lenq, mmsize
+    jl .loop
+    REP_RET
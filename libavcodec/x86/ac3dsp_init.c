@@ -64,6 +64,10 @@ void ff_apply_window_int16_ssse3(int16_t *output, const int16_t *input,
 void ff_apply_window_int16_ssse3_atom(int16_t *output, const int16_t *input,
                                       const int16_t *window, unsigned int len);
 
+void ff_ac3_bap_lookup_ssse3(uint8_t *bap, const int16_t *psd,
+                             const int16_t *mask, const uint8_t *bap_tab,
+                             int len);
+
 #if ARCH_X86_32 && defined(__INTEL_COMPILER)
 #       undef HAVE_7REGS
 #       define HAVE_7REGS 0
@@ -196,6 +200,46 @@ static void ac3_downmix_sse(float **samples, float (*matrix)[2],
 
 #endif /* HAVE_SSE_INLINE && HAVE_7REGS */
 
+#if HAVE_SSSE3_EXTERNAL
+static void ac3_bit_alloc_calc_bap_ssse3(int16_t *mask, int16_t *psd,
+                                         int start, int end,
+                                         int snr_offset, int floor,
+                                         const uint8_t *bap_tab, uint8_t *bap)
+{
+    DECLARE_ALIGNED(16, int16_t, bin_mask)[AC3_MAX_COEFS];
+    int bin, band, band_end, end16;
+
+    /* special case, if snr offset is -960, set all bap's to zero */
+    if (snr_offset == -960) {
+        memset(bap, 0, AC3_MAX_COEFS);
+        return;
+    }
+
+    /* expand the masking curve to one value per bin; it is always
+     * non-negative and any value above INT16_MAX yields a zero address */
+    bin  = start;
+    band = ff_ac3_bin_to_band_tab[start];
+    do {
+        int m = (FFMAX(mask[band] - snr_offset - floor, 0) & 0x1FE0) + floor;
+        m = FFMIN(m, INT16_MAX);
+        band_end = ff_ac3_band_start_tab[++band];
+        band_end = FFMIN(band_end, end);
+        for (; bin < band_end; bin++)
+            bin_mask[bin] = m;
+    } while (end > band_end);
+
+    end16 = start + ((end - start) & ~15);
+    if (end16 > start)
+        ff_ac3_bap_lookup_ssse3(bap + start, psd + start, bin_mask + start,
+                                bap_tab, end16 - start);
+
+    for (bin = end16; bin < end; bin++) {
+        int address = av_clip_uintp2((psd[bin] - bin_mask[bin]) >> 5, 6);
+        bap[bin] = bap_tab[address];
+    }
+}
+#endif /* HAVE_SSSE3_EXTERNAL */
+
 av_cold void ff_ac3dsp_init_x86(AC3DSPContext *c, int bit_exact)
 {
     int cpu_flags = av_get_cpu_flags();
@@ -241,6 +285,9 @@ av_cold void ff_ac3dsp_init_x86(AC3DSPContext *c, int bit_exact)
     }
     if (EXTERNAL_SSSE3(cpu_flags)) {
         c->ac3_max_msb_abs_int16 = ff_ac3_max_msb_abs_int16_ssse3;
+#if HAVE_SSSE3_EXTERNAL
+        c->bit_alloc_calc_bap = ac3_bit_alloc_calc_bap_ssse3;
+#endif
         if (cpu_flags & AV_CPU_FLAG_ATOM) {
             c->apply_window_int16 = ff_apply_window_int16_ssse3_atom;
         } else {
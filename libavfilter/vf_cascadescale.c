@@ -0,0 +1,367 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * multi-output scale filter, producing a rendition ladder from one input
+ *
+ * Every output is scaled either from the input or, in cascade mode, from
+ * the closest larger rendition already produced for the same frame, so a
+ * 1080p -> 720p -> 480p -> 360p ladder only runs the expensive scaling
+ * pass once at full resolution. Renditions that do not depend on each
+ * other are scaled concurrently through the filter graph slice threads,
+ * and a rendition scaled alone is split into bands by the libswscale
+ * threads.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/internal.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+#define MAX_RENDITIONS 16
+
+typedef struct Rendition {
+    int w, h;
+    int src;                    ///< index of the source rendition, -1 for the filter input
+    int level;                  ///< cascade depth, renditions of equal level are independent
+    struct SwsContext *sws;
+} Rendition;
+
+typedef struct CascadeScaleContext {
+    const AVClass *class;
+    char *sizes_str;
+    char *flags_str;
+    int cascade;
+
+    unsigned int flags;
+    int nb_renditions;
+    int nb_levels;
+    Rendition renditions[MAX_RENDITIONS];
+} CascadeScaleContext;
+
+typedef struct ThreadData {
+    AVFrame *in;
+    AVFrame **out;
+    int *jobs;                  ///< rendition indexes scaled by this execute() call
+} ThreadData;
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    CascadeScaleContext *s = ctx->priv;
+    int idx = FF_OUTLINK_IDX(outlink);
+    Rendition *r = &s->renditions[idx];
+    int src_w = r->src < 0 ? inlink->w : s->renditions[r->src].w;
+    int src_h = r->src < 0 ? inlink->h : s->renditions[r->src].h;
+    int nb_threads = ctx->graph->nb_threads;
+    int i, ret;
+
+    outlink->w = r->w;
+    outlink->h = r->h;
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ outlink->h * inlink->w,
+                                                              outlink->w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    sws_freeContext(r->sws);
+    r->sws = NULL;
+    if (src_w == r->w && src_h == r->h)
+        return 0;
+
+    /* renditions scaled concurrently already run on the graph threads */
+    for (i = 0; i < s->nb_renditions; i++)
+        if (i != idx && s->renditions[i].level == r->level)
+            nb_threads = 1;
+
+    r->sws = sws_alloc_context();
+    if (!r->sws)
+        return AVERROR(ENOMEM);
+    av_opt_set_int(r->sws, "srcw",       src_w,                 0);
+    av_opt_set_int(r->sws, "srch",       src_h,                 0);
+    av_opt_set_int(r->sws, "src_format", inlink->format,        0);
+    av_opt_set_int(r->sws, "dstw",       r->w,                  0);
+    av_opt_set_int(r->sws, "dsth",       r->h,                  0);
+    av_opt_set_int(r->sws, "dst_format", outlink->format,       0);
+    av_opt_set_int(r->sws, "sws_flags",  s->flags,              0);
+    av_opt_set_int(r->sws, "threads",    nb_threads,            0);
+    if ((ret = sws_init_context(r->sws, NULL, NULL)) < 0)
+        return ret;
+
+    av_log(ctx, AV_LOG_VERBOSE, "rendition %d: %dx%d -> %dx%d (from %s%d)\n",
+           idx, src_w, src_h, r->w, r->h,
+           r->src < 0 ? "input" : "rendition ", r->src < 0 ? 0 : r->src);
+    return 0;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    CascadeScaleContext *s = ctx->priv;
+    char *sizes, *item, *saveptr = NULL;
+    int i, j, ret = 0;
+
+    if (!s->sizes_str) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified.\n");
+        return AVERROR(EINVAL);
+    }
+
+    sizes = av_strdup(s->sizes_str);
+    if (!sizes)
+        return AVERROR(ENOMEM);
+
+    for (item = av_strtok(sizes, "|", &saveptr); item;
+         item = av_strtok(NULL, "|", &saveptr)) {
+        Rendition *r;
+
+        if (s->nb_renditions >= MAX_RENDITIONS) {
+            av_log(ctx, AV_LOG_ERROR, "Too many renditions, at most %d are supported.\n",
+                   MAX_RENDITIONS);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+        r = &s->renditions[s->nb_renditions];
+        if ((ret = av_parse_video_size(&r->w, &r->h, item)) < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", item);
+            goto end;
+        }
+        s->nb_renditions++;
+    }
+
+    if (!s->nb_renditions) {
+        av_log(ctx, AV_LOG_ERROR, "No output sizes specified.\n");
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    /* Pick for every rendition the smallest earlier rendition that is at
+     * least as large in both dimensions, so each scaling pass starts from
+     * the least amount of data. */
+    for (i = 0; i < s->nb_renditions; i++) {
+        Rendition *r = &s->renditions[i];
+
+        r->src   = -1;
+        r->level = 0;
+        for (j = 0; s->cascade && j < i; j++) {
+            const Rendition *c = &s->renditions[j];
+            if (c->w < r->w || c->h < r->h)
+                continue;
+            if (r->src < 0 || (int64_t)c->w * c->h < (int64_t)s->renditions[r->src].w * s->renditions[r->src].h)
+                r->src = j;
+        }
+        if (r->src >= 0)
+            r->level = s->renditions[r->src].level + 1;
+        s->nb_levels = FFMAX(s->nb_levels, r->level + 1);
+    }
+
+    s->flags = SWS_BILINEAR;
+    if (s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        if ((ret = av_opt_eval_flags(&class, o, s->flags_str, &s->flags)) < 0)
+            goto end;
+    }
+
+    for (i = 0; i < s->nb_renditions; i++) {
+        char name[32];
+        AVFilterPad pad = { 0 };
+
+        snprintf(name, sizeof(name), "%dx%d", s->renditions[i].w, s->renditions[i].h);
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.name         = av_strdup(name);
+        pad.config_props = config_output;
+        if (!pad.name) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ff_insert_outpad(ctx, i, &pad);
+    }
+
+end:
+    av_free(sizes);
+    return ret;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    CascadeScaleContext *s = ctx->priv;
+    int i;
+
+    for (i = 0; i < s->nb_renditions; i++) {
+        sws_freeContext(s->renditions[i].sws);
+        s->renditions[i].sws = NULL;
+    }
+    for (i = 0; i < ctx->nb_outputs; i++)
+        av_freep(&ctx->output_pads[i].name);
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *formats = NULL;
+    const AVPixFmtDescriptor *desc = NULL;
+    int ret;
+
+    /* every stage of the cascade reads the output of the previous one, so
+     * all links share a single pixel format */
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+
+        if (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_PSEUDOPAL |
+                           AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM))
+            continue;
+        if (!sws_isSupportedInput(pix_fmt) || !sws_isSupportedOutput(pix_fmt))
+            continue;
+        if ((ret = ff_add_format(&formats, pix_fmt)) < 0) {
+            ff_formats_unref(&formats);
+            return ret;
+        }
+    }
+    ff_set_common_formats(ctx, formats);
+    return 0;
+}
+
+static int scale_rendition(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    CascadeScaleContext *s = ctx->priv;
+    ThreadData *td = arg;
+    int idx = td->jobs[jobnr];
+    const Rendition *r = &s->renditions[idx];
+    const AVFrame *src = r->src < 0 ? td->in : td->out[r->src];
+    AVFrame *dst = td->out[idx];
+
+    if (!r->sws)
+        return av_frame_copy(dst, src);
+
+    sws_scale(r->sws, (const uint8_t * const *)src->data, src->linesize,
+              0, src->height, dst->data, dst->linesize);
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    CascadeScaleContext *s = ctx->priv;
+    AVFrame *out[MAX_RENDITIONS] = { NULL };
+    int jobs[MAX_RENDITIONS];
+    ThreadData td = { .in = in, .out = out, .jobs = jobs };
+    int i, level, ret = 0;
+
+    if (in->width != inlink->w || in->height != inlink->h) {
+        if (in->format != inlink->format) {
+            av_log(ctx, AV_LOG_ERROR, "Changing the pixel format mid-stream is not supported.\n");
+            av_frame_free(&in);
+            return AVERROR_PATCHWELCOME;
+        }
+        inlink->w = in->width;
+        inlink->h = in->height;
+        for (i = 0; i < ctx->nb_outputs; i++)
+            if ((ret = config_output(ctx->outputs[i])) < 0)
+                goto fail;
+    }
+
+    for (i = 0; i < s->nb_renditions; i++) {
+        AVFilterLink *outlink = ctx->outputs[i];
+
+        out[i] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out[i]) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        av_frame_copy_props(out[i], in);
+        av_reduce(&out[i]->sample_aspect_ratio.num, &out[i]->sample_aspect_ratio.den,
+                  (int64_t)in->sample_aspect_ratio.num * outlink->h * inlink->w,
+                  (int64_t)in->sample_aspect_ratio.den * outlink->w * inlink->h,
+                  INT_MAX);
+    }
+
+    for (level = 0; level < s->nb_levels; level++) {
+        int nb_jobs = 0;
+
+        for (i = 0; i < s->nb_renditions; i++)
+            if (s->renditions[i].level == level)
+                jobs[nb_jobs++] = i;
+        ctx->internal->execute(ctx, scale_rendition, &td, NULL, nb_jobs);
+    }
+
+    av_frame_free(&in);
+
+    for (i = 0; i < s->nb_renditions; i++) {
+        int err;
+
+        if (ctx->outputs[i]->closed) {
+            av_frame_free(&out[i]);
+            continue;
+        }
+        err = ff_filter_frame(ctx->outputs[i], out[i]);
+        out[i] = NULL;
+        if (err < 0 && !ret)
+            ret = err;
+    }
+    return ret;
+
+fail:
+    for (i = 0; i < s->nb_renditions; i++)
+        av_frame_free(&out[i]);
+    av_frame_free(&in);
+    return ret;
+}
+
+#define OFFSET(x) offsetof(CascadeScaleContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+
+static const AVOption cascadescale_options[] = {
+    { "sizes",   "set the '|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = NULL },       .flags = FLAGS },
+    { "s",       "set the '|'-separated list of output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = NULL },       .flags = FLAGS },
+    { "flags",   "set libswscale flags",                        OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "bicubic" }, .flags = FLAGS },
+    { "cascade", "scale each rendition from the closest larger one", OFFSET(cascade), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(cascadescale);
+
+static const AVFilterPad cascadescale_inputs[] = {
+    {
+        .name         = "default",
+        .type         = AVMEDIA_TYPE_VIDEO,
+        .filter_frame = filter_frame,
+    },
+    { NULL }
+};
+
+AVFilter ff_vf_cascadescale = {
+    .name          = "cascadescale",
+    .description   = NULL_IF_CONFIG_SMALL("Scale the input video to several output sizes at once."),
+    .priv_size     = sizeof(CascadeScaleContext),
+    .priv_class    = &cascadescale_class,
+    .init          = init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .inputs        = cascadescale_inputs,
+    .outputs       = NULL,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
+};
@@ -32,6 +32,9 @@
 #include "internal.h"
 #include "video.h"
 
+/* number of columns whose averages are computed in one pass over the frame */
+#define COL_BLOCK 64
+
 typedef struct CropDetectContext {
     const AVClass *class;
     int x1, y1, x2, y2;
@@ -41,6 +44,13 @@ typedef struct CropDetectContext {
     int frame_nb;
     int max_pixsteps[4];
     int max_outliers;
+    int frame_step;
+    int sample_step;
+
+    int nb_threads;
+    int *col_sums;              ///< per thread column sums of the current block
+    int col_block;              ///< first column of the current block, -1 if none
+    int col_avg[COL_BLOCK];
 } CropDetectContext;
 
 static int query_formats(AVFilterContext *ctx)
@@ -74,6 +84,11 @@ static int checkline(void *ctx, const unsigned char *src, int stride, int len, i
 
     switch (bpp) {
     case 1:
+        if (stride == 1) {
+            for (; len > 0; len--)
+                total += *src++;
+            break;
+        }
         while (len >= 8) {
             total += src[       0] + src[  stride] + src[2*stride] + src[3*stride]
                   +  src[4*stride] + src[5*stride] + src[6*stride] + src[7*stride];
@@ -87,15 +102,20 @@ static int checkline(void *ctx, const unsigned char *src, int stride, int len, i
         break;
     case 2:
         stride >>= 1;
+        if (stride == 1) {
+            for (; len > 0; len--)
+                total += *src16++;
+            break;
+        }
         while (len >= 8) {
             total += src16[       0] + src16[  stride] + src16[2*stride] + src16[3*stride]
                   +  src16[4*stride] + src16[5*stride] + src16[6*stride] + src16[7*stride];
-            src += 8*stride;
+            src16 += 8*stride;
             len -= 8;
         }
         while (--len >= 0) {
             total += src16[0];
-            src += stride;
+            src16 += stride;
         }
         break;
     case 3:
@@ -121,6 +141,74 @@ static int checkline(void *ctx, const unsigned char *src, int stride, int len, i
     return total;
 }
 
+/**
+ * Sum up the COL_BLOCK columns starting at s->col_block over a band of
+ * rows. The frame is walked row by row, so that neighbouring columns are
+ * summed together instead of reading the frame one column at a time.
+ */
+static int col_sums_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    CropDetectContext *s = ctx->priv;
+    AVFrame *frame = arg;
+    const int bpp = s->max_pixsteps[0];
+    const int step = s->sample_step;
+    const int nb_rows = (frame->height + step - 1) / step;
+    const int start = (nb_rows *  jobnr     ) / nb_jobs * step;
+    const int end   = (nb_rows * (jobnr + 1)) / nb_jobs * step;
+    const int n = FFMIN(COL_BLOCK, frame->width - s->col_block);
+    int *sums = s->col_sums + jobnr * COL_BLOCK;
+    int x, y;
+
+    memset(sums, 0, COL_BLOCK * sizeof(*sums));
+
+    for (y = start; y < end; y += step) {
+        const uint8_t *src = frame->data[0] + y * frame->linesize[0] + s->col_block * bpp;
+        const uint16_t *src16 = (const uint16_t *)src;
+
+        switch (bpp) {
+        case 1:
+            for (x = 0; x < n; x++)
+                sums[x] += src[x];
+            break;
+        case 2:
+            for (x = 0; x < n; x++)
+                sums[x] += src16[x];
+            break;
+        case 3:
+        case 4:
+            for (x = 0; x < n; x++)
+                sums[x] += src[x * bpp] + src[x * bpp + 1] + src[x * bpp + 2];
+            break;
+        }
+    }
+    return 0;
+}
+
+static int checkcol(AVFilterContext *ctx, AVFrame *frame, int x)
+{
+    CropDetectContext *s = ctx->priv;
+    const int nb_rows = (frame->height + s->sample_step - 1) / s->sample_step;
+
+    if (s->col_block < 0 || x < s->col_block || x >= s->col_block + COL_BLOCK) {
+        const int nb_jobs = FFMIN(nb_rows, s->nb_threads);
+        const int div = nb_rows * (s->max_pixsteps[0] >= 3 ? 3 : 1);
+        int i, j;
+
+        s->col_block = x & ~(COL_BLOCK - 1);
+        ctx->internal->execute(ctx, col_sums_slice, frame, NULL, nb_jobs);
+
+        for (i = 0; i < COL_BLOCK; i++) {
+            int total = s->col_sums[i];
+            for (j = 1; j < nb_jobs; j++)
+                total += s->col_sums[j * COL_BLOCK + i];
+            s->col_avg[i] = total / div;
+        }
+    }
+
+    av_log(ctx, AV_LOG_DEBUG, "total:%d\n", s->col_avg[x - s->col_block]);
+    return s->col_avg[x - s->col_block];
+}
+
 static av_cold int init(AVFilterContext *ctx)
 {
     CropDetectContext *s = ctx->priv;
@@ -133,6 +221,13 @@ static av_cold int init(AVFilterContext *ctx)
     return 0;
 }
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    CropDetectContext *s = ctx->priv;
+
+    av_freep(&s->col_sums);
+}
+
 static int config_input(AVFilterLink *inlink)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -149,6 +244,12 @@ static int config_input(AVFilterLink *inlink)
     s->x2 = 0;
     s->y2 = 0;
 
+    s->nb_threads = ctx->graph->nb_threads;
+    av_freep(&s->col_sums);
+    s->col_sums = av_malloc_array(s->nb_threads, COL_BLOCK * sizeof(*s->col_sums));
+    if (!s->col_sums)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
@@ -160,6 +261,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
     AVFilterContext *ctx = inlink->dst;
     CropDetectContext *s = ctx->priv;
     int bpp = s->max_pixsteps[0];
+    int step = s->sample_step;
     int w, h, x, y, shrink_by;
     AVDictionary **metadata;
     int outliers, last_y;
@@ -178,10 +280,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
             s->frame_nb = 1;
         }
 
-#define FIND(DST, FROM, NOEND, INC, STEP0, STEP1, LEN) \
+#define FIND(DST, FROM, NOEND, INC, CHECK) \
         outliers = 0;\
         for (last_y = y = FROM; NOEND; y = y INC) {\
-            if (checkline(ctx, frame->data[0] + STEP0 * y, STEP1, LEN, bpp) > limit) {\
+            if (CHECK > limit) {\
                 if (++outliers > s->max_outliers) { \
                     DST = last_y;\
                     break;\
@@ -190,11 +292,18 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
                 last_y = y INC;\
         }
 
-        FIND(s->y1,                 0,               y < s->y1, +1, frame->linesize[0], bpp, frame->width);
-        FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, frame->linesize[0], bpp, frame->width);
-        FIND(s->x1,                 0,               y < s->x1, +1, bpp, frame->linesize[0], frame->height);
-        FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, bpp, frame->linesize[0], frame->height);
+#define CHECKROW(y) checkline(ctx, frame->data[0] + frame->linesize[0] * (y), \
+                              bpp * step, (frame->width + step - 1) / step, bpp)
 
+        // only look for the borders on every frame_step-th frame
+        if ((s->frame_nb - 1) % s->frame_step == 0) {
+            s->col_block = -1;
+
+            FIND(s->y1,                 0,               y < s->y1, +1, CHECKROW(y));
+            FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, CHECKROW(y));
+            FIND(s->x1,                 0,               y < s->x1, +1, checkcol(ctx, frame, y));
+            FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, checkcol(ctx, frame, y));
+        }
 
         // round x and y (up), important for yuv colorspaces
         // make sure they stay rounded!
@@ -247,6 +356,8 @@ static const AVOption cropdetect_options[] = {
     { "reset", "Recalculate the crop area after this many frames",    OFFSET(reset_count), AV_OPT_TYPE_INT, { .i64 = 0 },  0, INT_MAX, FLAGS },
     { "reset_count", "Recalculate the crop area after this many frames",OFFSET(reset_count),AV_OPT_TYPE_INT,{ .i64 = 0 },  0, INT_MAX, FLAGS },
     { "max_outliers", "Threshold count of outliers",                  OFFSET(max_outliers),AV_OPT_TYPE_INT, { .i64 = 0 },  0, INT_MAX, FLAGS },
+    { "frame_step", "Only look for the borders every this many frames", OFFSET(frame_step), AV_OPT_TYPE_INT, { .i64 = 1 },  1, INT_MAX, FLAGS },
+    { "sample_step", "Only sample every this many pixels of each line", OFFSET(sample_step), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, INT_MAX, FLAGS },
     { NULL }
 };
 
@@ -276,8 +387,9 @@ AVFilter ff_vf_cropdetect = {
     .priv_size     = sizeof(CropDetectContext),
     .priv_class    = &cropdetect_class,
     .init          = init,
+    .uninit        = uninit,
     .query_formats = query_formats,
     .inputs        = avfilter_vf_cropdetect_inputs,
     .outputs       = avfilter_vf_cropdetect_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -38,10 +38,13 @@
 #include "libavutil/timestamp.h"
 #include "avfilter.h"
 #include "internal.h"
+#include "vf_fieldmatch.h"
 
 #define INPUT_MAIN     0
 #define INPUT_CLEANSRC 1
 
+#define MAX_THREADS 32
+
 enum fieldmatch_parity {
     FM_PARITY_AUTO   = -1,
     FM_PARITY_BOTTOM =  0,
@@ -104,9 +107,13 @@ typedef struct {
     int map_linesize[4];
     uint8_t *cmask_data[4];
     int cmask_linesize[4];
-    int *c_array;
+    int *c_array;                   ///< one block counter array per slice job
+    int c_array_size;
     int tpitchy, tpitchuv;
     uint8_t *tbuffer;
+
+    FieldMatchDSPContext dsp;
+    int nb_threads;
 } FieldMatchContext;
 
 #define OFFSET(x) offsetof(FieldMatchContext, x)
@@ -161,9 +168,46 @@ static int get_height(const FieldMatchContext *fm, const AVFrame *f, int plane)
     return plane ? FF_CEIL_RSHIFT(f->height, fm->vsub) : f->height;
 }
 
-static int64_t luma_abs_diff(const AVFrame *f1, const AVFrame *f2)
+static void abs_diff_line_c(uint8_t *dst, const uint8_t *a, const uint8_t *b, int w)
+{
+    int x;
+
+    for (x = 0; x < w; x++)
+        dst[x] = FFABS(a[x] - b[x]);
+}
+
+static int sad_line_c(const uint8_t *a, const uint8_t *b, int w)
+{
+    int x, acc = 0;
+
+    for (x = 0; x < w; x++)
+        acc += abs(a[x] - b[x]);
+    return acc;
+}
+
+static void comb_line_c(uint8_t *dst, const uint8_t *cur,
+                        const uint8_t *p1, const uint8_t *n1,
+                        const uint8_t *p2, const uint8_t *n2,
+                        int w, int cthresh)
 {
-    int x, y;
+    int x;
+    const int cthresh6 = cthresh * 6;
+
+    /* [1 -3 4 -3 1] vertical filter */
+    for (x = 0; x < w; x++) {
+        const int s1 = abs(cur[x] - p1[x]);
+        const int s2 = abs(cur[x] - n1[x]);
+        dst[x] = 0;
+        if (s1 > cthresh && s2 > cthresh &&
+            abs(4 * cur[x] - 3 * (p1[x] + n1[x]) + (p2[x] + n2[x])) > cthresh6)
+            dst[x] = 0xff;
+    }
+}
+
+static int64_t luma_abs_diff(const FieldMatchContext *fm,
+                             const AVFrame *f1, const AVFrame *f2)
+{
+    int y;
     const uint8_t *srcp1 = f1->data[0];
     const uint8_t *srcp2 = f2->data[0];
     const int src1_linesize = f1->linesize[0];
@@ -173,8 +217,7 @@ static int64_t luma_abs_diff(const AVFrame *f1, const AVFrame *f2)
     int64_t acc = 0;
 
     for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++)
-            acc += abs(srcp1[x] - srcp2[x]);
+        acc += fm->dsp.sad_line(srcp1, srcp2, width);
         srcp1 += src1_linesize;
         srcp2 += src2_linesize;
     }
@@ -191,80 +234,146 @@ static void fill_buf(uint8_t *data, int w, int h, int linesize, uint8_t v)
     }
 }
 
-static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
+static int comb_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y, plane, max_v = 0;
+    const FieldMatchContext *fm = ctx->priv;
+    const AVFrame *src = arg;
     const int cthresh = fm->cthresh;
-    const int cthresh6 = cthresh * 6;
+    int y, plane;
 
     for (plane = 0; plane < (fm->chroma ? 3 : 1); plane++) {
-        const uint8_t *srcp = src->data[plane];
         const int src_linesize = src->linesize[plane];
         const int width  = get_width (fm, src, plane);
         const int height = get_height(fm, src, plane);
-        uint8_t *cmkp = fm->cmask_data[plane];
         const int cmk_linesize = fm->cmask_linesize[plane];
+        const int slice_start = (height *  jobnr   ) / nb_jobs;
+        const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+        uint8_t *cmkp = fm->cmask_data[plane] + slice_start * cmk_linesize;
 
         if (cthresh < 0) {
-            fill_buf(cmkp, width, height, cmk_linesize, 0xff);
+            fill_buf(cmkp, width, slice_end - slice_start, cmk_linesize, 0xff);
             continue;
         }
-        fill_buf(cmkp, width, height, cmk_linesize, 0);
-
-        /* [1 -3 4 -3 1] vertical filter */
-#define FILTER(xm2, xm1, xp1, xp2) \
-        abs(  4 * srcp[x] \
-             -3 * (srcp[x + (xm1)*src_linesize] + srcp[x + (xp1)*src_linesize]) \
-             +    (srcp[x + (xm2)*src_linesize] + srcp[x + (xp2)*src_linesize])) > cthresh6
-
-        /* first line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && FILTER(2, 1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* second line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* all lines minus first two and last two */
-        for (y = 2; y < height-2; y++) {
-            for (x = 0; x < width; x++) {
-                const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-                const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-                if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, 2))
-                    cmkp[x] = 0xff;
-            }
-            srcp += src_linesize;
+
+        for (y = slice_start; y < slice_end; y++) {
+            const uint8_t *srcp = src->data[plane] + y * src_linesize;
+            /* the filter taps are mirrored on the first and last two lines */
+            const int m1 = y > 0          ?   -src_linesize :    src_linesize;
+            const int p1 = y < height - 1 ?    src_linesize :   -src_linesize;
+            const int m2 = y > 1          ? -2*src_linesize :  2*src_linesize;
+            const int p2 = y < height - 2 ?  2*src_linesize : -2*src_linesize;
+
+            fm->dsp.comb_line(cmkp, srcp, srcp + m1, srcp + p1,
+                              srcp + m2, srcp + p2, width, cthresh);
             cmkp += cmk_linesize;
         }
+    }
+    return 0;
+}
+
+#define C_ARRAY_ADD(v) do {                         \
+    const int box1 = (x / blockx) * 4;              \
+    const int box2 = ((x + xhalf) / blockx) * 4;    \
+    c_array[temp1 + box1    ] += v;                 \
+    c_array[temp1 + box2 + 1] += v;                 \
+    c_array[temp2 + box1 + 2] += v;                 \
+    c_array[temp2 + box2 + 3] += v;                 \
+} while (0)
 
-        /* before-last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
-                cmkp[x] = 0xff;
+#define VERTICAL_HALF(y_start, y_end) do {                                  \
+    for (y = y_start; y < y_end; y++) {                                     \
+        const int temp1 = (y / blocky) * xblocks4;                          \
+        const int temp2 = ((y + yhalf) / blocky) * xblocks4;                \
+        for (x = 0; x < width; x++)                                         \
+            if (cmkp[x - cmk_linesize] == 0xff &&                           \
+                cmkp[x               ] == 0xff &&                           \
+                cmkp[x + cmk_linesize] == 0xff)                             \
+                C_ARRAY_ADD(1);                                             \
+        cmkp += cmk_linesize;                                               \
+    }                                                                       \
+} while (0)
+
+#define COMB_BLOCK_GEOMETRY(src)                                \
+    const int blockx = fm->blockx;                              \
+    const int blocky = fm->blocky;                              \
+    const int xhalf = blockx/2;                                 \
+    const int yhalf = blocky/2;                                 \
+    const int cmk_linesize = fm->cmask_linesize[0];             \
+    const int width  = src->width;                              \
+    const int height = src->height;                             \
+    const int xblocks = ((width+xhalf)/blockx) + 1;             \
+    const int xblocks4 = xblocks<<2;                            \
+    const int yblocks = ((height+yhalf)/blocky) + 1;            \
+    const int arraysize = (xblocks*yblocks)<<2;                 \
+    const int heighta = (height/yhalf)*yhalf == height ?        \
+                        height - yhalf : (height/yhalf)*yhalf
+
+/**
+ * Count the combed pixels of the half-block aligned rows into the block
+ * counter array of the job; the arrays are summed up by the caller.
+ */
+static int comb_count_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const AVFrame *src = arg;
+    int x, y, band;
+    COMB_BLOCK_GEOMETRY(src);
+    const int widtha = (width /(blockx/2))*(blockx/2);
+    const int nb_bands = FFMAX(heighta / yhalf - 1, 0);
+    const int band_start = (nb_bands *  jobnr   ) / nb_jobs;
+    const int band_end   = (nb_bands * (jobnr+1)) / nb_jobs;
+    int *c_array = fm->c_array + jobnr * fm->c_array_size;
+
+    memset(c_array, 0, arraysize * sizeof(*c_array));
+
+    for (band = band_start; band < band_end; band++) {
+        const uint8_t *cmkp;
+        int temp1, temp2;
+
+        y = (band + 1) * yhalf;
+        cmkp  = fm->cmask_data[0] + y * cmk_linesize;
+        temp1 = (y / blocky) * xblocks4;
+        temp2 = ((y + yhalf) / blocky) * xblocks4;
+
+        for (x = 0; x < widtha; x += xhalf) {
+            const uint8_t *cmkp_tmp = cmkp + x;
+            int u, v, sum = 0;
+            for (u = 0; u < yhalf; u++) {
+                for (v = 0; v < xhalf; v++)
+                    if (cmkp_tmp[v - cmk_linesize] == 0xff &&
+                        cmkp_tmp[v               ] == 0xff &&
+                        cmkp_tmp[v + cmk_linesize] == 0xff)
+                        sum++;
+                cmkp_tmp += cmk_linesize;
+            }
+            if (sum)
+                C_ARRAY_ADD(sum);
         }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            if (s1 > cthresh && FILTER(-2, -1, -1, -2))
-                cmkp[x] = 0xff;
+
+        for (x = widtha; x < width; x++) {
+            const uint8_t *cmkp_tmp = cmkp + x;
+            int u, sum = 0;
+            for (u = 0; u < yhalf; u++) {
+                if (cmkp_tmp[-cmk_linesize] == 0xff &&
+                    cmkp_tmp[            0] == 0xff &&
+                    cmkp_tmp[ cmk_linesize] == 0xff)
+                    sum++;
+                cmkp_tmp += cmk_linesize;
+            }
+            if (sum)
+                C_ARRAY_ADD(sum);
         }
     }
+    return 0;
+}
+
+static int calc_combed_score(AVFilterContext *ctx, const AVFrame *src)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    int x, y, max_v = 0;
+    int nb_jobs = FFMIN(fm->nb_threads, get_height(fm, src, fm->chroma ? 1 : 0));
+
+    ctx->internal->execute(ctx, comb_mask_slice, (void *)src, NULL, FFMAX(nb_jobs, 1));
 
     if (fm->chroma) {
         uint8_t *cmkp  = fm->cmask_data[0];
@@ -300,87 +409,24 @@ static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
     }
 
     {
-        const int blockx = fm->blockx;
-        const int blocky = fm->blocky;
-        const int xhalf = blockx/2;
-        const int yhalf = blocky/2;
-        const int cmk_linesize = fm->cmask_linesize[0];
-        const uint8_t *cmkp    = fm->cmask_data[0] + cmk_linesize;
-        const int width  = src->width;
-        const int height = src->height;
-        const int xblocks = ((width+xhalf)/blockx) + 1;
-        const int xblocks4 = xblocks<<2;
-        const int yblocks = ((height+yhalf)/blocky) + 1;
+        COMB_BLOCK_GEOMETRY(src);
+        const uint8_t *cmkp = fm->cmask_data[0] + cmk_linesize;
         int *c_array = fm->c_array;
-        const int arraysize = (xblocks*yblocks)<<2;
-        int      heighta = (height/(blocky/2))*(blocky/2);
-        const int widtha = (width /(blockx/2))*(blockx/2);
-        if (heighta == height)
-            heighta = height - yhalf;
-        memset(c_array, 0, arraysize * sizeof(*c_array));
+        int i;
 
-#define C_ARRAY_ADD(v) do {                         \
-    const int box1 = (x / blockx) * 4;              \
-    const int box2 = ((x + xhalf) / blockx) * 4;    \
-    c_array[temp1 + box1    ] += v;                 \
-    c_array[temp1 + box2 + 1] += v;                 \
-    c_array[temp2 + box1 + 2] += v;                 \
-    c_array[temp2 + box2 + 3] += v;                 \
-} while (0)
-
-#define VERTICAL_HALF(y_start, y_end) do {                                  \
-    for (y = y_start; y < y_end; y++) {                                     \
-        const int temp1 = (y / blocky) * xblocks4;                          \
-        const int temp2 = ((y + yhalf) / blocky) * xblocks4;                \
-        for (x = 0; x < width; x++)                                         \
-            if (cmkp[x - cmk_linesize] == 0xff &&                           \
-                cmkp[x               ] == 0xff &&                           \
-                cmkp[x + cmk_linesize] == 0xff)                             \
-                C_ARRAY_ADD(1);                                             \
-        cmkp += cmk_linesize;                                               \
-    }                                                                       \
-} while (0)
+        nb_jobs = FFMAX(FFMIN(fm->nb_threads, heighta / yhalf - 1), 1);
+        ctx->internal->execute(ctx, comb_count_slice, (void *)src, NULL, nb_jobs);
 
+        /* the top and bottom rows not covered by the slice jobs */
         VERTICAL_HALF(1, yhalf);
-
-        for (y = yhalf; y < heighta; y += yhalf) {
-            const int temp1 = (y / blocky) * xblocks4;
-            const int temp2 = ((y + yhalf) / blocky) * xblocks4;
-
-            for (x = 0; x < widtha; x += xhalf) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, v, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    for (v = 0; v < xhalf; v++)
-                        if (cmkp_tmp[v - cmk_linesize] == 0xff &&
-                            cmkp_tmp[v               ] == 0xff &&
-                            cmkp_tmp[v + cmk_linesize] == 0xff)
-                            sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
-            }
-
-            for (x = widtha; x < width; x++) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    if (cmkp_tmp[-cmk_linesize] == 0xff &&
-                        cmkp_tmp[            0] == 0xff &&
-                        cmkp_tmp[ cmk_linesize] == 0xff)
-                        sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
-            }
-
-            cmkp += cmk_linesize * yhalf;
-        }
-
+        cmkp += cmk_linesize * yhalf * FFMAX(heighta / yhalf - 1, 0);
         VERTICAL_HALF(heighta, height - 1);
 
+        for (i = 1; i < nb_jobs; i++) {
+            const int *c_array_job = fm->c_array + i * fm->c_array_size;
+            for (x = 0; x < arraysize; x++)
+                c_array[x] += c_array_job[x];
+        }
         for (x = 0; x < arraysize; x++)
             if (c_array[x] > max_v)
                 max_v = c_array[x];
@@ -388,84 +434,232 @@ static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
     return max_v;
 }
 
+typedef struct DiffThreadData {
+    const uint8_t *prvp, *nxtp;     ///< first line of the fields to compare
+    int prv_linesize, nxt_linesize; ///< field line sizes
+    const uint8_t *srcpf, *prvpf, *nxtpf;
+    int srcf_linesize, prvf_linesize, nxtf_linesize;
+    uint8_t *mapp;                  ///< start of the field map pair
+    uint8_t *dmapp;                 ///< field of the map written by build_diff_map
+    int map_linesize;
+    int width, height, tpitch;
+    int y0a, y1a, startx, stopx;
+    uint64_t accum[MAX_THREADS][6];
+} DiffThreadData;
+
+enum { ACC_PC, ACC_PM, ACC_PML, ACC_NC, ACC_NM, ACC_NML };
+
 // the secret is that tbuffer is an interlaced, offset subset of all the lines
-static void build_abs_diff_mask(const uint8_t *prvp, int prv_linesize,
-                                const uint8_t *nxtp, int nxt_linesize,
-                                uint8_t *tbuffer,    int tbuf_linesize,
-                                int width, int height)
+static int build_abs_diff_mask(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int y, x;
+    const FieldMatchContext *fm = ctx->priv;
+    const DiffThreadData *td = arg;
+    const int height = td->height >> 1;
+    const int slice_start = (height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+    const uint8_t *prvp = td->prvp + (slice_start - 1) * td->prv_linesize;
+    const uint8_t *nxtp = td->nxtp + (slice_start - 1) * td->nxt_linesize;
+    uint8_t *tbuffer = fm->tbuffer + slice_start * td->tpitch;
+    int y;
 
-    prvp -= prv_linesize;
-    nxtp -= nxt_linesize;
-    for (y = 0; y < height; y++) {
-        for (x = 0; x < width; x++)
-            tbuffer[x] = FFABS(prvp[x] - nxtp[x]);
-        prvp += prv_linesize;
-        nxtp += nxt_linesize;
-        tbuffer += tbuf_linesize;
+    for (y = slice_start; y < slice_end; y++) {
+        fm->dsp.abs_diff_line(tbuffer, prvp, nxtp, td->width);
+        prvp += td->prv_linesize;
+        nxtp += td->nxt_linesize;
+        tbuffer += td->tpitch;
     }
+    return 0;
 }
 
 /**
- * Build a map over which pixels differ a lot/a little
+ * Compute the difference map entry of pixel x: bit 0 is set if the pixel
+ * differs a little, bits 1 and 2 if it differs a lot. The wider search for
+ * big differences spans [ustart, uend).
  */
-static void build_diff_map(FieldMatchContext *fm,
-                           const uint8_t *prvp, int prv_linesize,
-                           const uint8_t *nxtp, int nxt_linesize,
-                           uint8_t *dstp, int dst_linesize, int height,
-                           int width, int plane)
+static av_always_inline int diff_map_pixel(const uint8_t *dp, int tpitch, int x,
+                                           int ustart, int uend, int up2, int lo2)
 {
-    int x, y, u, diff, count;
-    int tpitch = plane ? fm->tpitchuv : fm->tpitchy;
-    const uint8_t *dp = fm->tbuffer + tpitch;
-
-    build_abs_diff_mask(prvp, prv_linesize, nxtp, nxt_linesize,
-                        fm->tbuffer, tpitch, width, height>>1);
-
-    for (y = 2; y < height - 2; y += 2) {
-        for (x = 1; x < width - 1; x++) {
-            diff = dp[x];
-            if (diff > 3) {
-                for (count = 0, u = x-1; u < x+2 && count < 2; u++) {
-                    count += dp[u-tpitch] > 3;
-                    count += dp[u       ] > 3;
-                    count += dp[u+tpitch] > 3;
+    int u, count, ret = 0;
+    const int diff = dp[x];
+
+    if (diff > 3) {
+        for (count = 0, u = x-1; u < x+2 && count < 2; u++) {
+            count += dp[u-tpitch] > 3;
+            count += dp[u       ] > 3;
+            count += dp[u+tpitch] > 3;
+        }
+        if (count > 1) {
+            ret = 1;
+            if (diff > 19) {
+                int upper = 0, lower = 0;
+                for (count = 0, u = x-1; u < x+2 && count < 6; u++) {
+                    if (dp[u-tpitch] > 19) { count++; upper = 1; }
+                    if (dp[u       ] > 19)   count++;
+                    if (dp[u+tpitch] > 19) { count++; lower = 1; }
                 }
-                if (count > 1) {
-                    dstp[x] = 1;
-                    if (diff > 19) {
-                        int upper = 0, lower = 0;
-                        for (count = 0, u = x-1; u < x+2 && count < 6; u++) {
-                            if (dp[u-tpitch] > 19) { count++; upper = 1; }
-                            if (dp[u       ] > 19)   count++;
-                            if (dp[u+tpitch] > 19) { count++; lower = 1; }
-                        }
-                        if (count > 3) {
-                            if (upper && lower) {
-                                dstp[x] |= 1<<1;
-                            } else {
-                                int upper2 = 0, lower2 = 0;
-                                for (u = FFMAX(x-4,0); u < FFMIN(x+5,width); u++) {
-                                    if (y != 2 &&        dp[u-2*tpitch] > 19) upper2 = 1;
-                                    if (                 dp[u-  tpitch] > 19) upper  = 1;
-                                    if (                 dp[u+  tpitch] > 19) lower  = 1;
-                                    if (y != height-4 && dp[u+2*tpitch] > 19) lower2 = 1;
-                                }
-                                if ((upper && (lower || upper2)) ||
-                                    (lower && (upper || lower2)))
-                                    dstp[x] |= 1<<1;
-                                else if (count > 5)
-                                    dstp[x] |= 1<<2;
-                            }
+                if (count > 3) {
+                    if (upper && lower) {
+                        ret |= 1<<1;
+                    } else {
+                        int upper2 = 0, lower2 = 0;
+                        for (u = ustart; u < uend; u++) {
+                            if (up2 && dp[u-2*tpitch] > 19) upper2 = 1;
+                            if (       dp[u-  tpitch] > 19) upper  = 1;
+                            if (       dp[u+  tpitch] > 19) lower  = 1;
+                            if (lo2 && dp[u+2*tpitch] > 19) lower2 = 1;
                         }
+                        if ((upper && (lower || upper2)) ||
+                            (lower && (upper || lower2)))
+                            ret |= 1<<1;
+                        else if (count > 5)
+                            ret |= 1<<2;
                     }
                 }
             }
         }
-        dp += tpitch;
-        dstp += dst_linesize;
     }
+    return ret;
+}
+
+static void diff_map_line_c(uint8_t *dst, const uint8_t *dp, int tpitch,
+                            int w, int up2, int lo2)
+{
+    int x;
+
+    for (x = 0; x < w; x++)
+        dst[x] = diff_map_pixel(dp, tpitch, x, x - 4, x + 5, up2, lo2);
+}
+
+/**
+ * Build a map over which pixels differ a lot/a little
+ */
+static void build_diff_map(const FieldMatchContext *fm,
+                           const uint8_t *dp, int tpitch, uint8_t *dstp,
+                           int y, int height, int width)
+{
+    int x;
+    const int up2 = y != 2;
+    const int lo2 = y != height - 4;
+    /* the DSP function does not clip the search window to the line */
+    const int simd_w = FFMAX(width - 8, 0) & ~15;
+
+    for (x = 1; x < FFMIN(4, width - 1); x++)
+        dstp[x] = diff_map_pixel(dp, tpitch, x, FFMAX(x-4,0), FFMIN(x+5,width), up2, lo2);
+    fm->dsp.diff_map_line(dstp + 4, dp + 4, tpitch, simd_w, up2, lo2);
+    for (x = 4 + simd_w; x < width - 1; x++)
+        dstp[x] = diff_map_pixel(dp, tpitch, x, FFMAX(x-4,0), FFMIN(x+5,width), up2, lo2);
+}
+
+static void compare_line_c(const uint8_t *src, ptrdiff_t src_stride,
+                           const uint8_t *prv, ptrdiff_t prv_stride,
+                           const uint8_t *nxt, ptrdiff_t nxt_stride,
+                           const uint8_t *map, ptrdiff_t map_stride,
+                           int w, uint64_t *accum)
+{
+    int x, temp1, temp2;
+    const uint8_t *srcpf = src, *srcf = src + src_stride, *srcnf = src + 2 * src_stride;
+    const uint8_t *prvpf = prv, *prvnf = prv + prv_stride;
+    const uint8_t *nxtpf = nxt, *nxtnf = nxt + nxt_stride;
+    uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
+    uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
+
+    for (x = 0; x < w; x++) {
+        const int m = map[x] | map[x + map_stride];
+
+        if (m) {
+            temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
+
+            temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
+            if (temp2 > 23 && (m&1))
+                accumPc += temp2;
+            if (temp2 > 42) {
+                if (m&2)
+                    accumPm += temp2;
+                if (m&4)
+                    accumPml += temp2;
+            }
+
+            temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
+            if (temp2 > 23 && (m&1))
+                accumNc += temp2;
+            if (temp2 > 42) {
+                if (m&2)
+                    accumNm += temp2;
+                if (m&4)
+                    accumNml += temp2;
+            }
+        }
+    }
+
+    accum[ACC_PC]  += accumPc;
+    accum[ACC_PM]  += accumPm;
+    accum[ACC_PML] += accumPml;
+    accum[ACC_NC]  += accumNc;
+    accum[ACC_NM]  += accumNm;
+    accum[ACC_NML] += accumNml;
+}
+
+static int build_diff_map_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const DiffThreadData *td = arg;
+    const int nb_lines = FFMAX((td->height - 3) / 2, 0);
+    const int slice_start = (nb_lines *  jobnr   ) / nb_jobs;
+    const int slice_end   = (nb_lines * (jobnr+1)) / nb_jobs;
+    const uint8_t *dp = fm->tbuffer + (slice_start + 1) * td->tpitch;
+    uint8_t *dstp = td->dmapp + slice_start * td->map_linesize;
+    int i;
+
+    for (i = slice_start; i < slice_end; i++) {
+        build_diff_map(fm, dp, td->tpitch, dstp, 2 + 2 * i, td->height, td->width);
+        dp   += td->tpitch;
+        dstp += td->map_linesize;
+    }
+    return 0;
+}
+
+/**
+ * Accumulate the field matching metrics over a slice of field lines. Each
+ * line looks at two consecutive lines of the difference map, so the whole
+ * map must be built beforehand.
+ */
+static int compare_fields_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    DiffThreadData *td = arg;
+    const int nb_lines = FFMAX((td->height - 3) / 2, 0);
+    const int slice_start = (nb_lines *  jobnr   ) / nb_jobs;
+    const int slice_end   = (nb_lines * (jobnr+1)) / nb_jobs;
+    const int startx = td->startx;
+    const int w  = FFMAX(td->stopx - startx, 0);
+    const int w8 = w & ~7;
+    const uint8_t *srcpf = td->srcpf + slice_start * td->srcf_linesize + startx;
+    const uint8_t *prvpf = td->prvpf + slice_start * td->prvf_linesize + startx;
+    const uint8_t *nxtpf = td->nxtpf + slice_start * td->nxtf_linesize + startx;
+    const uint8_t *mapp  = td->mapp  + slice_start * td->map_linesize  + startx;
+    uint64_t *accum = td->accum[jobnr];
+    int i, y;
+
+    memset(accum, 0, sizeof(td->accum[jobnr]));
+
+    for (i = slice_start; i < slice_end; i++) {
+        y = 2 + 2 * i;
+        if (td->y0a == td->y1a || y < td->y0a || y > td->y1a) {
+            fm->dsp.compare_line(srcpf, td->srcf_linesize,
+                                 prvpf, td->prvf_linesize,
+                                 nxtpf, td->nxtf_linesize,
+                                 mapp,  td->map_linesize, w8, accum);
+            compare_line_c(srcpf + w8, td->srcf_linesize,
+                           prvpf + w8, td->prvf_linesize,
+                           nxtpf + w8, td->nxtf_linesize,
+                           mapp  + w8, td->map_linesize, w - w8, accum);
+        }
+        srcpf += td->srcf_linesize;
+        prvpf += td->prvf_linesize;
+        nxtpf += td->nxtf_linesize;
+        mapp  += td->map_linesize;
+    }
+    return 0;
 }
 
 enum { mP, mC, mN, mB, mU };
@@ -482,17 +676,19 @@ static AVFrame *select_frame(FieldMatchContext *fm, int match)
     else  /* match == mC */              return fm->src;
 }
 
-static int compare_fields(FieldMatchContext *fm, int match1, int match2, int field)
+static int compare_fields(AVFilterContext *ctx, int match1, int match2, int field)
 {
+    FieldMatchContext *fm = ctx->priv;
     int plane, ret;
     uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
     uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
     int norm1, norm2, mtn1, mtn2;
     float c1, c2, mr;
     const AVFrame *src = fm->src;
+    DiffThreadData td;
 
     for (plane = 0; plane < (fm->mchroma ? 3 : 1); plane++) {
-        int x, y, temp1, temp2, fbase;
+        int i, fbase, nb_jobs;
         const AVFrame *prev, *next;
         uint8_t *mapp    = fm->map_data[plane];
         int map_linesize = fm->map_linesize[plane];
@@ -503,11 +699,7 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         int prvf_linesize, nxtf_linesize;
         const int width  = get_width (fm, src, plane);
         const int height = get_height(fm, src, plane);
-        const int y0a = fm->y0 >> (plane != 0);
-        const int y1a = fm->y1 >> (plane != 0);
-        const int startx = (plane == 0 ? 8 : 4);
-        const int stopx  = width - startx;
-        const uint8_t *srcpf, *srcf, *srcnf;
+        const uint8_t *srcpf, *srcf;
         const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
 
         fill_buf(mapp, width, height, map_linesize, 0);
@@ -516,7 +708,6 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         fbase = get_field_base(match1, field);
         srcf  = srcp + (fbase + 1) * src_linesize;
         srcpf = srcf - srcf_linesize;
-        srcnf = srcf + srcf_linesize;
         mapp  = mapp + fbase * map_linesize;
         prev = select_frame(fm, match1);
         prv_linesize  = prev->linesize[plane];
@@ -533,49 +724,47 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         nxtnf = nxtpf + nxtf_linesize;                      // next frame, next     field
 
         map_linesize <<= 1;
-        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1))
-            build_diff_map(fm, prvpf, prvf_linesize, nxtpf, nxtf_linesize,
-                           mapp, map_linesize, height, width, plane);
-        else
-            build_diff_map(fm, prvnf, prvf_linesize, nxtnf, nxtf_linesize,
-                           mapp + map_linesize, map_linesize, height, width, plane);
-
-        for (y = 2; y < height - 2; y += 2) {
-            if (y0a == y1a || y < y0a || y > y1a) {
-                for (x = startx; x < stopx; x++) {
-                    if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
-                        temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
-
-                        temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumPc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumPm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumPml += temp2;
-                        }
-
-                        temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumNc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumNm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumNml += temp2;
-                        }
-                    }
-                }
-            }
-            prvpf += prvf_linesize;
-            prvnf += prvf_linesize;
-            srcpf += srcf_linesize;
-            srcf  += srcf_linesize;
-            srcnf += srcf_linesize;
-            nxtpf += nxtf_linesize;
-            nxtnf += nxtf_linesize;
-            mapp  += map_linesize;
+        td.prv_linesize = prvf_linesize;
+        td.nxt_linesize = nxtf_linesize;
+        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1)) {
+            td.prvp  = prvpf;
+            td.nxtp  = nxtpf;
+            td.dmapp = mapp;
+        } else {
+            td.prvp  = prvnf;
+            td.nxtp  = nxtnf;
+            td.dmapp = mapp + map_linesize;
+        }
+        td.srcpf = srcpf;
+        td.prvpf = prvpf;
+        td.nxtpf = nxtpf;
+        td.srcf_linesize = srcf_linesize;
+        td.prvf_linesize = prvf_linesize;
+        td.nxtf_linesize = nxtf_linesize;
+        td.mapp          = mapp;
+        td.map_linesize  = map_linesize;
+        td.width         = width;
+        td.height        = height;
+        td.tpitch        = plane ? fm->tpitchuv : fm->tpitchy;
+        td.y0a           = fm->y0 >> (plane != 0);
+        td.y1a           = fm->y1 >> (plane != 0);
+        td.startx        = plane == 0 ? 8 : 4;
+        td.stopx         = width - td.startx;
+
+        nb_jobs = FFMAX(FFMIN(fm->nb_threads, height >> 1), 1);
+        ctx->internal->execute(ctx, build_abs_diff_mask, &td, NULL, nb_jobs);
+
+        nb_jobs = FFMAX(FFMIN(fm->nb_threads, (height - 3) / 2), 1);
+        ctx->internal->execute(ctx, build_diff_map_slice, &td, NULL, nb_jobs);
+        ctx->internal->execute(ctx, compare_fields_slice, &td, NULL, nb_jobs);
+
+        for (i = 0; i < nb_jobs; i++) {
+            accumPc  += td.accum[i][ACC_PC];
+            accumPm  += td.accum[i][ACC_PM];
+            accumPml += td.accum[i][ACC_PML];
+            accumNc  += td.accum[i][ACC_NC];
+            accumNm  += td.accum[i][ACC_NM];
+            accumNml += td.accum[i][ACC_NML];
         }
     }
 
@@ -651,7 +840,7 @@ static int checkmm(AVFilterContext *ctx, int *combs, int m1, int m2,
         if (!gen_frames[mid])                                                   \
             gen_frames[mid] = create_weave_frame(ctx, mid, field,               \
                                                  fm->prv, fm->src, fm->nxt);    \
-        combs[mid] = calc_combed_score(fm, gen_frames[mid]);                    \
+        combs[mid] = calc_combed_score(ctx, gen_frames[mid]);                    \
     }                                                                           \
 } while (0)
 
@@ -720,7 +909,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
             gen_frames[i] = create_weave_frame(ctx, i, field, fm->prv, fm->src, fm->nxt);
             if (!gen_frames[i])
                 return AVERROR(ENOMEM);
-            combs[i] = calc_combed_score(fm, gen_frames[i]);
+            combs[i] = calc_combed_score(ctx, gen_frames[i]);
         }
         av_log(ctx, AV_LOG_INFO, "COMBS: %3d %3d %3d %3d %3d\n",
                combs[0], combs[1], combs[2], combs[3], combs[4]);
@@ -731,22 +920,22 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
 
     /* p/c selection and optional 3-way p/c/n matches */
-    match = compare_fields(fm, fxo[mC], fxo[mP], field);
+    match = compare_fields(ctx, fxo[mC], fxo[mP], field);
     if (fm->mode == MODE_PCN || fm->mode == MODE_PCN_UB)
-        match = compare_fields(fm, match, fxo[mN], field);
+        match = compare_fields(ctx, match, fxo[mN], field);
 
     /* scene change check */
     if (fm->combmatch == COMBMATCH_SC) {
         if (fm->lastn == outlink->frame_count - 1) {
             if (fm->lastscdiff > fm->scthresh)
                 sc = 1;
-        } else if (luma_abs_diff(fm->prv, fm->src) > fm->scthresh) {
+        } else if (luma_abs_diff(fm, fm->prv, fm->src) > fm->scthresh) {
             sc = 1;
         }
 
         if (!sc) {
             fm->lastn = outlink->frame_count;
-            fm->lastscdiff = luma_abs_diff(fm->src, fm->nxt);
+            fm->lastscdiff = luma_abs_diff(fm, fm->src, fm->nxt);
             sc = fm->lastscdiff > fm->scthresh;
         }
     }
@@ -878,12 +1067,15 @@ static int config_input(AVFilterLink *inlink)
     fm->vsub = pix_desc->log2_chroma_h;
 
     fm->tpitchy  = FFALIGN(w,      16);
-    fm->tpitchuv = FFALIGN(w >> 1, 16);
+    fm->tpitchuv = FFALIGN(FF_CEIL_RSHIFT(w, fm->hsub), 16);
+
+    fm->nb_threads   = FFMAX(FFMIN(MAX_THREADS, ctx->graph->nb_threads), 1);
+    fm->c_array_size = (((w + fm->blockx/2)/fm->blockx)+1) *
+                       (((h + fm->blocky/2)/fm->blocky)+1) * 4;
 
     fm->tbuffer = av_malloc(h/2 * fm->tpitchy);
-    fm->c_array = av_malloc((((w + fm->blockx/2)/fm->blockx)+1) *
-                            (((h + fm->blocky/2)/fm->blocky)+1) *
-                            4 * sizeof(*fm->c_array));
+    fm->c_array = av_malloc_array(fm->nb_threads,
+                                  fm->c_array_size * sizeof(*fm->c_array));
     if (!fm->tbuffer || !fm->c_array)
         return AVERROR(ENOMEM);
 
@@ -892,7 +1084,7 @@ static int config_input(AVFilterLink *inlink)
 
 static av_cold int fieldmatch_init(AVFilterContext *ctx)
 {
-    const FieldMatchContext *fm = ctx->priv;
+    FieldMatchContext *fm = ctx->priv;
     AVFilterPad pad = {
         .name         = av_strdup("main"),
         .type         = AVMEDIA_TYPE_VIDEO,
@@ -923,6 +1115,14 @@ static av_cold int fieldmatch_init(AVFilterContext *ctx)
         return AVERROR(EINVAL);
     }
 
+    fm->dsp.abs_diff_line = abs_diff_line_c;
+    fm->dsp.sad_line      = sad_line_c;
+    fm->dsp.comb_line     = comb_line_c;
+    fm->dsp.diff_map_line = diff_map_line_c;
+    fm->dsp.compare_line  = compare_line_c;
+    if (ARCH_X86)
+        ff_fieldmatch_init_x86(&fm->dsp);
+
     return 0;
 }
 
@@ -980,5 +1180,5 @@ AVFilter ff_vf_fieldmatch = {
     .inputs         = NULL,
     .outputs        = fieldmatch_outputs,
     .priv_class     = &fieldmatch_class,
-    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -0,0 +1,75 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_FIELDMATCH_H
+#define AVFILTER_FIELDMATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct FieldMatchDSPContext {
+    /**
+     * Set dst[x] to |a[x] - b[x]| for x in [0, w).
+     */
+    void (*abs_diff_line)(uint8_t *dst, const uint8_t *a, const uint8_t *b, int w);
+
+    /**
+     * Return the sum of |a[x] - b[x]| for x in [0, w).
+     */
+    int (*sad_line)(const uint8_t *a, const uint8_t *b, int w);
+
+    /**
+     * Compute one line of the combing mask. dst[x] is set to 0xff if cur[x]
+     * differs from both p1[x] and n1[x] by more than cthresh and the
+     * [1 -3 4 -3 1] vertical filter over p2, p1, cur, n1, n2 exceeds
+     * 6 * cthresh, and to 0 otherwise. Edge lines are handled by the caller
+     * by mirroring the tap pointers. cthresh must be in [0, 255].
+     */
+    void (*comb_line)(uint8_t *dst, const uint8_t *cur,
+                      const uint8_t *p1, const uint8_t *n1,
+                      const uint8_t *p2, const uint8_t *n2,
+                      int w, int cthresh);
+
+    /**
+     * Compute w entries of one line of the field difference map from the
+     * absolute difference lines dp - 2 * tpitch ... dp + 2 * tpitch. Lines
+     * dp - 2 * tpitch and dp + 2 * tpitch are only read if up2 and lo2 are
+     * set, respectively. dp[-4] and dp[w + 3] must be readable on all lines.
+     * w must be a multiple of 16.
+     */
+    void (*diff_map_line)(uint8_t *dst, const uint8_t *dp, int tpitch,
+                          int w, int up2, int lo2);
+
+    /**
+     * Accumulate the field matching metrics of w pixels of one field line
+     * into accum[0..5] (Pc, Pm, Pml, Nc, Nm, Nml). The [1 4 1] filtered
+     * source lines src, src + src_stride and src + 2 * src_stride are
+     * compared with the sum of two consecutive lines of both the prv and nxt
+     * fields wherever map[x] | map[x + map_stride] is not 0.
+     * w must be a multiple of 8.
+     */
+    void (*compare_line)(const uint8_t *src, ptrdiff_t src_stride,
+                         const uint8_t *prv, ptrdiff_t prv_stride,
+                         const uint8_t *nxt, ptrdiff_t nxt_stride,
+                         const uint8_t *map, ptrdiff_t map_stride,
+                         int w, uint64_t *accum);
+} FieldMatchDSPContext;
+
+void ff_fieldmatch_init_x86(FieldMatchDSPContext *dsp);
+
+#endif /* AVFILTER_FIELDMATCH_H */
@@ -120,8 +120,127 @@ static void denoise_spatial(HQDN3DContext *s,
     }
 }
 
+/*
+ * The spatial filter runs a horizontal IIR filter over each row and a
+ * vertical one over each column of the result. The rows can be filtered
+ * independently of each other, and so can the columns once all rows are
+ * done, so the threaded version runs the horizontal pass over bands of rows
+ * and then the vertical and the temporal passes over bands of columns.
+ * Each column band owns its part of line_ant and frame_ant, which keeps the
+ * output identical to the serial version.
+ */
+av_always_inline
+static void denoise_spatial_rows(uint8_t *src, uint32_t *row_ant,
+                                 int w, int y0, int y1, int sstride,
+                                 int16_t *spatial, int depth)
+{
+    long x, y;
+    uint32_t pixel_ant;
+
+    spatial += 256 << LUT_BITS;
+
+    src     += y0 * sstride;
+    row_ant += y0 * w;
+    for (y = y0; y < y1; y++) {
+        /* the first line also filters its first pixel with itself */
+        pixel_ant = LOAD(0);
+        if (!y)
+            pixel_ant = lowpass(pixel_ant, LOAD(0), spatial, depth);
+        row_ant[0] = pixel_ant;
+        for (x = 1; x < w; x++)
+            row_ant[x] = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial, depth);
+        src     += sstride;
+        row_ant += w;
+    }
+}
+
+av_always_inline
+static void denoise_spatial_cols(uint32_t *row_ant, uint8_t *dst,
+                                 uint16_t *line_ant, uint16_t *frame_ant,
+                                 int w, int h, int x0, int x1, int dstride,
+                                 int16_t *spatial, int16_t *temporal, int depth)
+{
+    long x, y;
+    uint32_t tmp;
+
+    spatial  += 256 << LUT_BITS;
+    temporal += 256 << LUT_BITS;
+
+    for (x = x0; x < x1; x++) {
+        line_ant[x] = tmp = row_ant[x];
+        frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+        STORE(x, tmp);
+    }
+
+    for (y = 1; y < h; y++) {
+        row_ant   += w;
+        dst       += dstride;
+        frame_ant += w;
+        for (x = x0; x < x1; x++) {
+            line_ant[x] = tmp = lowpass(line_ant[x], row_ant[x], spatial, depth);
+            frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+            STORE(x, tmp);
+        }
+    }
+}
+
+typedef struct ThreadData {
+    uint8_t *src, *dst;
+    uint16_t *line_ant, *frame_ant;
+    uint32_t *row_ant;
+    int w, h, sstride, dstride;
+    int16_t *spatial, *temporal;
+} ThreadData;
+
+#define DEPTH_SWITCH(depth, func, ...)                                        \
+    switch (depth) {                                                          \
+    case  8: func(__VA_ARGS__,  8); break;                                    \
+    case  9: func(__VA_ARGS__,  9); break;                                    \
+    case 10: func(__VA_ARGS__, 10); break;                                    \
+    case 16: func(__VA_ARGS__, 16); break;                                    \
+    }
+
+static int temporal_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HQDN3DContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int y0 = (td->h *  jobnr     ) / nb_jobs;
+    const int y1 = (td->h * (jobnr + 1)) / nb_jobs;
+
+    DEPTH_SWITCH(s->depth, denoise_temporal,
+                 td->src + y0 * td->sstride, td->dst + y0 * td->dstride,
+                 td->frame_ant + y0 * td->w, td->w, y1 - y0,
+                 td->sstride, td->dstride, td->temporal);
+    return 0;
+}
+
+static int spatial_rows_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HQDN3DContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int y0 = (td->h *  jobnr     ) / nb_jobs;
+    const int y1 = (td->h * (jobnr + 1)) / nb_jobs;
+
+    DEPTH_SWITCH(s->depth, denoise_spatial_rows,
+                 td->src, td->row_ant, td->w, y0, y1, td->sstride, td->spatial);
+    return 0;
+}
+
+static int spatial_cols_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HQDN3DContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const int x0 = (td->w *  jobnr     ) / nb_jobs;
+    const int x1 = (td->w * (jobnr + 1)) / nb_jobs;
+
+    DEPTH_SWITCH(s->depth, denoise_spatial_cols,
+                 td->row_ant, td->dst, td->line_ant, td->frame_ant,
+                 td->w, td->h, x0, x1, td->dstride, td->spatial, td->temporal);
+    return 0;
+}
+
 av_always_inline
-static int denoise_depth(HQDN3DContext *s,
+static int denoise_depth(AVFilterContext *ctx, HQDN3DContext *s,
                          uint8_t *src, uint8_t *dst,
                          uint16_t *line_ant, uint16_t **frame_ant_ptr,
                          int w, int h, int sstride, int dstride,
@@ -143,7 +262,27 @@ static int denoise_depth(HQDN3DContext *s,
         frame_ant = *frame_ant_ptr;
     }
 
-    if (spatial[0])
+    if (s->row_prev) {
+        ThreadData td = {
+            .src      = src,       .dst       = dst,
+            .line_ant = line_ant,  .frame_ant = frame_ant,
+            .row_ant  = s->row_prev,
+            .w        = w,         .h         = h,
+            .sstride  = sstride,   .dstride   = dstride,
+            .spatial  = spatial,   .temporal  = temporal,
+        };
+        int nb_threads = ctx->graph->nb_threads;
+
+        if (spatial[0]) {
+            ctx->internal->execute(ctx, spatial_rows_slice, &td, NULL,
+                                   FFMIN(h, nb_threads));
+            ctx->internal->execute(ctx, spatial_cols_slice, &td, NULL,
+                                   FFMAX(FFMIN(w / 16, nb_threads), 1));
+        } else {
+            ctx->internal->execute(ctx, temporal_slice, &td, NULL,
+                                   FFMIN(h, nb_threads));
+        }
+    } else if (spatial[0])
         denoise_spatial(s, src, dst, line_ant, frame_ant,
                         w, h, sstride, dstride, spatial, temporal, depth);
     else
@@ -224,6 +363,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->coefs[2]);
     av_freep(&s->coefs[3]);
     av_freep(&s->line);
+    av_freep(&s->row_prev);
     av_freep(&s->frame_prev[0]);
     av_freep(&s->frame_prev[1]);
     av_freep(&s->frame_prev[2]);
@@ -261,7 +401,8 @@ static int query_formats(AVFilterContext *ctx)
 
 static int config_input(AVFilterLink *inlink)
 {
-    HQDN3DContext *s = inlink->dst->priv;
+    AVFilterContext *ctx = inlink->dst;
+    HQDN3DContext *s = ctx->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
     int i;
 
@@ -275,6 +416,12 @@ static int config_input(AVFilterLink *inlink)
     if (!s->line)
         return AVERROR(ENOMEM);
 
+    if (ctx->graph->nb_threads > 1) {
+        s->row_prev = av_malloc_array(inlink->w, inlink->h * sizeof(*s->row_prev));
+        if (!s->row_prev)
+            return AVERROR(ENOMEM);
+    }
+
     for (i = 0; i < 4; i++) {
         s->coefs[i] = precalc_coefs(s->strength[i], s->depth);
         if (!s->coefs[i])
@@ -309,7 +456,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
 
     for (c = 0; c < 3; c++) {
-        denoise(s, in->data[c], out->data[c],
+        denoise(ctx, s, in->data[c], out->data[c],
                 s->line, &s->frame_prev[c],
                 FF_CEIL_RSHIFT(in->width,  (!!c * s->hsub)),
                 FF_CEIL_RSHIFT(in->height, (!!c * s->vsub)),
@@ -370,5 +517,5 @@ AVFilter ff_vf_hqdn3d = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_hqdn3d_inputs,
     .outputs       = avfilter_vf_hqdn3d_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_SLICE_THREADS,
 };
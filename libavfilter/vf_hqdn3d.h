@@ -33,6 +33,7 @@ typedef struct HQDN3DContext {
     int16_t *coefs[4];
     uint16_t *line;
     uint16_t *frame_prev[3];
+    uint32_t *row_prev;   ///< horizontally filtered rows, used when slice threading
     double strength[4];
     int hsub, vsub;
     int depth;
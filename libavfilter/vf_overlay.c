@@ -358,24 +358,37 @@ static int config_output(AVFilterLink *outlink)
 // ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)) is a faster version of: 255 * (x + y)
 #define UNPREMULTIPLY_ALPHA(x, y) ((((x) << 16) - ((x) << 9) + (x)) / ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)))
 
+typedef struct ThreadData {
+    AVFrame *dst;
+    const AVFrame *src;
+    int x, y;
+} ThreadData;
+
+/* restrict the rows [start, end) to the part handled by job jobnr */
+#define SLICE_ROWS(start, end) do {                                 \
+        const int nb_rows = (end) - (start);                        \
+        end   = (start) + nb_rows * (jobnr + 1) / nb_jobs;          \
+        start = (start) + nb_rows *  jobnr      / nb_jobs;          \
+    } while (0)
+
 /**
- * Blend image in src to destination buffer dst at position (x, y).
+ * Blend a band of rows of the image in src to destination buffer dst at
+ * position (x, y).
  */
-static void blend_image(AVFilterContext *ctx,
-                        AVFrame *dst, const AVFrame *src,
-                        int x, int y)
+static int blend_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     OverlayContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *dst = td->dst;
+    const AVFrame *src = td->src;
+    const int x = td->x;
+    const int y = td->y;
     int i, imax, j, jmax, k, kmax;
     const int src_w = src->width;
     const int src_h = src->height;
     const int dst_w = dst->width;
     const int dst_h = dst->height;
 
-    if (x >= dst_w || x+src_w < 0 ||
-        y >= dst_h || y+src_h < 0)
-        return; /* no intersection */
-
     if (s->main_is_packed_rgb) {
         uint8_t alpha;          ///< the amount of overlay to blend on to main
         const int dr = s->main_rgba_map[R];
@@ -391,11 +404,13 @@ static void blend_image(AVFilterContext *ctx,
         const int main_has_alpha = s->main_has_alpha;
         uint8_t *s, *sp, *d, *dp;
 
-        i = FFMAX(-y, 0);
+        i    = FFMAX(-y, 0);
+        imax = FFMIN(-y + dst_h, src_h);
+        SLICE_ROWS(i, imax);
         sp = src->data[0] + i     * src->linesize[0];
         dp = dst->data[0] + (y+i) * dst->linesize[0];
 
-        for (imax = FFMIN(-y + dst_h, src_h); i < imax; i++) {
+        for (; i < imax; i++) {
             j = FFMAX(-x, 0);
             s = sp + j     * sstep;
             d = dp + (x+j) * dstep;
@@ -449,11 +464,13 @@ static void blend_image(AVFilterContext *ctx,
             uint8_t alpha;          ///< the amount of overlay to blend on to main
             uint8_t *s, *sa, *d, *da;
 
-            i = FFMAX(-y, 0);
+            i    = FFMAX(-y, 0);
+            imax = FFMIN(-y + dst_h, src_h);
+            SLICE_ROWS(i, imax);
             sa = src->data[3] + i     * src->linesize[3];
             da = dst->data[3] + (y+i) * dst->linesize[3];
 
-            for (imax = FFMIN(-y + dst_h, src_h); i < imax; i++) {
+            for (; i < imax; i++) {
                 j = FFMAX(-x, 0);
                 s = sa + j;
                 d = da + x+j;
@@ -492,12 +509,14 @@ static void blend_image(AVFilterContext *ctx,
             int xp = x>>hsub;
             uint8_t *s, *sp, *d, *dp, *a, *ap;
 
-            j = FFMAX(-yp, 0);
+            j    = FFMAX(-yp, 0);
+            jmax = FFMIN(-yp + dst_hp, src_hp);
+            SLICE_ROWS(j, jmax);
             sp = src->data[i] + j         * src->linesize[i];
             dp = dst->data[i] + (yp+j)    * dst->linesize[i];
             ap = src->data[3] + (j<<vsub) * src->linesize[3];
 
-            for (jmax = FFMIN(-yp + dst_hp, src_hp); j < jmax; j++) {
+            for (; j < jmax; j++) {
                 k = FFMAX(-xp, 0);
                 d = dp + xp+k;
                 s = sp + k;
@@ -547,6 +566,31 @@ static void blend_image(AVFilterContext *ctx,
             }
         }
     }
+    return 0;
+}
+
+/**
+ * Blend image in src to destination buffer dst at position (x, y).
+ */
+static void blend_image(AVFilterContext *ctx,
+                        AVFrame *dst, const AVFrame *src,
+                        int x, int y)
+{
+    OverlayContext *s = ctx->priv;
+    ThreadData td = { .dst = dst, .src = src, .x = x, .y = y };
+    int nb_jobs = FFMIN(src->height, ctx->graph->nb_threads);
+
+    if (x >= dst->width  || x+src->width  < 0 ||
+        y >= dst->height || y+src->height < 0)
+        return; /* no intersection */
+
+    // with an alpha plane in the main input, the chroma blending also reads
+    // the destination line below the current one, which must not have been
+    // blended yet
+    if (!s->main_is_packed_rgb && s->main_has_alpha)
+        nb_jobs = 1;
+
+    ctx->internal->execute(ctx, blend_slice, &td, NULL, FFMAX(nb_jobs, 1));
 }
 
 static AVFrame *do_blend(AVFilterContext *ctx, AVFrame *mainpic,
@@ -675,5 +719,6 @@ AVFilter ff_vf_overlay = {
     .process_command = process_command,
     .inputs        = avfilter_vf_overlay_inputs,
     .outputs       = avfilter_vf_overlay_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL |
+                     AVFILTER_FLAG_SLICE_THREADS,
 };
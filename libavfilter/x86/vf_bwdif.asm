@@ -0,0 +1,235 @@
+;*****************************************************************************
+;* x86-optimized functions for bwdif filter
+;*
+;* Copyright (C) 2016 Thomas Mundt <loudmax@yahoo.de>
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA 32
+
+pw_coef_hf:  times 8 dw 5570, -3801
+pw_coef_hf2: times 8 dw 1016,  1016
+pw_coef_lf:  times 8 dw 4309,  -213
+pw_coef_sp:  times 8 dw 5077,  -981
+
+SECTION .text
+
+; m15 must be zero for the 8 bit loads
+%macro LOAD 2 ; dst, src
+%if DEPTH == 8
+%if cpuflag(avx2)
+    pmovzxbw      %1, %2
+%else
+    movh          %1, %2
+    punpcklbw     %1, m15
+%endif
+%else
+    movu          %1, %2
+%endif
+%endmacro
+
+; stores m3, clipped to [m15, m14] for more than 8 bits, clobbers m4
+%macro STORE 1
+%if DEPTH == 8
+%if cpuflag(avx2)
+    vextracti128 xm4, m3, 1
+    packuswb     xm3, xm4
+    movu          %1, xm3
+%else
+    packuswb      m3, m3
+    movh          %1, m3
+%endif
+%else
+    pminsw        m3, m14
+    pmaxsw        m3, m15
+    movu          %1, m3
+%endif
+%endmacro
+
+%macro ABSDIFF 4 ; dst, a, b, tmp
+    psubusw       %1, %2, %3
+    psubusw       %4, %3, %2
+    por           %1, %4
+%endmacro
+
+; All words are processed as signed 16 bit values, so the 16 bit version is
+; only exact for up to 12 bits per sample. w must be a multiple of mmsize/2.
+%macro BWDIF 1 ; depth
+%define DEPTH %1
+%if DEPTH == 8
+cglobal bwdif_filter_line, 8, 9, 16, dst, prev, cur, next, w, refs, parity, clip_max
+%else
+cglobal bwdif_filter_line_16bit, 8, 9, 16, dst, prev, cur, next, w, refs, parity, clip_max
+%endif
+    movsxdifnidn  wq, wd
+    movsxdifnidn  refsq, refsd
+    movd         xm14, clip_maxd
+    SPLATW       m14, xm14
+    pxor         m15, m15
+    test      parityd, parityd
+    mov           r7q, curq
+    cmovz         r7q, nextq
+    mov           r6q, curq
+    cmovnz        r6q, prevq
+    DEFINE_ARGS dst, prev, cur, next, w, refs, prev2, next2, refs3
+    lea        refs3q, [refsq+refsq*2]
+
+    ; the field lines around the current one, from the topmost one used
+    sub         prevq, refsq
+    sub         nextq, refsq
+    sub          curq, refs3q
+    sub        prev2q, refsq
+    sub        prev2q, refs3q
+    sub        next2q, refsq
+    sub        next2q, refs3q
+
+.loop:
+    LOAD          m0, [curq+refsq*2]        ; c
+    LOAD          m1, [curq+refsq*4]        ; e
+    LOAD          m2, [prev2q+refsq*4]      ; prev2[0]
+    LOAD          m3, [next2q+refsq*4]      ; next2[0]
+    paddw         m4, m2, m3                ; A = prev2[0] + next2[0]
+    ABSDIFF       m5, m2, m3, m6            ; temporal_diff0
+    psrlw         m2, m4, 1                 ; d
+
+    LOAD          m3, [prevq]
+    ABSDIFF       m6, m3, m0, m7
+    LOAD          m3, [prevq+refsq*2]
+    ABSDIFF       m8, m3, m1, m7
+    paddw         m6, m8
+    psrlw         m6, 1                     ; temporal_diff1
+    LOAD          m3, [nextq]
+    ABSDIFF       m8, m3, m0, m7
+    LOAD          m3, [nextq+refsq*2]
+    ABSDIFF       m9, m3, m1, m7
+    paddw         m8, m9
+    psrlw         m8, 1                     ; temporal_diff2
+    psrlw         m7, m5, 1
+    pmaxsw        m7, m6
+    pmaxsw        m7, m8                    ; diff
+    pcmpeqw       m3, m7, m15               ; !diff
+
+    ; spatial check
+    LOAD          m6, [prev2q+refsq*2]
+    LOAD          m8, [next2q+refsq*2]
+    paddw         m6, m8
+    mova          m9, m6
+    psrlw         m6, 1
+    psubw         m6, m0                    ; b
+    LOAD          m8, [prev2q+refs3q*2]
+    LOAD         m10, [next2q+refs3q*2]
+    paddw         m8, m10
+    paddw         m9, m8                    ; B = sum of the -2/+2 lines
+    psrlw         m8, 1
+    psubw         m8, m1                    ; f
+    psubw        m10, m2, m0                ; dc
+    psubw        m11, m2, m1                ; de
+    pminsw       m12, m6, m8
+    pmaxsw        m6, m8
+    pmaxsw       m12, m10
+    pmaxsw       m12, m11                   ; max
+    pminsw        m6, m10
+    pminsw        m6, m11                   ; min
+    pmaxsw        m7, m6
+    psubw         m8, m15, m12
+    pmaxsw        m7, m8                    ; diff
+
+    ABSDIFF      m10, m0, m1, m11
+    pcmpgtw      m10, m5                    ; |c - e| > temporal_diff0
+    paddw         m0, m1                    ; CE = c + e
+    LOAD          m1, [curq]
+    LOAD          m5, [curq+refs3q*2]
+    paddw         m1, m5                    ; K = cur[-3] + cur[+3]
+    LOAD          m5, [prev2q]
+    LOAD          m6, [next2q]
+    paddw         m5, m6
+    LOAD          m6, [prev2q+refsq*8]
+    paddw         m5, m6
+    LOAD          m6, [next2q+refsq*8]
+    paddw         m5, m6                    ; C = sum of the -4/+4 lines
+
+    ; high frequencies: (5570 * A - 3801 * B + 1016 * C) >> 2
+    punpcklwd     m6, m4, m9
+    punpckhwd     m4, m9
+    pmaddwd       m6, [pw_coef_hf]
+    pmaddwd       m4, [pw_coef_hf]
+    punpcklwd     m8, m5, m15
+    punpckhwd     m5, m15
+    pmaddwd       m8, [pw_coef_hf2]
+    pmaddwd       m5, [pw_coef_hf2]
+    paddd         m6, m8
+    paddd         m4, m5
+    psrad         m6, 2
+    psrad         m4, 2
+
+    ; low frequencies: 4309 * CE - 213 * K, spatial: 5077 * CE - 981 * K
+    punpcklwd     m8, m0, m1
+    punpckhwd     m0, m1
+    mova          m9, m8
+    mova          m1, m0
+    pmaddwd       m8, [pw_coef_lf]
+    pmaddwd       m0, [pw_coef_lf]
+    pmaddwd       m9, [pw_coef_sp]
+    pmaddwd       m1, [pw_coef_sp]
+    paddd         m6, m8
+    paddd         m4, m0
+    psrad         m6, 13
+    psrad         m4, 13
+    psrad         m9, 13
+    psrad         m1, 13
+    packssdw      m6, m4                    ; temporal interpolation
+    packssdw      m9, m1                    ; spatial interpolation
+    pand          m6, m10
+    pandn        m10, m9
+    por           m6, m10                   ; interpol
+
+    paddw         m8, m2, m7
+    psubw         m9, m2, m7
+    pminsw        m6, m8
+    pmaxsw        m6, m9
+    pand          m2, m3
+    pandn         m3, m6
+    por           m3, m2                    ; diff ? interpol : d
+    STORE     [dstq]
+
+    add          dstq, mmsize * DEPTH / 16
+    add         prevq, mmsize * DEPTH / 16
+    add         nextq, mmsize * DEPTH / 16
+    add        prev2q, mmsize * DEPTH / 16
+    add        next2q, mmsize * DEPTH / 16
+    add          curq, mmsize * DEPTH / 16
+    sub            wq, mmsize / 2
+    jg .loop
+    RET
+%endmacro
+
+INIT_XMM sse2
+BWDIF 8
+BWDIF 16
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+BWDIF 8
+BWDIF 16
+%endif
+
+%endif ; ARCH_X86_64
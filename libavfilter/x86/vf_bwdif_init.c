@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 Thomas Mundt <loudmax@yahoo.de>
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/bwdif.h"
+
+#define FILTER_LINE_FUNCS(name, step, tail, psize)                            \
+void ff_bwdif_filter_line_ ## name(void *dst, void *prev, void *cur,          \
+                                   void *next, int w, int refs,               \
+                                   int parity, int clip_max);                 \
+                                                                              \
+static void filter_line_ ## name(void *dst, void *prev, void *cur,            \
+                                 void *next, int w, int refs,                 \
+                                 int parity, int clip_max)                    \
+{                                                                             \
+    const int wmain = w & ~(step - 1);                                        \
+                                                                              \
+    if (wmain)                                                                \
+        ff_bwdif_filter_line_ ## name(dst, prev, cur, next, wmain, refs,      \
+                                      parity, clip_max);                      \
+    if (wmain < w)                                                            \
+        tail((uint8_t *)dst + wmain * psize, (uint8_t *)prev + wmain * psize, \
+             (uint8_t *)cur + wmain * psize, (uint8_t *)next + wmain * psize, \
+             w - wmain, refs, parity, clip_max);                              \
+}
+
+#if ARCH_X86_64 && HAVE_YASM
+FILTER_LINE_FUNCS(sse2,        8, ff_bwdif_filter_line_c,       1)
+FILTER_LINE_FUNCS(16bit_sse2,  8, ff_bwdif_filter_line_c_16bit, 2)
+#if HAVE_AVX2_EXTERNAL
+FILTER_LINE_FUNCS(avx2,       16, ff_bwdif_filter_line_c,       1)
+FILTER_LINE_FUNCS(16bit_avx2, 16, ff_bwdif_filter_line_c_16bit, 2)
+#endif
+#endif /* ARCH_X86_64 && HAVE_YASM */
+
+av_cold void ff_bwdif_init_x86(BWDIFContext *bwdif)
+{
+#if ARCH_X86_64 && HAVE_YASM
+    int cpu_flags = av_get_cpu_flags();
+    int bit_depth = bwdif->csp->comp[0].depth_minus1 + 1;
+
+    if (bit_depth <= 8) {
+        if (EXTERNAL_SSE2(cpu_flags))
+            bwdif->filter_line = filter_line_sse2;
+#if HAVE_AVX2_EXTERNAL
+        if (EXTERNAL_AVX2(cpu_flags))
+            bwdif->filter_line = filter_line_avx2;
+#endif
+    } else if (bit_depth <= 12) {
+        if (EXTERNAL_SSE2(cpu_flags))
+            bwdif->filter_line = filter_line_16bit_sse2;
+#if HAVE_AVX2_EXTERNAL
+        if (EXTERNAL_AVX2(cpu_flags))
+            bwdif->filter_line = filter_line_16bit_avx2;
+#endif
+    }
+#endif /* ARCH_X86_64 && HAVE_YASM */
+}
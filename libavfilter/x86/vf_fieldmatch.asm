@@ -0,0 +1,321 @@
+;*****************************************************************************
+;* x86-optimized functions for fieldmatch filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA
+
+pb_1:  times 16 db 1
+pb_2:  times 16 db 2
+pb_3:  times 16 db 3
+pb_4:  times 16 db 4
+pb_5:  times 16 db 5
+pb_20: times 16 db 20
+pw_1:  times 8 dw 1
+pw_2:  times 8 dw 2
+pw_4:  times 8 dw 4
+pw_23: times 8 dw 23
+pw_42: times 8 dw 42
+
+SECTION .text
+
+INIT_XMM sse2
+cglobal fieldmatch_abs_diff_line, 4, 4, 3, dst, a, b, w
+    movsxdifnidn wq, wd
+    add       dstq, wq
+    add         aq, wq
+    add         bq, wq
+    neg         wq
+.loop:
+    movu        m0, [aq + wq]
+    movu        m1, [bq + wq]
+    psubusb     m2, m0, m1
+    psubusb     m1, m0
+    por         m2, m1
+    movu [dstq + wq], m2
+    add         wq, mmsize
+    jl .loop
+    RET
+
+cglobal fieldmatch_sad_line, 3, 3, 3, a, b, w
+    movsxdifnidn wq, wd
+    add         aq, wq
+    add         bq, wq
+    neg         wq
+    pxor        m2, m2
+.loop:
+    movu        m0, [aq + wq]
+    movu        m1, [bq + wq]
+    psadbw      m0, m1
+    paddq       m2, m0
+    add         wq, mmsize
+    jl .loop
+    pshufd      m0, m2, 0xee
+    paddq       m0, m2
+    movd       eax, m0
+    RET
+
+; |x| of the words of %1, %2 is clobbered
+%macro ABSW 2
+    pxor        %2, %2
+    psubw       %2, %1
+    pmaxsw      %1, %2
+%endmacro
+
+; dst = |cur - p1| > cthresh && |cur - n1| > cthresh &&
+;       |4 * cur - 3 * (p1 + n1) + (p2 + n2)| > 6 * cthresh
+cglobal fieldmatch_comb_line, 7, 7, 8, dst, cur, p1, n1, p2, n2, w, cthresh
+    movd        m6, cthreshm
+    SPLATW      m6, m6
+    paddw       m7, m6, m6
+    paddw       m5, m7, m7
+    paddw       m5, m7
+    pxor        m7, m7
+    movsxdifnidn wq, wd
+    add       dstq, wq
+    add       curq, wq
+    add        p1q, wq
+    add        n1q, wq
+    add        p2q, wq
+    add        n2q, wq
+    neg         wq
+.loop:
+    movh        m0, [curq + wq]
+    movh        m1, [p1q  + wq]
+    movh        m2, [n1q  + wq]
+    punpcklbw   m0, m7
+    punpcklbw   m1, m7
+    punpcklbw   m2, m7
+    psubw       m3, m0, m1
+    ABSW        m3, m4
+    pcmpgtw     m3, m6
+    psubw       m4, m0, m2
+    paddw       m1, m2
+    ABSW        m4, m2
+    pcmpgtw     m4, m6
+    pand        m3, m4
+    paddw       m2, m1, m1
+    paddw       m1, m2
+    psllw       m0, 2
+    psubw       m0, m1
+    movh        m1, [p2q + wq]
+    movh        m2, [n2q + wq]
+    punpcklbw   m1, m7
+    punpcklbw   m2, m7
+    paddw       m0, m1
+    paddw       m0, m2
+    ABSW        m0, m1
+    pcmpgtw     m0, m5
+    pand        m0, m3
+    packsswb    m0, m0
+    movh [dstq + wq], m0
+    add         wq, mmsize / 2
+    jl .loop
+    RET
+
+%if ARCH_X86_64
+; %1 = (%2 > k) ? 0xff : 0, for the unsigned byte threshold k + 1 in %3
+%macro GT 3
+    movu        %1, %2
+    pminub      %1, %3
+    pcmpeqb     %1, %3
+%endmacro
+
+; or the > 19 mask of %1 into %2
+%macro OR_GT19 2
+    GT          m0, %1, m15
+    por         %2, m0
+%endmacro
+
+; count the > 3 and > 19 pixels of %1 into m11 and m12
+%macro COUNT 1
+    movu        m1, %1
+    mova        m0, m1
+    pminub      m0, m15
+    pcmpeqb     m0, m15
+    psubb      m12, m0
+    pminub      m1, m14
+    pcmpeqb     m1, m14
+    psubb      m11, m1
+%endmacro
+
+; the 9 pixels wide window around x of the line at %1, counting the 3 pixels
+; in the middle if %3 is set
+%macro WINDOW 3
+    GT          %2, [%1 - 4], m15
+    OR_GT19     [%1 - 3], %2
+    OR_GT19     [%1 - 2], %2
+%if %3
+    COUNT       [%1 - 1]
+    por         %2, m0
+    COUNT       [%1    ]
+    por         %2, m0
+    COUNT       [%1 + 1]
+    por         %2, m0
+%else
+    OR_GT19     [%1 - 1], %2
+    OR_GT19     [%1    ], %2
+    OR_GT19     [%1 + 1], %2
+%endif
+    OR_GT19     [%1 + 2], %2
+    OR_GT19     [%1 + 3], %2
+    OR_GT19     [%1 + 4], %2
+%endmacro
+
+cglobal fieldmatch_diff_map_line, 6, 6, 16, dst, pm2, pm1, pp2, stride, w, up2mask, lo2mask
+    mova       m14, [pb_4]
+    mova       m15, [pb_20]
+    movd        m6, up2maskm
+    movd        m7, lo2maskm
+    pshufd      m6, m6, 0
+    pshufd      m7, m7, 0
+.loop:
+    pxor       m11, m11
+    pxor       m12, m12
+    WINDOW      pm2q, m8, 0
+    WINDOW      pp2q, m9, 0
+    WINDOW      pm1q, m10, 1
+    WINDOW      pm1q + strideq * 2, m13, 1
+    COUNT       [pm1q + strideq - 1]
+    COUNT       [pm1q + strideq + 1]
+    movu        m2, [pm1q + strideq]
+    mova        m3, m2
+    pminub      m3, m15
+    pcmpeqb     m3, m15
+    psubb      m12, m3
+    pminub      m2, m14
+    pcmpeqb     m2, m14
+    psubb      m11, m2
+    ; big differences above and below, or on two lines on one side
+    mova        m0, m10
+    pand        m0, m13
+    pand        m8, m6
+    pand        m9, m7
+    pand        m8, m10
+    pand        m9, m13
+    por         m0, m8
+    por         m0, m9
+    ; diff > 3 with at least 2 neighbours > 3
+    pcmpgtb    m11, [pb_1]
+    pand       m11, m2
+    ; diff > 19 with at least 4 neighbours > 19
+    mova        m1, m12
+    pcmpgtb     m1, [pb_3]
+    pand        m1, m3
+    pand        m1, m11
+    pcmpgtb    m12, [pb_5]
+    pand       m12, m1
+    pand        m1, m0
+    pandn       m0, m12
+    pand       m11, [pb_1]
+    pand        m1, [pb_2]
+    pand        m0, m14
+    por         m0, m11
+    por         m0, m1
+    movu    [dstq], m0
+    add       dstq, mmsize
+    add       pm2q, mmsize
+    add       pm1q, mmsize
+    add       pp2q, mmsize
+    sub         wd, mmsize
+    jg .loop
+    RET
+
+; add |3 * (%1 + %2) - [1 4 1] src| to the accumulators %3, %4 and %5
+%macro ACCUMULATE 5
+    movh        m5, %1
+    movh        m6, %2
+    punpcklbw   m5, m7
+    punpcklbw   m6, m7
+    paddw       m5, m6
+    mova        m6, m5
+    paddw       m5, m5
+    paddw       m5, m6
+    psubw       m5, m0
+    ABSW        m5, m6
+    mova        m6, m5
+    pcmpgtw     m6, m15
+    pand        m6, m2
+    pand        m6, m5
+    pmaddwd     m6, m14
+    paddd       %3, m6
+    mova        m1, m5
+    pcmpgtw     m1, [pw_42]
+    pand        m1, m5
+    mova        m6, m1
+    pand        m6, m3
+    pmaddwd     m6, m14
+    paddd       %4, m6
+    pand        m1, m4
+    pmaddwd     m1, m14
+    paddd       %5, m1
+%endmacro
+
+cglobal fieldmatch_compare_line, 10, 10, 16, src, ss, prv, ps, nxt, ns, map, ms, w, acc
+    mova       m14, [pw_1]
+    mova       m15, [pw_23]
+    pxor        m7, m7
+    pxor        m8, m8
+    pxor        m9, m9
+    pxor       m10, m10
+    pxor       m11, m11
+    pxor       m12, m12
+    pxor       m13, m13
+.loop:
+    ; [1 4 1] filtered source
+    movh        m0, [srcq]
+    movh        m1, [srcq + ssq]
+    movh        m2, [srcq + ssq * 2]
+    punpcklbw   m0, m7
+    punpcklbw   m1, m7
+    punpcklbw   m2, m7
+    psllw       m1, 2
+    paddw       m0, m1
+    paddw       m0, m2
+    ; difference map flags
+    movh        m1, [mapq]
+    movh        m2, [mapq + msq]
+    por         m1, m2
+    punpcklbw   m1, m7
+    mova        m2, m1
+    mova        m3, m1
+    mova        m4, m1
+    pand        m2, m14
+    pand        m3, [pw_2]
+    pand        m4, [pw_4]
+    pcmpeqw     m2, m14
+    pcmpeqw     m3, [pw_2]
+    pcmpeqw     m4, [pw_4]
+    ACCUMULATE  [prvq], [prvq + psq], m8,  m9,  m10
+    ACCUMULATE  [nxtq], [nxtq + nsq], m11, m12, m13
+    add       srcq, mmsize / 2
+    add       prvq, mmsize / 2
+    add       nxtq, mmsize / 2
+    add       mapq, mmsize / 2
+    sub         wd, mmsize / 2
+    jg .loop
+    movu [accq + 0 * mmsize], m8
+    movu [accq + 1 * mmsize], m9
+    movu [accq + 2 * mmsize], m10
+    movu [accq + 3 * mmsize], m11
+    movu [accq + 4 * mmsize], m12
+    movu [accq + 5 * mmsize], m13
+    RET
+%endif ; ARCH_X86_64
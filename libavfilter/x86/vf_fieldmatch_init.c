@@ -0,0 +1,136 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vf_fieldmatch.h"
+
+#if HAVE_YASM
+void ff_fieldmatch_abs_diff_line_sse2(uint8_t *dst, const uint8_t *a,
+                                      const uint8_t *b, int w);
+int ff_fieldmatch_sad_line_sse2(const uint8_t *a, const uint8_t *b, int w);
+void ff_fieldmatch_comb_line_sse2(uint8_t *dst, const uint8_t *cur,
+                                  const uint8_t *p1, const uint8_t *n1,
+                                  const uint8_t *p2, const uint8_t *n2,
+                                  int w, int cthresh);
+void ff_fieldmatch_diff_map_line_sse2(uint8_t *dst, const uint8_t *pm2,
+                                      const uint8_t *pm1, const uint8_t *pp2,
+                                      ptrdiff_t stride, int w,
+                                      int up2mask, int lo2mask);
+void ff_fieldmatch_compare_line_sse2(const uint8_t *src, ptrdiff_t src_stride,
+                                     const uint8_t *prv, ptrdiff_t prv_stride,
+                                     const uint8_t *nxt, ptrdiff_t nxt_stride,
+                                     const uint8_t *map, ptrdiff_t map_stride,
+                                     int w, int32_t acc[6][4]);
+
+static void abs_diff_line_sse2(uint8_t *dst, const uint8_t *a, const uint8_t *b, int w)
+{
+    const int w16 = w & ~15;
+    int i;
+
+    if (w16)
+        ff_fieldmatch_abs_diff_line_sse2(dst, a, b, w16);
+    for (i = w16; i < w; i++)
+        dst[i] = FFABS(a[i] - b[i]);
+}
+
+static int sad_line_sse2(const uint8_t *a, const uint8_t *b, int w)
+{
+    const int w16 = w & ~15;
+    int i, sum = 0;
+
+    if (w16)
+        sum = ff_fieldmatch_sad_line_sse2(a, b, w16);
+    for (i = w16; i < w; i++)
+        sum += FFABS(a[i] - b[i]);
+    return sum;
+}
+
+static void comb_line_sse2(uint8_t *dst, const uint8_t *cur,
+                           const uint8_t *p1, const uint8_t *n1,
+                           const uint8_t *p2, const uint8_t *n2,
+                           int w, int cthresh)
+{
+    const int w8 = w & ~7;
+    const int cthresh6 = cthresh * 6;
+    int i;
+
+    if (w8)
+        ff_fieldmatch_comb_line_sse2(dst, cur, p1, n1, p2, n2, w8, cthresh);
+
+    for (i = w8; i < w; i++) {
+        const int c = cur[i];
+        const int f = 4 * c - 3 * (p1[i] + n1[i]) + (p2[i] + n2[i]);
+        dst[i] = FFABS(c - p1[i]) > cthresh &&
+                 FFABS(c - n1[i]) > cthresh &&
+                 FFABS(f) > cthresh6 ? 0xff : 0;
+    }
+}
+
+#if ARCH_X86_64
+static void diff_map_line_sse2(uint8_t *dst, const uint8_t *dp, int tpitch,
+                               int w, int up2, int lo2)
+{
+    if (w)
+        ff_fieldmatch_diff_map_line_sse2(dst, up2 ? dp - 2 * tpitch : dp,
+                                         dp - tpitch,
+                                         lo2 ? dp + 2 * tpitch : dp,
+                                         tpitch, w, up2 ? -1 : 0, lo2 ? -1 : 0);
+}
+
+static void compare_line_sse2(const uint8_t *src, ptrdiff_t src_stride,
+                              const uint8_t *prv, ptrdiff_t prv_stride,
+                              const uint8_t *nxt, ptrdiff_t nxt_stride,
+                              const uint8_t *map, ptrdiff_t map_stride,
+                              int w, uint64_t *accum)
+{
+    int32_t acc[6][4];
+    int i;
+
+    if (!w)
+        return;
+
+    ff_fieldmatch_compare_line_sse2(src, src_stride, prv, prv_stride,
+                                    nxt, nxt_stride, map, map_stride, w, acc);
+
+    for (i = 0; i < 6; i++)
+        accum[i] += (uint32_t)acc[i][0] + (uint32_t)acc[i][1] +
+                    (uint32_t)acc[i][2] + (uint32_t)acc[i][3];
+}
+#endif /* ARCH_X86_64 */
+#endif /* HAVE_YASM */
+
+av_cold void ff_fieldmatch_init_x86(FieldMatchDSPContext *dsp)
+{
+#if HAVE_YASM
+    const int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE2(cpu_flags)) {
+        dsp->abs_diff_line = abs_diff_line_sse2;
+        dsp->sad_line      = sad_line_sse2;
+        dsp->comb_line     = comb_line_sse2;
+#if ARCH_X86_64
+        dsp->diff_map_line = diff_map_line_sse2;
+        dsp->compare_line  = compare_line_sse2;
+#endif
+    }
+#endif
+}
@@ -0,0 +1,89 @@
+;*****************************************************************************
+;* x86-optimized functions for w3fdif filter
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_TEXT
+
+; Set work[x] to (or add to it) a[x] * c0 + b[x] * c1 for x in [0, w),
+; w being a non-zero multiple of 16 and coefs holding c0 and c1.
+%macro MADD_PAIR 2 ; name, accumulate
+cglobal w3fdif_madd_pair_%1, 5, 5, 8, work, a, b, coefs, w
+    movd        m6, coefsd
+    pshufd      m6, m6, 0
+    pxor        m7, m7
+    movsxdifnidn wq, wd
+    add         aq, wq
+    add         bq, wq
+    lea      workq, [workq + wq * 4]
+    neg         wq
+.loop:
+    movu        m0, [aq + wq]
+    movu        m1, [bq + wq]
+    punpckhbw   m2, m0, m1
+    punpcklbw   m0, m1
+    punpckhbw   m1, m0, m7
+    punpcklbw   m0, m7
+    punpckhbw   m3, m2, m7
+    punpcklbw   m2, m7
+    pmaddwd     m0, m6
+    pmaddwd     m1, m6
+    pmaddwd     m2, m6
+    pmaddwd     m3, m6
+%if %2
+    paddd       m0, [workq + wq * 4]
+    paddd       m1, [workq + wq * 4 + 16]
+    paddd       m2, [workq + wq * 4 + 32]
+    paddd       m3, [workq + wq * 4 + 48]
+%endif
+    mova [workq + wq * 4],      m0
+    mova [workq + wq * 4 + 16], m1
+    mova [workq + wq * 4 + 32], m2
+    mova [workq + wq * 4 + 48], m3
+    add         wq, mmsize
+    jl .loop
+    RET
+%endmacro
+
+INIT_XMM sse2
+MADD_PAIR set, 0
+MADD_PAIR add, 1
+
+cglobal w3fdif_scale, 3, 3, 4, out, work, w
+    movsxdifnidn wq, wd
+    add       outq, wq
+    lea      workq, [workq + wq * 4]
+    neg         wq
+.loop:
+    mova        m0, [workq + wq * 4]
+    mova        m1, [workq + wq * 4 + 16]
+    mova        m2, [workq + wq * 4 + 32]
+    mova        m3, [workq + wq * 4 + 48]
+    psrad       m0, 15
+    psrad       m1, 15
+    psrad       m2, 15
+    psrad       m3, 15
+    packssdw    m0, m1
+    packssdw    m2, m3
+    packuswb    m0, m2
+    movu [outq + wq], m0
+    add         wq, mmsize
+    jl .loop
+    RET
@@ -0,0 +1,140 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vf_w3fdif.h"
+
+#if HAVE_YASM
+#define COEF_PAIR(c0, c1) ((uint16_t)(c0) | (uint32_t)(uint16_t)(c1) << 16)
+
+/*
+ * Set work[x] to (or add to it) a[x] * c0 + b[x] * c1 for x in [0, w16),
+ * w16 being a non-zero multiple of 16 and coefs holding c0 and c1.
+ */
+void ff_w3fdif_madd_pair_set_sse2(int32_t *work, const uint8_t *a,
+                                  const uint8_t *b, uint32_t coefs, int w16);
+void ff_w3fdif_madd_pair_add_sse2(int32_t *work, const uint8_t *a,
+                                  const uint8_t *b, uint32_t coefs, int w16);
+void ff_w3fdif_scale_sse2(uint8_t *out_pixel, const int32_t *work_pixel,
+                          int w16);
+
+static void filter_simple_low_sse2(int32_t *work_line,
+                                   const uint8_t *in_lines_cur[2],
+                                   const int16_t *coef, int linesize)
+{
+    const uint8_t *in0 = in_lines_cur[0], *in1 = in_lines_cur[1];
+    const int w16 = linesize & ~15;
+    int i;
+
+    if (w16)
+        ff_w3fdif_madd_pair_set_sse2(work_line, in0, in1,
+                                     COEF_PAIR(coef[0], coef[1]), w16);
+
+    for (i = w16; i < linesize; i++)
+        work_line[i] = in0[i] * coef[0] + in1[i] * coef[1];
+}
+
+static void filter_complex_low_sse2(int32_t *work_line,
+                                    const uint8_t *in_lines_cur[4],
+                                    const int16_t *coef, int linesize)
+{
+    const uint8_t *in0 = in_lines_cur[0], *in1 = in_lines_cur[1];
+    const uint8_t *in2 = in_lines_cur[2], *in3 = in_lines_cur[3];
+    const int w16 = linesize & ~15;
+    int i;
+
+    if (w16) {
+        ff_w3fdif_madd_pair_set_sse2(work_line, in0, in1,
+                                     COEF_PAIR(coef[0], coef[1]), w16);
+        ff_w3fdif_madd_pair_add_sse2(work_line, in2, in3,
+                                     COEF_PAIR(coef[2], coef[3]), w16);
+    }
+
+    for (i = w16; i < linesize; i++)
+        work_line[i] = in0[i] * coef[0] + in1[i] * coef[1] +
+                       in2[i] * coef[2] + in3[i] * coef[3];
+}
+
+static av_always_inline void filter_high_sse2(int32_t *work_line,
+                                              const uint8_t **in_lines_cur,
+                                              const uint8_t **in_lines_adj,
+                                              const int16_t *coef,
+                                              int linesize, int taps)
+{
+    const int w16 = linesize & ~15;
+    int i, j;
+
+    for (j = 0; j < taps; j++) {
+        const uint8_t *cur = in_lines_cur[j], *adj = in_lines_adj[j];
+
+        if (w16)
+            ff_w3fdif_madd_pair_add_sse2(work_line, cur, adj,
+                                         COEF_PAIR(coef[j], coef[j]), w16);
+        for (i = w16; i < linesize; i++)
+            work_line[i] += (cur[i] + adj[i]) * coef[j];
+    }
+}
+
+static void filter_simple_high_sse2(int32_t *work_line,
+                                    const uint8_t *in_lines_cur[3],
+                                    const uint8_t *in_lines_adj[3],
+                                    const int16_t *coef, int linesize)
+{
+    filter_high_sse2(work_line, in_lines_cur, in_lines_adj, coef, linesize, 3);
+}
+
+static void filter_complex_high_sse2(int32_t *work_line,
+                                     const uint8_t *in_lines_cur[5],
+                                     const uint8_t *in_lines_adj[5],
+                                     const int16_t *coef, int linesize)
+{
+    filter_high_sse2(work_line, in_lines_cur, in_lines_adj, coef, linesize, 5);
+}
+
+static void filter_scale_sse2(uint8_t *out_pixel, const int32_t *work_pixel,
+                              int linesize)
+{
+    const int w16 = linesize & ~15;
+    int j;
+
+    if (w16)
+        ff_w3fdif_scale_sse2(out_pixel, work_pixel, w16);
+
+    for (j = w16; j < linesize; j++)
+        out_pixel[j] = av_clip(work_pixel[j], 0, 255 * 256 * 128) >> 15;
+}
+#endif /* HAVE_YASM */
+
+av_cold void ff_w3fdif_init_x86(W3FDIFDSPContext *dsp)
+{
+#if HAVE_YASM
+    const int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE2(cpu_flags)) {
+        dsp->filter_simple_low   = filter_simple_low_sse2;
+        dsp->filter_complex_low  = filter_complex_low_sse2;
+        dsp->filter_simple_high  = filter_simple_high_sse2;
+        dsp->filter_complex_high = filter_complex_high_sse2;
+        dsp->filter_scale        = filter_scale_sse2;
+    }
+#endif
+}
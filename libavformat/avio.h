@@ -153,6 +153,36 @@ typedef struct AVIOContext {
      * This field is internal to libavformat and access from outside is not allowed.
      */
     int orig_buffer_size;
+
+    /**
+     * Maximum size the read buffer can grow to while data is read
+     * sequentially, 0 to keep the original buffer size
+     * This field is internal to libavformat and access from outside is not allowed.
+     */
+    int max_buffer_size;
+
+    /**
+     * Read buffer size chosen from the sequential reads, 0 when the original
+     * buffer size is used
+     * This field is internal to libavformat and access from outside is not allowed.
+     */
+    int read_buffer_size;
+
+    /**
+     * Number of consecutive reads which returned all the requested data
+     * This field is internal to libavformat and access from outside is not allowed.
+     */
+    int full_reads;
+
+    /**
+     * Read statistics: number of reads from the underlying protocol, time
+     * spent in them in microseconds and the resulting throughput in bytes
+     * per second
+     * This field is internal to libavformat and access from outside is not allowed.
+     */
+    int read_count;
+    int64_t read_time;
+    int64_t read_throughput;
 } AVIOContext;
 
 /* unbuffered I/O */
@@ -422,9 +452,10 @@ int avio_open(AVIOContext **s, const char *url, int flags);
  * @param flags flags which control how the resource indicated by url
  * is to be opened
  * @param int_cb an interrupt callback to be used at the protocols level
- * @param options  A dictionary filled with protocol-private options. On return
- * this parameter will be destroyed and replaced with a dict containing options
- * that were not found. May be NULL.
+ * @param options  A dictionary filled with protocol-private options and
+ * AVIOContext options, the latter being applied once the protocol has taken
+ * its own. On return this parameter will be destroyed and replaced with a
+ * dict containing options that were not found. May be NULL.
  * @return >= 0 in case of success, a negative value corresponding to an
  * AVERROR code in case of failure
  */
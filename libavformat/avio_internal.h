@@ -54,6 +54,23 @@ int ffio_init_context(AVIOContext *s,
  */
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data);
 
+/**
+ * Get a pointer to the data already buffered for reading, without reading
+ * anything from the underlying protocol.
+ * Note that the data is only valid until the next call that references the
+ * same IO context.
+ * @param s IO context
+ * @param data address at which to store a pointer to the buffered data
+ * @return number of bytes buffered, 0 for a write context
+ */
+int ffio_peek_buffered(AVIOContext *s, const unsigned char **data);
+
+/**
+ * Skip size bytes of the data returned by ffio_peek_buffered().
+ * size must not be larger than the number of bytes it returned.
+ */
+void ffio_skip_buffered(AVIOContext *s, int size);
+
 /**
  * Read size bytes from AVIOContext into buf.
  * This reads at most 1 packet. If that is not enough fewer bytes will be
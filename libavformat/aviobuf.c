@@ -26,6 +26,7 @@
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
 #include "libavutil/avassert.h"
+#include "libavutil/time.h"
 #include "avformat.h"
 #include "avio.h"
 #include "avio_internal.h"
@@ -42,6 +43,12 @@
  */
 #define SHORT_SEEK_THRESHOLD 4096
 
+/**
+ * Double the read buffer size, up to max_buffer_size, after this many
+ * consecutive reads returned all the data requested.
+ */
+#define SEQUENTIAL_READS 4
+
 static void *ff_avio_child_next(void *obj, void *prev)
 {
     AVIOContext *s = obj;
@@ -53,9 +60,20 @@ static const AVClass *ff_avio_child_class_next(const AVClass *prev)
     return prev ? NULL : &ffurl_context_class;
 }
 
+#define OFFSET(x) offsetof(AVIOContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+#define R AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY
 static const AVOption ff_avio_options[] = {
+    { "max_buffer_size", "maximum size of the read buffer for sequential reads, 0 to keep it fixed", OFFSET(max_buffer_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX / 2, D },
+    { "bytes_read", "number of bytes read", OFFSET(bytes_read), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, R },
+    { "read_count", "number of reads from the protocol", OFFSET(read_count), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, R },
+    { "seek_count", "number of seeks in the protocol", OFFSET(seek_count), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, R },
+    { "read_throughput", "throughput of the reads from the protocol, in bytes per second", OFFSET(read_throughput), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, R },
     { NULL },
 };
+#undef OFFSET
+#undef D
+#undef R
 
 const AVClass ff_avio_class = {
     .class_name = "AVIOContext",
@@ -181,6 +199,12 @@ void avio_write(AVIOContext *s, const unsigned char *buf, int size)
         writeout(s, buf, size);
         return;
     }
+    /* pass large writes straight to the protocol if nothing is buffered */
+    if (s->buf_ptr == s->buffer && size >= s->buffer_size && s->write_flag &&
+        !s->update_checksum && !s->max_packet_size) {
+        writeout(s, buf, size);
+        return;
+    }
     while (size > 0) {
         int len = FFMIN(s->buf_end - s->buf_ptr, size);
         memcpy(s->buf_ptr, buf, len);
@@ -247,6 +271,8 @@ int64_t avio_seek(AVIOContext *s, int64_t offset, int whence)
         pos -= FFMIN(buffer_size>>1, pos);
         if ((res = s->seek(s->opaque, pos, SEEK_SET)) < 0)
             return res;
+        s->read_buffer_size = 0;
+        s->full_reads       = 0;
         s->buf_end =
         s->buf_ptr = s->buffer;
         s->pos = pos;
@@ -264,6 +290,8 @@ int64_t avio_seek(AVIOContext *s, int64_t offset, int whence)
         if ((res = s->seek(s->opaque, offset, SEEK_SET)) < 0)
             return res;
         s->seek_count ++;
+        s->read_buffer_size = 0;
+        s->full_reads       = 0;
         if (!s->write_flag)
             s->buf_end = s->buffer;
         s->buf_ptr = s->buffer;
@@ -439,13 +467,43 @@ void avio_wb24(AVIOContext *s, unsigned int val)
 
 /* Input stream */
 
+/* Read from the protocol, keeping track of the read statistics. */
+static int read_packet_wrapper(AVIOContext *s, uint8_t *buf, int size)
+{
+    int64_t start = av_gettime_relative();
+    int len       = s->read_packet(s->opaque, buf, size);
+
+    s->read_time += av_gettime_relative() - start;
+    s->read_count++;
+    if (len > 0 && s->read_time > 0)
+        s->read_throughput = av_rescale(s->bytes_read + len, 1000000, s->read_time);
+    return len;
+}
+
+static int set_read_buffer_size(AVIOContext *s, int buf_size)
+{
+    uint8_t *buffer = av_malloc(buf_size);
+    if (!buffer)
+        return AVERROR(ENOMEM);
+
+    av_free(s->buffer);
+    s->buffer      = buffer;
+    s->buffer_size = buf_size;
+    s->buf_ptr     =
+    s->buf_end     = buffer;
+    return 0;
+}
+
 static void fill_buffer(AVIOContext *s)
 {
     int max_buffer_size = s->max_packet_size ?
                           s->max_packet_size : IO_BUFFER_SIZE;
+    int read_size       = s->read_buffer_size ?
+                          s->read_buffer_size : s->orig_buffer_size;
     uint8_t *dst        = s->buf_end - s->buffer + max_buffer_size < s->buffer_size ?
                           s->buf_end : s->buffer;
     int len             = s->buffer_size - (dst - s->buffer);
+    int requested;
 
     /* can't fill the buffer without read_packet, just set EOF if appropriate */
     if (!s->read_packet && s->buf_ptr >= s->buf_end)
@@ -462,19 +520,19 @@ static void fill_buffer(AVIOContext *s)
         s->checksum_ptr = s->buffer;
     }
 
-    /* make buffer smaller in case it ended up large after probing */
-    if (s->read_packet && s->orig_buffer_size && s->buffer_size > s->orig_buffer_size) {
-        if (dst == s->buffer) {
-            ffio_set_buf_size(s, s->orig_buffer_size);
-
+    /* make buffer smaller in case it ended up large after probing or
+     * after a seek, or larger for sequential reads */
+    if (s->read_packet && s->orig_buffer_size &&
+        (s->buffer_size > read_size ||
+         (s->buffer_size < read_size && dst == s->buffer))) {
+        if (dst == s->buffer && set_read_buffer_size(s, read_size) >= 0)
             s->checksum_ptr = dst = s->buffer;
-        }
-        av_assert0(len >= s->orig_buffer_size);
-        len = s->orig_buffer_size;
+        len = FFMIN(s->buffer_size - (dst - s->buffer), read_size);
     }
 
+    requested = len;
     if (s->read_packet)
-        len = s->read_packet(s->opaque, dst, len);
+        len = read_packet_wrapper(s, dst, len);
     else
         len = 0;
     if (len <= 0) {
@@ -488,6 +546,18 @@ static void fill_buffer(AVIOContext *s)
         s->buf_ptr = dst;
         s->buf_end = dst + len;
         s->bytes_read += len;
+
+        /* grow the buffer while the protocol keeps up with the reads */
+        if (s->max_buffer_size > s->orig_buffer_size && !s->max_packet_size &&
+            len == requested) {
+            if (++s->full_reads >= SEQUENTIAL_READS) {
+                s->read_buffer_size = FFMIN(2 * FFMAX(s->read_buffer_size, s->orig_buffer_size),
+                                            s->max_buffer_size);
+                s->full_reads       = 0;
+            }
+        } else {
+            s->full_reads = 0;
+        }
     }
 }
 
@@ -544,7 +614,7 @@ int avio_read(AVIOContext *s, unsigned char *buf, int size)
         if (len == 0 || s->write_flag) {
             if((s->direct || size > s->buffer_size) && !s->update_checksum){
                 if(s->read_packet)
-                    len = s->read_packet(s->opaque, buf, size);
+                    len = read_packet_wrapper(s, buf, size);
                 if (len <= 0) {
                     /* do not modify buffer if EOF reached so that a seek back can
                     be done without rereading data */
@@ -592,6 +662,22 @@ int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsig
     }
 }
 
+int ffio_peek_buffered(AVIOContext *s, const unsigned char **data)
+{
+    if (s->write_flag) {
+        *data = NULL;
+        return 0;
+    }
+    *data = s->buf_ptr;
+    return s->buf_end - s->buf_ptr;
+}
+
+void ffio_skip_buffered(AVIOContext *s, int size)
+{
+    av_assert1(size >= 0 && size <= s->buf_end - s->buf_ptr);
+    s->buf_ptr += size;
+}
+
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size)
 {
     int len;
@@ -791,6 +877,7 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
         (*s)->read_seek  = (int64_t (*)(void *, int, int64_t, int))h->prot->url_read_seek;
     }
     (*s)->av_class = &ff_avio_class;
+    av_opt_set_defaults(*s);
     return 0;
 }
 
@@ -831,6 +918,7 @@ int ffio_set_buf_size(AVIOContext *s, int buf_size)
     s->buffer = buffer;
     s->orig_buffer_size =
     s->buffer_size = buf_size;
+    s->read_buffer_size = 0;
     s->buf_ptr = buffer;
     url_resetbuf(s, s->write_flag ? AVIO_FLAG_WRITE : AVIO_FLAG_READ);
     return 0;
@@ -913,6 +1001,10 @@ int avio_open2(AVIOContext **s, const char *filename, int flags,
         ffurl_close(h);
         return err;
     }
+    if (options && (err = av_opt_set_dict(*s, options)) < 0) {
+        avio_closep(s);
+        return err;
+    }
     return 0;
 }
 
@@ -929,7 +1021,9 @@ int avio_close(AVIOContext *s)
     if (s->write_flag)
         av_log(s, AV_LOG_DEBUG, "Statistics: %d seeks, %d writeouts\n", s->seek_count, s->writeout_count);
     else
-        av_log(s, AV_LOG_DEBUG, "Statistics: %"PRId64" bytes read, %d seeks\n", s->bytes_read, s->seek_count);
+        av_log(s, AV_LOG_DEBUG, "Statistics: %"PRId64" bytes read, %d reads, "
+               "%"PRId64" bytes/s, %d seeks\n",
+               s->bytes_read, s->read_count, s->read_throughput, s->seek_count);
     av_free(s);
     return ffurl_close(h);
 }
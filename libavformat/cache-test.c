@@ -0,0 +1,140 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Read the same file twice through the shared block cache of the cache
+ * protocol, then once more after it was modified in place. */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/dict.h"
+#include "libavutil/mem.h"
+#include "avformat.h"
+
+#define SIZE 40000
+
+static void log_callback(void *avcl, int level, const char *fmt, va_list vl)
+{
+    char line[256];
+
+    vsnprintf(line, sizeof(line), fmt, vl);
+    /* only the cache statistics are printed */
+    if (av_strstart(line, "Statistics, cache", NULL))
+        printf("%s", line);
+}
+
+static void clean_dir(const char *dir)
+{
+    struct dirent *entry;
+    char path[1024];
+    DIR *d = opendir(dir);
+
+    if (!d)
+        return;
+    while ((entry = readdir(d))) {
+        if (entry->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        unlink(path);
+    }
+    closedir(d);
+}
+
+static int write_input(const char *filename, int seed, time_t mtime)
+{
+    struct utimbuf times = { mtime, mtime };
+    FILE *f = fopen(filename, "r+b");
+    int i;
+
+    /* modified in place, so that the inode is kept */
+    if (!f && !(f = fopen(filename, "wb")))
+        return -1;
+    for (i = 0; i < SIZE; i++)
+        fputc((i * seed) >> 4, f);
+    fclose(f);
+    return utime(filename, &times);
+}
+
+static int read_input(const char *url, const char *dir, int seed)
+{
+    AVDictionary *opts = NULL;
+    AVIOContext *pb = NULL;
+    uint8_t buf[3000];
+    int64_t pos = 0;
+    int i, ret;
+
+    av_dict_set(&opts, "cache_dir", dir, 0);
+    av_dict_set(&opts, "cache_block_size", "4096", 0);
+    ret = avio_open2(&pb, url, AVIO_FLAG_READ, NULL, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+    while ((ret = avio_read(pb, buf, sizeof(buf))) > 0) {
+        for (i = 0; i < ret; i++)
+            if (buf[i] != (uint8_t)(((pos + i) * seed) >> 4)) {
+                printf("wrong data at %"PRId64"\n", pos + i);
+                avio_closep(&pb);
+                return -1;
+            }
+        pos += ret;
+    }
+    avio_closep(&pb);
+    printf("read %"PRId64" bytes\n", pos);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = argc > 1 ? argv[1] : "cache-test.d";
+    char filename[1024], url[1024];
+    int ret = 1;
+
+    mkdir(dir, 0777);
+    clean_dir(dir);
+    snprintf(filename, sizeof(filename), "%s/input.dat", dir);
+    snprintf(url, sizeof(url), "cache:%s", filename);
+
+    av_register_all();
+    av_log_set_callback(log_callback);
+
+    if (write_input(filename, 3, 1000000000) < 0)
+        goto end;
+    printf("first open\n");
+    if (read_input(url, dir, 3) < 0)
+        goto end;
+    printf("second open\n");
+    if (read_input(url, dir, 3) < 0)
+        goto end;
+
+    if (write_input(filename, 5, 1000000001) < 0)
+        goto end;
+    printf("open after modification\n");
+    if (read_input(url, dir, 5) < 0)
+        goto end;
+    ret = 0;
+
+end:
+    clean_dir(dir);
+    rmdir(dir);
+    return ret;
+}
@@ -30,6 +30,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/file.h"
+#include "libavutil/md5.h"
 #include "libavutil/opt.h"
 #include "libavutil/tree.h"
 #include "avformat.h"
@@ -63,6 +64,17 @@ typedef struct Context {
     URLContext *inner;
     int64_t cache_hit, cache_miss;
     int read_ahead_limit;
+
+    /* shared block cache */
+    char *cache_dir;
+    int block_size;
+    int shared;                 ///< blocks are stored in cache_dir
+    int map_fd;                 ///< one byte per block, set once the block is stored
+    int64_t size;               ///< size of the inner resource
+    uint8_t *present;           ///< blocks known to be stored
+    uint8_t *block_buf;         ///< last block read from the inner resource
+    int64_t buf_block;
+    int buf_size;
 } Context;
 
 static int cmp(void *key, const void *node)
@@ -70,23 +82,138 @@ static int cmp(void *key, const void *node)
     return (*(int64_t *) key) - ((const CacheEntry *) node)->logical_pos;
 }
 
+/**
+ * Open the block store of the inner resource in cache_dir.
+ * The blocks of a resource are stored at their offset in a data file, and
+ * a map file holds one byte per block, which is set once the block has been
+ * written, so that several processes can share them. Both are named after a
+ * hash of the URL, the size of the resource and the block size, and for local
+ * files of their inode and modification time, so that a file replaced or
+ * modified in place is not served from stale blocks.
+ *
+ * @return 1 if the shared cache is used, 0 if the resource must be cached
+ *         privately, a negative error code on failure
+ */
+static int open_shared_cache(URLContext *h, const char *url)
+{
+    Context *c = h->priv_data;
+    struct AVMD5 *md5;
+    struct stat st;
+    const char *path, *proto = avio_find_protocol_name(url);
+    uint8_t digest[16];
+    char key[96], *filename;
+    int i, nb_blocks;
+    int access = O_RDWR | O_CREAT;
+
+    c->size = ffurl_size(c->inner);
+    if (c->size <= 0) {
+        av_log(h, AV_LOG_WARNING, "Unknown size, using a private cache\n");
+        return 0;
+    }
+    nb_blocks = (c->size + c->block_size - 1) / c->block_size;
+
+    md5 = av_md5_alloc();
+    if (!md5)
+        return AVERROR(ENOMEM);
+    av_md5_init(md5);
+    av_md5_update(md5, url, strlen(url));
+    snprintf(key, sizeof(key), ":%"PRId64":%d", c->size, c->block_size);
+    av_md5_update(md5, key, strlen(key));
+    path = url;
+    if (proto && !strcmp(proto, "file")) {
+        av_strstart(path, "file:", &path);
+        if (!stat(path, &st)) {
+            snprintf(key, sizeof(key), ":%"PRIu64":%"PRId64,
+                     (uint64_t)st.st_ino, (int64_t)st.st_mtime);
+            av_md5_update(md5, key, strlen(key));
+        }
+    }
+    av_md5_final(md5, digest);
+    av_free(md5);
+    for (i = 0; i < 16; i++)
+        snprintf(key + 2 * i, sizeof(key) - 2 * i, "%02x", digest[i]);
+
+    c->present   = av_mallocz(nb_blocks);
+    c->block_buf = av_malloc(c->block_size);
+    if (!c->present || !c->block_buf)
+        return AVERROR(ENOMEM);
+    c->buf_block = -1;
+
+#ifdef O_BINARY
+    access |= O_BINARY;
+#endif
+    filename = av_asprintf("%s/%s.data", c->cache_dir, key);
+    if (!filename)
+        return AVERROR(ENOMEM);
+    c->fd = avpriv_open(filename, access, 0666);
+    av_free(filename);
+    if (c->fd < 0) {
+        int ret = AVERROR(errno);
+        av_log(h, AV_LOG_ERROR, "Failed to open the cache data in %s\n", c->cache_dir);
+        return ret;
+    }
+
+    filename = av_asprintf("%s/%s.map", c->cache_dir, key);
+    if (!filename)
+        return AVERROR(ENOMEM);
+    c->map_fd = avpriv_open(filename, access, 0666);
+    av_free(filename);
+    if (c->map_fd < 0) {
+        int ret = AVERROR(errno);
+        av_log(h, AV_LOG_ERROR, "Failed to open the cache map in %s\n", c->cache_dir);
+        return ret;
+    }
+
+    c->shared = 1;
+    return 1;
+}
+
 static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
 {
     char *buffername;
     Context *c= h->priv_data;
+    int ret;
 
     av_strstart(arg, "cache:", &arg);
 
+    c->fd = c->map_fd = -1;
+    if (c->cache_dir) {
+        ret = ffurl_open(&c->inner, arg, flags, &h->interrupt_callback, options);
+        if (ret < 0)
+            return ret;
+        ret = open_shared_cache(h, arg);
+        if (ret < 0)
+            goto fail;
+        if (ret)
+            return 0;
+    }
+
     c->fd = av_tempfile("ffcache", &buffername, 0, h);
     if (c->fd < 0){
         av_log(h, AV_LOG_ERROR, "Failed to create tempfile\n");
-        return c->fd;
+        ret = c->fd;
+        goto fail;
     }
 
     unlink(buffername);
     av_freep(&buffername);
 
-    return ffurl_open(&c->inner, arg, flags, &h->interrupt_callback, options);
+    if (!c->inner &&
+        (ret = ffurl_open(&c->inner, arg, flags, &h->interrupt_callback, options)) < 0)
+        goto fail;
+    return 0;
+
+fail:
+    /* cache_close() is not called when the open fails */
+    if (c->fd >= 0)
+        close(c->fd);
+    if (c->map_fd >= 0)
+        close(c->map_fd);
+    c->fd = c->map_fd = -1;
+    ffurl_closep(&c->inner);
+    av_freep(&c->present);
+    av_freep(&c->block_buf);
+    return ret;
 }
 
 static int add_entry(URLContext *h, const unsigned char *buf, int size)
@@ -152,12 +279,103 @@ fail:
     return ret;
 }
 
+static int block_present(Context *c, int64_t block)
+{
+    uint8_t flag = 0;
+
+    /* another process may have stored the block since it was last checked */
+    if (!c->present[block] &&
+        lseek(c->map_fd, block, SEEK_SET) == block &&
+        read(c->map_fd, &flag, 1) == 1 && flag)
+        c->present[block] = 1;
+    return c->present[block];
+}
+
+/* Read a block from the inner resource and add it to the block store. */
+static int fetch_block(URLContext *h, int64_t block)
+{
+    Context *c = h->priv_data;
+    int64_t pos = block * c->block_size;
+    int size    = FFMIN(c->block_size, c->size - pos);
+    int64_t r;
+    uint8_t flag = 1;
+
+    c->buf_block = -1;
+    if (c->inner_pos != pos) {
+        r = ffurl_seek(c->inner, pos, SEEK_SET);
+        if (r < 0) {
+            av_log(h, AV_LOG_ERROR, "Failed to perform internal seek\n");
+            return r;
+        }
+        c->inner_pos = r;
+    }
+
+    r = ffurl_read_complete(c->inner, c->block_buf, size);
+    if (r < 0)
+        return r;
+    c->inner_pos += r;
+    c->buf_block  = block;
+    c->buf_size   = r;
+
+    /* a block is only stored once complete, and flagged once stored */
+    if (r == size) {
+        if (lseek(c->fd, pos, SEEK_SET) != pos ||
+            write(c->fd, c->block_buf, size) != size ||
+            lseek(c->map_fd, block, SEEK_SET) != block ||
+            write(c->map_fd, &flag, 1) != 1) {
+            av_log(h, AV_LOG_WARNING, "Failed to store block %"PRId64" in the cache\n", block);
+        } else {
+            c->present[block] = 1;
+        }
+    }
+    return 0;
+}
+
+static int shared_cache_read(URLContext *h, unsigned char *buf, int size)
+{
+    Context *c = h->priv_data;
+    int64_t block = c->logical_pos / c->block_size;
+    int offset    = c->logical_pos % c->block_size;
+    int r;
+
+    if (c->logical_pos >= c->size)
+        return 0;
+    size = FFMIN(size, c->block_size - offset);
+
+    if (block != c->buf_block && block_present(c, block)) {
+        if (lseek(c->fd, c->logical_pos, SEEK_SET) == c->logical_pos &&
+            (r = read(c->fd, buf, size)) > 0) {
+            c->logical_pos += r;
+            c->cache_hit ++;
+            return r;
+        }
+    }
+
+    if (block != c->buf_block) {
+        r = fetch_block(h, block);
+        if (r < 0)
+            return r;
+        c->cache_miss ++;
+    }
+
+    /* the inner resource ended before its announced size */
+    size = FFMIN(size, c->buf_size - offset);
+    if (size <= 0)
+        return 0;
+    memcpy(buf, c->block_buf + offset, size);
+    c->logical_pos += size;
+    return size;
+}
+
 static int cache_read(URLContext *h, unsigned char *buf, int size)
 {
     Context *c= h->priv_data;
     CacheEntry *entry, *next[2] = {NULL, NULL};
     int r;
 
+    if (c->shared)
+        return shared_cache_read(h, buf, size);
+
     entry = av_tree_find(c->root, &c->logical_pos, cmp, (void**)next);
 
     if (!entry)
@@ -222,6 +440,20 @@ static int64_t cache_seek(URLContext *h, int64_t pos, int whence)
     Context *c= h->priv_data;
     int64_t ret;
 
+    if (c->shared) {
+        if (whence == AVSEEK_SIZE)
+            return c->size;
+        if (whence == SEEK_CUR)
+            pos += c->logical_pos;
+        else if (whence == SEEK_END)
+            pos += c->size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->logical_pos = pos;
+    }
+
     if (whence == AVSEEK_SIZE) {
         pos= ffurl_seek(c->inner, pos, whence);
         if(pos <= 0){
@@ -290,8 +522,12 @@ static int cache_close(URLContext *h)
            c->cache_hit, c->cache_miss);
 
     close(c->fd);
+    if (c->map_fd >= 0)
+        close(c->map_fd);
     ffurl_close(c->inner);
     av_tree_destroy(c->root);
+    av_freep(&c->present);
+    av_freep(&c->block_buf);
 
     return 0;
 }
@@ -301,6 +537,8 @@ static int cache_close(URLContext *h)
 
 static const AVOption options[] = {
     { "read_ahead_limit", "Amount in bytes that may be read ahead when seeking isn't supported, -1 for unlimited", OFFSET(read_ahead_limit), AV_OPT_TYPE_INT, { .i64 = 65536 }, -1, INT_MAX, D },
+    { "cache_dir", "Directory of a block cache shared between processes", OFFSET(cache_dir), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
+    { "cache_block_size", "Size of the blocks of the shared cache", OFFSET(block_size), AV_OPT_TYPE_INT, { .i64 = 1 << 20 }, 4096, 1 << 28, D },
     {NULL},
 };
 
@@ -0,0 +1,100 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Read a file through the mmap mode of the file protocol while it is
+ * truncated between two mapped windows. */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/mem.h"
+#include "avformat.h"
+
+#define WINDOW (1 << 20)
+
+static int check(const uint8_t *buf, int64_t pos, int size)
+{
+    int i;
+
+    for (i = 0; i < size; i++)
+        if (buf[i] != (uint8_t)((pos + i) * 7 >> 3))
+            return -1;
+    return 0;
+}
+
+static int read_to(AVIOContext *pb, uint8_t *buf, int64_t *pos, int64_t end)
+{
+    int ret, total = 0;
+
+    while (*pos < end) {
+        ret = avio_read(pb, buf, FFMIN(WINDOW / 4, end - *pos));
+        if (ret <= 0)
+            break;
+        if (check(buf, *pos, ret) < 0) {
+            printf("wrong data at %"PRId64"\n", *pos);
+            return -1;
+        }
+        *pos  += ret;
+        total += ret;
+    }
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    const char *filename = argc > 1 ? argv[1] : "file-test.dat";
+    AVDictionary *opts = NULL;
+    AVIOContext *pb = NULL;
+    uint8_t *buf;
+    int64_t pos = 0;
+    FILE *f;
+    int i, ret = 1;
+
+    if (!(buf = av_malloc(WINDOW)))
+        return 1;
+    for (i = 0; i < WINDOW; i++)
+        buf[i] = i * 7 >> 3;
+    /* the pattern repeats every WINDOW bytes */
+    if (!(f = fopen(filename, "wb")))
+        goto end;
+    for (i = 0; i < 3; i++)
+        fwrite(buf, 1, WINDOW, f);
+    fclose(f);
+
+    av_register_all();
+    av_dict_set(&opts, "mmap", "1", 0);
+    av_dict_set(&opts, "mmap_window", "1048576", 0);
+    if (avio_open2(&pb, filename, AVIO_FLAG_READ, NULL, &opts) < 0)
+        goto end;
+
+    printf("read %d bytes\n", read_to(pb, buf, &pos, WINDOW));
+    if (truncate(filename, WINDOW + WINDOW / 2) < 0)
+        goto end;
+    printf("truncated to %d bytes\n", WINDOW + WINDOW / 2);
+    printf("read %d bytes\n", read_to(pb, buf, &pos, 3 * WINDOW));
+    printf("eof %d\n", avio_feof(pb));
+    ret = 0;
+
+end:
+    avio_closep(&pb);
+    av_dict_free(&opts);
+    av_free(buf);
+    unlink(filename);
+    return ret;
+}
@@ -32,6 +32,9 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -44,6 +47,9 @@
 #  endif
 #endif
 
+/* amount of data requested ahead of the read position with MADV_WILLNEED */
+#define MMAP_READAHEAD (4 << 20)
+
 /* standard file protocol */
 
 typedef struct FileContext {
@@ -51,16 +57,30 @@ typedef struct FileContext {
     int fd;
     int trunc;
     int blocksize;
+    int use_mmap;
+    int mmap_window;
+#if HAVE_MMAP
+    uint8_t *map;           ///< mapped window of the file, NULL if read() is used
+    int64_t map_start;      ///< file offset of the mapped window
+    size_t map_size;        ///< size of the mapped window
+    int64_t advised;        ///< end of the range passed to MADV_WILLNEED
+    int64_t pos;            ///< read position when reading through the mapping
+    int64_t size;           ///< file size when reading through the mapping
+    int page_size;
+#endif
 } FileContext;
 
 static const AVOption file_options[] = {
     { "truncate", "truncate existing files on write", offsetof(FileContext, trunc), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "read regular files through a memory mapping", offsetof(FileContext, use_mmap), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "mmap_window", "set the size of the mapped part of the file", offsetof(FileContext, mmap_window), AV_OPT_TYPE_INT, { .i64 = 64 << 20 }, 1 << 20, 1 << 30, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
 static const AVOption pipe_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "read regular files through a memory mapping (ignored)", offsetof(FileContext, use_mmap), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -78,10 +98,84 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if HAVE_MMAP
+static void file_unmap(FileContext *c)
+{
+    if (c->map)
+        munmap(c->map, c->map_size);
+    c->map = NULL;
+}
+
+/* Map the window of the file containing the read position. The size of the
+ * file is checked again for each window, so that a file which shrank is
+ * not mapped past its end, and one which grew is read to its new end.
+ * Returns 0 if the read position is at or past the end of the file. */
+static int file_map(FileContext *c)
+{
+    struct stat st;
+    void *map;
+
+    file_unmap(c);
+
+    if (fstat(c->fd, &st) < 0)
+        return AVERROR(errno);
+    c->size = st.st_size;
+    if (c->pos >= c->size)
+        return 0;
+
+    c->map_start = c->pos - c->pos % c->mmap_window;
+    c->map_size  = FFMIN(c->mmap_window, c->size - c->map_start);
+    map = mmap(NULL, c->map_size, PROT_READ, MAP_SHARED, c->fd, c->map_start);
+    if (map == MAP_FAILED)
+        return AVERROR(errno);
+    c->map     = map;
+    c->advised = c->map_start;
+#ifdef MADV_SEQUENTIAL
+    madvise(c->map, c->map_size, MADV_SEQUENTIAL);
+#endif
+    return 1;
+}
+
+static int file_mmap_read(URLContext *h, unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    int64_t offset;
+    int ret;
+
+    if (!c->map || c->pos < c->map_start || c->pos >= c->map_start + c->map_size) {
+        if ((ret = file_map(c)) <= 0)
+            return ret;
+    }
+
+    offset = c->pos - c->map_start;
+#ifdef MADV_WILLNEED
+    /* keep the pages ahead of the read position on their way in */
+    if (c->pos + MMAP_READAHEAD / 2 > c->advised &&
+        c->advised < c->map_start + c->map_size) {
+        int64_t start = FFMAX(c->advised, c->pos) - c->map_start;
+        int64_t end   = FFMIN(c->pos + MMAP_READAHEAD - c->map_start, c->map_size);
+        start -= start % c->page_size;
+        madvise(c->map + start, end - start, MADV_WILLNEED);
+        c->advised = c->map_start + end;
+    }
+#endif
+
+    size = FFMIN(size, c->blocksize);
+    size = FFMIN(size, c->map_size - offset);
+    memcpy(buf, c->map + offset, size);
+    c->pos += size;
+    return size;
+}
+#endif /* HAVE_MMAP */
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int r;
+#if HAVE_MMAP
+    if (c->use_mmap)
+        return file_mmap_read(h, buf, size);
+#endif
     size = FFMIN(size, c->blocksize);
     r = read(c->fd, buf, size);
     return (-1 == r)?AVERROR(errno):r;
@@ -163,6 +257,27 @@ static int file_open(URLContext *h, const char *filename, int flags)
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
 
+    /* only regular files opened for reading can be mapped, anything else
+     * falls back to read() */
+    if (c->use_mmap && (flags & AVIO_FLAG_WRITE || h->is_streamed ||
+                        fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))) {
+        av_log(h, AV_LOG_VERBOSE, "Not reading a regular file, mmap disabled\n");
+        c->use_mmap = 0;
+    }
+#if HAVE_MMAP
+    if (c->use_mmap) {
+#if HAVE_SYSCONF && defined(_SC_PAGESIZE)
+        c->page_size = sysconf(_SC_PAGESIZE);
+#endif
+        if (c->page_size <= 0)
+            c->page_size = 4096;
+        c->mmap_window = FFALIGN(c->mmap_window, c->page_size);
+        c->size        = st.st_size;
+    }
+#else
+    c->use_mmap = 0;
+#endif
+
     return 0;
 }
 
@@ -178,6 +293,29 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+#if HAVE_MMAP
+    if (c->use_mmap) {
+        struct stat st;
+        switch (whence) {
+        case SEEK_SET:
+            break;
+        case SEEK_CUR:
+            pos += c->pos;
+            break;
+        case SEEK_END:
+            if (fstat(c->fd, &st) < 0)
+                return AVERROR(errno);
+            pos += st.st_size;
+            break;
+        default:
+            return AVERROR(EINVAL);
+        }
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->pos = pos;
+    }
+#endif
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
@@ -186,6 +324,9 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+#if HAVE_MMAP
+    file_unmap(c);
+#endif
     return close(c->fd);
 }
 
@@ -226,6 +367,7 @@ static int pipe_open(URLContext *h, const char *filename, int flags)
 #endif
     c->fd = fd;
     h->is_streamed = 1;
+    c->use_mmap = 0;
     return 0;
 }
 
@@ -36,6 +36,7 @@
 #include "avformat.h"
 #include "internal.h"
 #include "os_support.h"
+#include "segment_io.h"
 
 typedef struct HLSSegment {
     char filename[1024];
@@ -85,6 +86,10 @@ typedef struct HLSContext {
     char *baseurl;
     char *format_options_str;
     AVDictionary *format_options;
+
+    int async_io;          // Set by a private option.
+    int nb_preopen;        // Set by a private option.
+    SegmentIO *sio;
 } HLSContext;
 
 static int hls_delete_old_segments(HLSContext *hls) {
@@ -136,11 +141,10 @@ static int hls_delete_old_segments(HLSContext *hls) {
         }
         av_strlcpy(path, dirname, path_size);
         av_strlcat(path, segment->filename, path_size);
-        if (unlink(path) < 0) {
-            av_log(hls, AV_LOG_ERROR, "failed to delete old segment %s: %s\n",
-                                     path, strerror(errno));
-        }
+        ret = ff_segment_io_delete(hls->sio, path);
         av_free(path);
+        if (ret < 0)
+            goto fail;
         previous_segment = segment;
         segment = previous_segment->next;
         av_free(previous_segment);
@@ -240,9 +244,9 @@ static int hls_window(AVFormatContext *s, int last)
     HLSContext *hls = s->priv_data;
     HLSSegment *en;
     int target_duration = 0;
-    int ret = 0;
+    int ret = 0, size;
     AVIOContext *out = NULL;
-    char temp_filename[1024];
+    uint8_t *buf;
     int64_t sequence = FFMAX(hls->start_sequence, hls->sequence - hls->nb_entries);
     int version = hls->flags & HLS_SINGLE_FILE ? 4 : 3;
     const char *proto = avio_find_protocol_name(s->filename);
@@ -252,10 +256,8 @@ static int hls_window(AVFormatContext *s, int last)
     if (!use_rename && !warned_non_file++)
         av_log(s, AV_LOG_ERROR, "Cannot use rename on non file protocol, this may lead to races and temporarly partial files\n");
 
-    snprintf(temp_filename, sizeof(temp_filename), use_rename ? "%s.tmp" : "%s", s->filename);
-    if ((ret = avio_open2(&out, temp_filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0)
-        goto fail;
+    if ((ret = avio_open_dyn_buf(&out)) < 0)
+        return ret;
 
     for (en = hls->segments; en; en = en->next) {
         if (target_duration < en->duration)
@@ -286,11 +288,9 @@ static int hls_window(AVFormatContext *s, int last)
     if (last)
         avio_printf(out, "#EXT-X-ENDLIST\n");
 
-fail:
-    avio_closep(&out);
-    if (ret >= 0 && use_rename)
-        ff_rename(temp_filename, s->filename, s);
-    return ret;
+    /* replaced through a temporary file and a rename for local files */
+    size = avio_close_dyn_buf(out, &buf);
+    return ff_segment_io_write_file(hls->sio, s->filename, buf, size);
 }
 
 static int hls_start(AVFormatContext *s)
@@ -310,10 +310,23 @@ static int hls_start(AVFormatContext *s)
         }
     c->number++;
 
-    if ((err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0)
+    if ((err = ff_segment_io_open(c->sio, &oc->pb, oc->filename)) < 0)
         return err;
 
+    /* the names of the next segments are known unless they wrap */
+    if (!(c->flags & HLS_SINGLE_FILE) && !c->wrap) {
+        char filename[sizeof(oc->filename)];
+        int i;
+
+        for (i = 1; i <= c->nb_preopen; i++) {
+            if (av_get_frame_filename(filename, sizeof(filename),
+                                      c->basename, c->sequence + i) < 0)
+                break;
+            if ((err = ff_segment_io_preopen(c->sio, filename)) < 0)
+                return err;
+        }
+    }
+
     if (oc->oformat->priv_class && oc->priv_data)
         av_opt_set(oc->priv_data, "mpegts_flags", "resend_headers", 0);
 
@@ -385,6 +398,10 @@ static int hls_write_header(AVFormatContext *s)
     if ((ret = hls_mux_init(s)) < 0)
         goto fail;
 
+    if ((ret = ff_segment_io_alloc(&hls->sio, s, &s->interrupt_callback,
+                                   hls->async_io, hls->nb_preopen)) < 0)
+        goto fail;
+
     if ((ret = hls_start(s)) < 0)
         goto fail;
 
@@ -408,6 +425,7 @@ fail:
         av_freep(&hls->basename);
         if (hls->avf)
             avformat_free_context(hls->avf);
+        ff_segment_io_free(&hls->sio);
     }
     return ret;
 }
@@ -458,9 +476,8 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
                 av_opt_set(hls->avf->priv_data, "mpegts_flags", "resend_headers", 0);
             hls->number++;
         } else {
-            avio_closep(&oc->pb);
-
-            ret = hls_start(s);
+            if ((ret = ff_segment_io_close(hls->sio, &oc->pb)) >= 0)
+                ret = hls_start(s);
         }
 
         if (ret < 0)
@@ -481,21 +498,23 @@ static int hls_write_trailer(struct AVFormatContext *s)
 {
     HLSContext *hls = s->priv_data;
     AVFormatContext *oc = hls->avf;
+    int ret;
 
     av_write_trailer(oc);
     if (oc->pb) {
         hls->size = avio_tell(hls->avf->pb) - hls->start_pos;
-        avio_closep(&oc->pb);
+        ff_segment_io_close(hls->sio, &oc->pb);
         hls_append_segment(hls, hls->duration, hls->start_pos, hls->size);
     }
     av_freep(&hls->basename);
     avformat_free_context(oc);
     hls->avf = NULL;
     hls_window(s, 1);
+    ret = ff_segment_io_free(&hls->sio);
 
     hls_free_segments(hls->segments);
     hls_free_segments(hls->old_segments);
-    return 0;
+    return ret;
 }
 
 #define OFFSET(x) offsetof(HLSContext, x)
@@ -512,6 +531,8 @@ static const AVOption options[] = {
     {"hls_flags",     "set flags affecting HLS playlist and media file generation", OFFSET(flags), AV_OPT_TYPE_FLAGS, {.i64 = 0 }, 0, UINT_MAX, E, "flags"},
     {"single_file",   "generate a single media file indexed with byte ranges", 0, AV_OPT_TYPE_CONST, {.i64 = HLS_SINGLE_FILE }, 0, UINT_MAX,   E, "flags"},
     {"delete_segments", "delete segment files that are no longer part of the playlist", 0, AV_OPT_TYPE_CONST, {.i64 = HLS_DELETE_SEGMENTS }, 0, UINT_MAX,   E, "flags"},
+    {"hls_async_io",  "close the segments and write the playlist in a background thread", OFFSET(async_io), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E},
+    {"hls_preopen",   "set number of segment files opened ahead with hls_async_io", OFFSET(nb_preopen), AV_OPT_TYPE_INT, {.i64 = 2}, 0, 16, E},
 
     { NULL },
 };
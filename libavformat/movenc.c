@@ -54,6 +54,7 @@ static const AVOption options[] = {
     { "movflags", "MOV muxer flags", offsetof(MOVMuxContext, flags), AV_OPT_TYPE_FLAGS, {.i64 = 0}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "rtphint", "Add RTP hint tracks", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_RTP_HINT}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "moov_size", "maximum moov size so it can be placed at the begin", offsetof(MOVMuxContext, reserved_moov_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, 0 },
+    { "expected_duration", "expected duration, used with faststart to reserve the moov space in place", offsetof(MOVMuxContext, expected_duration), AV_OPT_TYPE_DURATION, {.i64 = 0}, 0, INT64_MAX, AV_OPT_FLAG_ENCODING_PARAM, 0 },
     { "empty_moov", "Make the initial moov atom empty", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_EMPTY_MOOV}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "frag_keyframe", "Fragment at video keyframes", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_KEYFRAME}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "separate_moof", "Write separate moof/mdat atoms for each track", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_SEPARATE_MOOF}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -64,6 +65,7 @@ static const AVOption options[] = {
     { "disable_chpl", "Disable Nero chapter atom", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_DISABLE_CHPL}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "default_base_moof", "Set the default-base-is-moof flag in tfhd atoms", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_DEFAULT_BASE_MOOF}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "dash", "Write DASH compatible fragmented MP4", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_DASH}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
+    { "cmaf", "Write CMAF fragments, each built in memory and written at once with its sidx", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_CMAF}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "frag_discont", "Signal that the next fragment is discontinuous from earlier ones", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_FRAG_DISCONT}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "delay_moov", "Delay writing the initial moov until the first fragment is cut, or until the first fragment flush", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_DELAY_MOOV}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
     { "write_colr", "Write colr atom (Experimental, may be renamed or changed, do not use from scripts)", 0, AV_OPT_TYPE_CONST, {.i64 = FF_MOV_FLAG_WRITE_COLR}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -94,6 +96,8 @@ static const AVClass flavor ## _muxer_class = {\
 
 static int get_moov_size(AVFormatContext *s);
 
+#define MOV_SHIFT_BUF_SIZE (1 << 20)
+
 static int utf8len(const uint8_t *b)
 {
     int len = 0;
@@ -3535,7 +3539,7 @@ static int mov_add_tfra_entries(AVIOContext *pb, MOVMuxContext *mov, int tracks,
             track->frag_info_capacity = new_capacity;
         }
         info = &track->frag_info[track->nb_frag_info - 1];
-        info->offset   = avio_tell(pb);
+        info->offset   = mov->fragment_pos + avio_tell(pb);
         info->size     = size;
         // Try to recreate the original pts for the first packet
         // from the fields we have stored
@@ -3616,7 +3620,7 @@ static int mov_write_moof_tag_internal(AVIOContext *pb, MOVMuxContext *mov,
             continue;
         if (!track->entry)
             continue;
-        mov_write_traf_tag(pb, mov, track, pos, moof_size);
+        mov_write_traf_tag(pb, mov, track, mov->fragment_pos + pos, moof_size);
     }
 
     return update_size(pb, pos);
@@ -3868,6 +3872,9 @@ static int mov_write_ftyp_tag(AVIOContext *pb, AVFormatContext *s)
     if (mov->flags & FF_MOV_FLAG_DASH && mov->flags & FF_MOV_FLAG_FASTSTART)
         ffio_wfourcc(pb, "dash");
 
+    if (mov->flags & FF_MOV_FLAG_CMAF)
+        ffio_wfourcc(pb, "cmfc");
+
     return update_size(pb, pos);
 }
 
@@ -4042,6 +4049,7 @@ static void mov_parse_vc1_frame(AVPacket *pkt, MOVTrack *trk, int fragment)
 static int mov_flush_fragment(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
+    AVIOContext *pb = s->pb;
     int i, first_track = -1;
     int64_t mdat_size = 0;
     int ret;
@@ -4114,6 +4122,14 @@ static int mov_flush_fragment(AVFormatContext *s)
     if (!mdat_size)
         return 0;
 
+    /* With cmaf, the sidx, moof and mdat atoms are assembled in memory and
+     * handed to the output in a single write, without seeking back. */
+    if (mov->flags & FF_MOV_FLAG_CMAF) {
+        if ((ret = avio_open_dyn_buf(&pb)) < 0)
+            return ret;
+        mov->fragment_pos = avio_tell(s->pb);
+    }
+
     for (i = 0; i < mov->nb_streams; i++) {
         MOVTrack *track = &mov->tracks[i];
         int buf_size, write_moof = 1, moof_tracks = -1;
@@ -4133,13 +4149,13 @@ static int mov_flush_fragment(AVFormatContext *s)
         }
 
         if (write_moof) {
-            avio_flush(s->pb);
+            avio_flush(pb);
 
-            mov_write_moof_tag(s->pb, mov, moof_tracks, mdat_size);
+            mov_write_moof_tag(pb, mov, moof_tracks, mdat_size);
             mov->fragments++;
 
-            avio_wb32(s->pb, mdat_size + 8);
-            ffio_wfourcc(s->pb, "mdat");
+            avio_wb32(pb, mdat_size + 8);
+            ffio_wfourcc(pb, "mdat");
         }
 
         if (track->entry)
@@ -4150,8 +4166,16 @@ static int mov_flush_fragment(AVFormatContext *s)
         buf_size = avio_close_dyn_buf(track->mdat_buf, &buf);
         track->mdat_buf = NULL;
 
+        avio_write(pb, buf, buf_size);
+        av_free(buf);
+    }
+
+    if (pb != s->pb) {
+        uint8_t *buf;
+        int buf_size = avio_close_dyn_buf(pb, &buf);
         avio_write(s->pb, buf, buf_size);
         av_free(buf);
+        mov->fragment_pos = 0;
     }
 
     mov->mdat_size = 0;
@@ -4797,6 +4821,59 @@ static int mov_create_dvd_sub_decoder_specific_info(MOVTrack *track,
     return 0;
 }
 
+/*
+ * Estimate of the moov size for a file of expected_duration, used to
+ * reserve space for faststart without shifting the mdat. A video sample
+ * costs at most one stsz, ctts, co64, stts and stss entry; audio samples of
+ * constant duration share one stts entry and are all sync samples. A small
+ * margin covers the per track atoms. This is not a bound: the rates come
+ * from the stream parameters, so a longer file or a higher actual rate
+ * overflows the reservation, which is then handled by shifting the data.
+ */
+static int estimate_moov_size(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    double duration = mov->expected_duration / (double)AV_TIME_BASE;
+    double size = 4096;
+    int i;
+
+    for (i = 0; i < mov->nb_streams; i++) {
+        MOVTrack *track = &mov->tracks[i];
+        double rate = 0;
+        int per_sample = 32;
+
+        size += 1024;
+        if (i >= s->nb_streams || !track->enc)
+            continue;
+        switch (track->enc->codec_type) {
+        case AVMEDIA_TYPE_VIDEO:
+            if (track->st->avg_frame_rate.num > 0 && track->st->avg_frame_rate.den > 0)
+                rate = av_q2d(track->st->avg_frame_rate);
+            else if (track->enc->time_base.num > 0 && track->enc->time_base.den > 0)
+                rate = 1 / av_q2d(track->enc->time_base);
+            else
+                rate = 60;
+            if (mov->flags & FF_MOV_FLAG_RTP_HINT)
+                per_sample += 40;
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            rate = track->enc->sample_rate /
+                   (double)(track->enc->frame_size > 0 ? track->enc->frame_size : 1024);
+            per_sample = 12;
+            if (mov->flags & FF_MOV_FLAG_RTP_HINT)
+                per_sample += 20;
+            break;
+        default:
+            rate = 1;
+            break;
+        }
+        size += duration * rate * per_sample;
+    }
+    size *= 1.1;
+
+    return size < INT_MAX ? (int)size : INT_MAX;
+}
+
 static int mov_write_header(AVFormatContext *s)
 {
     AVIOContext *pb = s->pb;
@@ -4837,11 +4914,30 @@ static int mov_write_header(AVFormatContext *s)
     if (mov->mode == MODE_ISM)
         mov->flags |= FF_MOV_FLAG_EMPTY_MOOV | FF_MOV_FLAG_SEPARATE_MOOF |
                       FF_MOV_FLAG_FRAGMENT;
+    if (mov->flags & FF_MOV_FLAG_CMAF) {
+        if (mov->mode == MODE_ISM || mov->flags & FF_MOV_FLAG_FASTSTART) {
+            av_log(s, AV_LOG_ERROR, "The cmaf flag can not be combined with "
+                   "ismv output or faststart\n");
+            return AVERROR(EINVAL);
+        }
+        if (!(mov->flags & (FF_MOV_FLAG_FRAG_KEYFRAME | FF_MOV_FLAG_FRAG_CUSTOM)) &&
+            !mov->max_fragment_duration && !mov->max_fragment_size)
+            mov->flags |= FF_MOV_FLAG_FRAG_KEYFRAME;
+        if (s->nb_streams > 1 && !(mov->flags & FF_MOV_FLAG_SEPARATE_MOOF))
+            av_log(s, AV_LOG_WARNING, "CMAF fragments should contain a single "
+                   "track, consider using separate_moof\n");
+        mov->flags |= FF_MOV_FLAG_DASH;
+    }
     if (mov->flags & FF_MOV_FLAG_DASH)
         mov->flags |= FF_MOV_FLAG_FRAGMENT | FF_MOV_FLAG_EMPTY_MOOV |
                       FF_MOV_FLAG_DEFAULT_BASE_MOOF;
 
-    if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+    /* Without a reservation hint, faststart moves the whole mdat in the
+     * trailer. With one, the moov is written into the reserved space and
+     * the data is only shifted if the space turns out to be too small. */
+    if (mov->flags & FF_MOV_FLAG_FASTSTART &&
+        (mov->flags & FF_MOV_FLAG_FRAGMENT ||
+         (!mov->reserved_moov_size && !mov->expected_duration))) {
         mov->reserved_moov_size = -1;
     }
 
@@ -5066,6 +5162,8 @@ static int mov_write_header(AVFormatContext *s)
 
     enable_tracks(s);
 
+    if (mov->flags & FF_MOV_FLAG_FASTSTART && !mov->reserved_moov_size)
+        mov->reserved_moov_size = estimate_moov_size(s);
 
     if (mov->reserved_moov_size){
         mov->reserved_moov_pos= avio_tell(pb);
@@ -5080,7 +5178,7 @@ static int mov_write_header(AVFormatContext *s)
             !mov->max_fragment_duration && !mov->max_fragment_size)
             mov->flags |= FF_MOV_FLAG_FRAG_KEYFRAME;
     } else {
-        if (mov->flags & FF_MOV_FLAG_FASTSTART)
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size < 0)
             mov->reserved_moov_pos = avio_tell(pb);
         mov_write_mdat_tag(pb, mov);
     }
@@ -5174,9 +5272,10 @@ static int get_sidx_size(AVFormatContext *s)
  * This function gets the moov size if moved to the top of the file: the chunk
  * offset table can switch between stco (32-bit entries) to co64 (64-bit
  * entries) when the moov is moved to the beginning, so the size of the moov
- * would change. It also updates the chunk offset tables.
+ * would change. It also updates the chunk offset tables, taking into account
+ * the available bytes already reserved in front of the data.
  */
-static int compute_moov_size(AVFormatContext *s)
+static int compute_moov_size(AVFormatContext *s, int available)
 {
     int i, moov_size, moov_size2;
     MOVMuxContext *mov = s->priv_data;
@@ -5186,7 +5285,7 @@ static int compute_moov_size(AVFormatContext *s)
         return moov_size;
 
     for (i = 0; i < mov->nb_streams; i++)
-        mov->tracks[i].data_offset += moov_size;
+        mov->tracks[i].data_offset += moov_size - available;
 
     moov_size2 = get_moov_size(s);
     if (moov_size2 < 0)
@@ -5218,7 +5317,7 @@ static int compute_sidx_size(AVFormatContext *s)
 
 static int shift_data(AVFormatContext *s)
 {
-    int ret = 0, moov_size;
+    int ret = 0, moov_size, reserved, shift, buf_size;
     MOVMuxContext *mov = s->priv_data;
     int64_t pos, pos_end = avio_tell(s->pb);
     uint8_t *buf, *read_buf[2];
@@ -5226,18 +5325,25 @@ static int shift_data(AVFormatContext *s)
     int read_size[2];
     AVIOContext *read_pb;
 
+    /* when space was reserved in front of the data, only shift by what is
+     * missing, keeping room for a free atom behind the moov */
+    reserved = FFMAX(mov->reserved_moov_size, 0);
     if (mov->flags & FF_MOV_FLAG_FRAGMENT)
         moov_size = compute_sidx_size(s);
     else
-        moov_size = compute_moov_size(s);
+        moov_size = compute_moov_size(s, reserved ? reserved - 8 : 0);
     if (moov_size < 0)
         return moov_size;
+    shift = reserved ? moov_size + 8 - reserved : moov_size;
 
-    buf = av_malloc(moov_size * 2);
+    /* each block is read before the previous one is written back, so the
+     * blocks must be at least as large as the shift */
+    buf_size = FFALIGN(FFMAX(shift, MOV_SHIFT_BUF_SIZE), 4096);
+    buf = av_malloc(2 * (size_t)buf_size);
     if (!buf)
         return AVERROR(ENOMEM);
     read_buf[0] = buf;
-    read_buf[1] = buf + moov_size;
+    read_buf[1] = buf + buf_size;
 
     /* Shift the data: the AVIO context of the output can only be used for
      * writing, so we re-open the same output, but for reading. It also avoids
@@ -5253,18 +5359,18 @@ static int shift_data(AVFormatContext *s)
     /* mark the end of the shift to up to the last data we wrote, and get ready
      * for writing */
     pos_end = avio_tell(s->pb);
-    avio_seek(s->pb, mov->reserved_moov_pos + moov_size, SEEK_SET);
+    avio_seek(s->pb, mov->reserved_moov_pos + reserved + shift, SEEK_SET);
 
-    /* start reading at where the new moov will be placed */
-    avio_seek(read_pb, mov->reserved_moov_pos, SEEK_SET);
+    /* start reading at where the data begins */
+    avio_seek(read_pb, mov->reserved_moov_pos + reserved, SEEK_SET);
     pos = avio_tell(read_pb);
 
 #define READ_BLOCK do {                                                             \
-    read_size[read_buf_id] = avio_read(read_pb, read_buf[read_buf_id], moov_size);  \
+    read_size[read_buf_id] = avio_read(read_pb, read_buf[read_buf_id], buf_size);   \
     read_buf_id ^= 1;                                                               \
 } while (0)
 
-    /* shift data by chunk of at most moov_size */
+    /* shift data by chunk of at most buf_size */
     READ_BLOCK;
     do {
         int n;
@@ -5277,6 +5383,9 @@ static int shift_data(AVFormatContext *s)
     } while (pos < pos_end);
     avio_close(read_pb);
 
+    if (reserved)
+        mov->reserved_moov_size += shift;
+
 end:
     av_free(buf);
     return ret;
@@ -5332,7 +5441,7 @@ static int mov_write_trailer(AVFormatContext *s)
         }
         avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_moov_pos : moov_pos, SEEK_SET);
 
-        if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size < 0) {
             av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
             res = shift_data(s);
             if (res == 0) {
@@ -5342,6 +5451,22 @@ static int mov_write_trailer(AVFormatContext *s)
             }
         } else if (mov->reserved_moov_size > 0) {
             int64_t size;
+            if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+                int moov_size = get_moov_size(s);
+                if (moov_size < 0) {
+                    res = moov_size;
+                    goto error;
+                }
+                if (moov_size + 8 > mov->reserved_moov_size) {
+                    av_log(s, AV_LOG_INFO, "Reserved moov space too small (%d < %d), "
+                           "shifting the data\n", mov->reserved_moov_size, moov_size + 8);
+                    avio_seek(pb, moov_pos, SEEK_SET);
+                    if ((res = shift_data(s)) < 0)
+                        goto error;
+                    moov_pos = avio_tell(pb);
+                    avio_seek(pb, mov->reserved_moov_pos, SEEK_SET);
+                }
+            }
             if ((res = mov_write_moov_tag(pb, mov, s)) < 0)
                 goto error;
             size = mov->reserved_moov_size - (avio_tell(pb) - mov->reserved_moov_pos);
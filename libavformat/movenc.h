@@ -178,6 +178,8 @@ typedef struct MOVMuxContext {
 
     int reserved_moov_size; ///< 0 for disabled, -1 for automatic, size otherwise
     int64_t reserved_moov_pos;
+    int64_t expected_duration; ///< used to estimate the moov size for in-place faststart
+    int64_t fragment_pos;      ///< file position of a fragment built in memory
 
     char *major_brand;
 
@@ -204,6 +206,7 @@ typedef struct MOVMuxContext {
 #define FF_MOV_FLAG_DELAY_MOOV            (1 << 13)
 #define FF_MOV_FLAG_WRITE_COLR            (1 << 14)
 #define FF_MOV_FLAG_WRITE_GAMA            (1 << 15)
+#define FF_MOV_FLAG_CMAF                  (1 << 16)
 
 int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt);
 
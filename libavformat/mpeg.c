@@ -136,6 +136,7 @@ typedef struct MpegDemuxContext {
     AVFormatContext *sub_ctx;
     FFDemuxSubtitlesQueue q[32];
 #endif
+    AVBufferPool *pools[32]; ///< packet buffers, one pool per power of two size class
 } MpegDemuxContext;
 
 /*--vgtmpeg start*/
@@ -668,6 +669,43 @@ redo:
     return len;
 }
 
+/* Same as av_get_packet(), but with the payload taken from a buffer pool
+ * so that the per packet allocations are recycled. */
+static int mpegps_get_packet(AVFormatContext *s, AVPacket *pkt, int size)
+{
+    MpegDemuxContext *m = s->priv_data;
+    int index = av_log2(size + FF_INPUT_BUFFER_PADDING_SIZE);
+    int ret;
+
+    av_init_packet(pkt);
+    pkt->data = NULL;
+    pkt->size = 0;
+    pkt->pos  = avio_tell(s->pb);
+
+    if (!m->pools[index]) {
+        m->pools[index] = av_buffer_pool_init(2 << index, NULL);
+        if (!m->pools[index])
+            return AVERROR(ENOMEM);
+    }
+    pkt->buf = av_buffer_pool_get(m->pools[index]);
+    if (!pkt->buf)
+        return AVERROR(ENOMEM);
+    pkt->data = pkt->buf->data;
+
+    /* an empty payload still gets a padded buffer, like av_get_packet() */
+    ret = size ? avio_read(s->pb, pkt->data, size) : 0;
+    if (ret < 0 || (!ret && size)) {
+        av_free_packet(pkt);
+        return ret;
+    }
+    if (ret < size)
+        pkt->flags |= AV_PKT_FLAG_CORRUPT;
+    pkt->size = ret;
+    memset(pkt->data + ret, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    return ret;
+}
+
 static int mpegps_read_packet(AVFormatContext *s,
                               AVPacket *pkt)
 {
@@ -679,12 +717,28 @@ static int mpegps_read_packet(AVFormatContext *s,
     enum AVCodecID codec_id = AV_CODEC_ID_NONE;
     enum AVMediaType type;
     int64_t pts, dts, dummy_pos; // dummy_pos is needed for the index building to work
+    uint32_t privateid;
 
 redo:
     len = mpegps_read_pes_header(s, &dummy_pos, &startcode, &pts, &dts);
     if (len < 0)
         return len;
 
+    /* find the stream first, the payloads of discarded streams are
+     * skipped without being looked at */
+/* -- vgtmpeg */
+    privateid = get_current_privateid(s, startcode);
+/* -- vgtmpeg */
+    st = NULL;
+    for (i = 0; i < s->nb_streams; i++) {
+        if (s->streams[i]->id == privateid) {
+            st = s->streams[i];
+            break;
+        }
+    }
+    if (st && st->discard >= AVDISCARD_ALL)
+        goto skip;
+
     if (startcode >= 0x80 && startcode <= 0xcf) {
         if (len < 4)
             goto skip;
@@ -700,14 +754,8 @@ redo:
         }
     }
 
-    /* now find stream */
-    for (i = 0; i < s->nb_streams; i++) {
-        st = s->streams[i];
-/* -- vgtmpeg */
-        if (st->id == get_current_privateid(s,startcode))
-/* -- vgtmpeg */
-            goto found;
-    }
+    if (st)
+        goto found;
 
     es_type = m->psm_es_type[startcode & 0xff];
         if (es_type == STREAM_TYPE_VIDEO_MPEG1) {
@@ -796,9 +844,7 @@ skip:
     st = avformat_new_stream(s, NULL);
     if (!st)
         goto skip;
-/* -- vgtmpeg */
-    st->id = get_current_privateid(s,startcode);
-/* -- vgtmpeg */
+    st->id = privateid;
     st->codec->codec_type = type;
     st->codec->codec_id   = codec_id;
     if (st->codec->codec_id == AV_CODEC_ID_PCM_MULAW) {
@@ -810,8 +856,6 @@ skip:
     st->need_parsing      = AVSTREAM_PARSE_FULL;
 
 found:
-    if (st->discard >= AVDISCARD_ALL)
-        goto skip;
     if (startcode >= 0xa0 && startcode <= 0xaf) {
       if (lpcm_header_len == 6 && st->codec->codec_id == AV_CODEC_ID_MLP) {
             if (len < 6)
@@ -820,7 +864,7 @@ found:
             len -=6;
       }
     }
-    ret = av_get_packet(s->pb, pkt, len);
+    ret = mpegps_get_packet(s, pkt, len);
 
     pkt->pts          = pts;
     pkt->dts          = dts;
@@ -863,6 +907,16 @@ static int64_t mpegps_read_dts(AVFormatContext *s, int stream_index,
     return dts;
 }
 
+static int mpegps_read_close(AVFormatContext *s)
+{
+    MpegDemuxContext *m = s->priv_data;
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(m->pools); i++)
+        av_buffer_pool_uninit(&m->pools[i]);
+    return 0;
+}
+
 AVInputFormat ff_mpegps_demuxer = {
     .name           = "mpeg",
     .long_name      = NULL_IF_CONFIG_SMALL("MPEG-PS (MPEG-2 Program Stream)"),
@@ -870,6 +924,7 @@ AVInputFormat ff_mpegps_demuxer = {
     .read_probe     = mpegps_probe,
     .read_header    = mpegps_read_header,
     .read_packet    = mpegps_read_packet,
+    .read_close     = mpegps_read_close,
     .read_timestamp = mpegps_read_dts,
     .flags          = AVFMT_SHOW_IDS | AVFMT_TS_DISCONT,
 };
@@ -155,6 +155,20 @@ struct MpegTSContext {
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
+
+    /** packets of these pids are dropped before any parsing: they have no
+     *  filter, or belong only to discarded programs or streams */
+    uint8_t drop_pid[NB_PID_MAX];
+#define DROP_PID_STALE 0x80
+    /** some program has .discard=AVDISCARD_ALL */
+    int discarded_programs;
+    /** program and stream discard flags drop_pid was computed for */
+    uint8_t *discard_state;
+    unsigned int discard_state_size;
+    unsigned int nb_discard_state;
+
+    /** PES payload buffers, one pool per power of two size class */
+    AVBufferPool *pools[32];
 };
 
 #define MPEGTS_OPTIONS \
@@ -348,11 +362,21 @@ static void clear_avprogram(MpegTSContext *ts, unsigned int programid)
     prg->nb_stream_indexes = 0;
 }
 
+static void invalidate_drop_pids(MpegTSContext *ts)
+{
+    int i;
+
+    for (i = 0; i < NB_PID_MAX; i++)
+        ts->drop_pid[i] |= DROP_PID_STALE;
+}
+
 static void clear_program(MpegTSContext *ts, unsigned int programid)
 {
     int i;
 
     clear_avprogram(ts, programid);
+    if (ts->discarded_programs)
+        invalidate_drop_pids(ts);
     for (i = 0; i < ts->nb_prg; i++)
         if (ts->prg[i].id == programid) {
             ts->prg[i].nb_pids = 0;
@@ -364,6 +388,8 @@ static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg = 0;
+    if (ts->discarded_programs)
+        invalidate_drop_pids(ts);
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -396,6 +422,8 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
             return;
 
     p->pids[p->nb_pids++] = pid;
+    if (ts->discarded_programs)
+        ts->drop_pid[pid] |= DROP_PID_STALE;
 }
 
 static void set_pmt_found(MpegTSContext *ts, unsigned int programid)
@@ -460,6 +488,85 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+static int discard_pes(MpegTSFilter *filter)
+{
+    PESContext *pes;
+
+    if (filter->type != MPEGTS_PES)
+        return 0;
+    pes = filter->u.pes_filter.opaque;
+    return pes->st && pes->st->discard == AVDISCARD_ALL &&
+           (!pes->sub_st || pes->sub_st->discard == AVDISCARD_ALL);
+}
+
+/**
+ * Decide again whether the packets of pid are dropped up front, once the
+ * filter or the programs it belongs to changed.
+ */
+static void update_drop_pid(MpegTSContext *ts, unsigned int pid)
+{
+    MpegTSFilter *f = ts->pids[pid];
+    int old_drop = ts->drop_pid[pid] & ~DROP_PID_STALE;
+    int drop     = 0;
+
+    /* the PAT is always parsed */
+    if (pid) {
+        drop = f ? discard_pes(f) : !ts->auto_guess;
+        if (!drop)
+            drop = discard_pid(ts, pid);
+    }
+    ts->drop_pid[pid] = drop;
+
+    if (f && drop != old_drop) {
+        /* the packets in between were not looked at */
+        f->last_cc = -1;
+        if (drop && f->type == MPEGTS_PES) {
+            PESContext *pes = f->u.pes_filter.opaque;
+            av_buffer_unref(&pes->buffer);
+            pes->data_index = 0;
+            pes->state      = MPEGTS_SKIP;
+        }
+    }
+}
+
+/**
+ * Mark every pid stale if the discard flags of the programs or streams
+ * changed since the last call.
+ */
+static void check_discard_state(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    unsigned int nb_state = s->nb_programs + s->nb_streams + 1;
+    int changed = nb_state != ts->nb_discard_state;
+    int i;
+
+    av_fast_malloc(&ts->discard_state, &ts->discard_state_size, nb_state);
+    if (!ts->discard_state) {
+        ts->nb_discard_state = 0;
+        invalidate_drop_pids(ts);
+        return;
+    }
+    ts->discarded_programs = 0;
+    for (i = 0; i < nb_state; i++) {
+        uint8_t state;
+        if (i < s->nb_programs) {
+            state = s->programs[i]->discard == AVDISCARD_ALL;
+            ts->discarded_programs |= state;
+        } else if (i < nb_state - 1) {
+            state = s->streams[i - s->nb_programs]->discard == AVDISCARD_ALL;
+        } else {
+            state = ts->auto_guess;
+        }
+        if (changed || ts->discard_state[i] != state) {
+            ts->discard_state[i] = state;
+            changed = 1;
+        }
+    }
+    ts->nb_discard_state = nb_state;
+    if (changed)
+        invalidate_drop_pids(ts);
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -531,6 +638,7 @@ static MpegTSFilter *mpegts_open_filter(MpegTSContext *ts, unsigned int pid,
     filter->es_id   = -1;
     filter->last_cc = -1;
     filter->last_pcr= -1;
+    ts->drop_pid[pid] |= DROP_PID_STALE;
 
     return filter;
 }
@@ -598,6 +706,7 @@ static void mpegts_close_filter(MpegTSContext *ts, MpegTSFilter *filter)
 
     av_free(filter);
     ts->pids[pid] = NULL;
+    ts->drop_pid[pid] |= DROP_PID_STALE;
 }
 
 static int analyze(const uint8_t *buf, int size, int packet_size, int *index,
@@ -852,6 +961,7 @@ static int mpegts_set_stream_info(AVStream *st, PESContext *pes,
     st->need_parsing      = AVSTREAM_PARSE_FULL;
     pes->st          = st;
     pes->stream_type = stream_type;
+    pes->ts->drop_pid[pes->pid] |= DROP_PID_STALE;
 
     av_log(pes->stream, AV_LOG_DEBUG,
            "stream=%d stream_type=%x pid=%x prog_reg_desc=%.4s\n",
@@ -899,6 +1009,18 @@ static int mpegts_set_stream_info(AVStream *st, PESContext *pes,
     return 0;
 }
 
+static AVBufferRef *buffer_pool_get(MpegTSContext *ts, int size)
+{
+    int index = av_log2(size + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!ts->pools[index]) {
+        int pool_size = FFMIN(MAX_PES_PAYLOAD + FF_INPUT_BUFFER_PADDING_SIZE, 2 << index);
+        ts->pools[index] = av_buffer_pool_init(pool_size, NULL);
+        if (!ts->pools[index])
+            return NULL;
+    }
+    return av_buffer_pool_get(ts->pools[index]);
+}
+
 static void reset_pes_packet_state(PESContext *pes)
 {
     pes->pts        = AV_NOPTS_VALUE;
@@ -1086,8 +1208,7 @@ static int mpegts_push_data(MpegTSFilter *filter,
                         pes->total_size = MAX_PES_PAYLOAD;
 
                     /* allocate pes buffer */
-                    pes->buffer = av_buffer_alloc(pes->total_size +
-                                                  FF_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = buffer_pool_get(ts, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
 
@@ -1237,8 +1358,7 @@ skip:
                     pes->data_index + buf_size > pes->total_size) {
                     new_pes_packet(pes, ts->pkt);
                     pes->total_size = MAX_PES_PAYLOAD;
-                    pes->buffer = av_buffer_alloc(pes->total_size +
-                                                  FF_INPUT_BUFFER_PADDING_SIZE);
+                    pes->buffer = buffer_pool_get(ts, pes->total_size);
                     if (!pes->buffer)
                         return AVERROR(ENOMEM);
                     ts->stop_parse = 1;
@@ -2208,7 +2328,9 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
-    if (pid && discard_pid(ts, pid))
+    if (ts->drop_pid[pid] & DROP_PID_STALE)
+        update_drop_pid(ts, pid);
+    if (ts->drop_pid[pid])
         return 0;
     is_start = packet[1] & 0x40;
     tss = ts->pids[pid];
@@ -2370,6 +2492,20 @@ static int mpegts_resync(AVFormatContext *s)
     int c, i;
 
     for (i = 0; i < ts->resync_size; i++) {
+        const uint8_t *buf, *sync;
+        int len = FFMIN(ffio_peek_buffered(pb, &buf), ts->resync_size - i);
+        if (len > 1) {
+            /* search the buffered data at once */
+            sync = memchr(buf, 0x47, len);
+            if (sync) {
+                ffio_skip_buffered(pb, sync - buf);
+                reanalyze(s->priv_data);
+                return 0;
+            }
+            ffio_skip_buffered(pb, len);
+            i += len - 1;
+            continue;
+        }
         c = avio_r8(pb);
         if (avio_feof(pb))
             return AVERROR_EOF;
@@ -2421,12 +2557,40 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+/**
+ * Skip the packets of dropped pids that follow in the I/O buffer, up to
+ * max_packets, without copying or parsing them.
+ * @return the number of packets skipped
+ */
+static int64_t skip_dropped_packets(MpegTSContext *ts, int64_t max_packets)
+{
+    AVIOContext *pb = ts->stream->pb;
+    const int raw_packet_size = ts->raw_packet_size;
+    const uint8_t *buf, *p;
+    int size = ffio_peek_buffered(pb, &buf);
+    int64_t n = 0;
+
+    p = buf;
+    while (n < max_packets && buf + size - p >= raw_packet_size &&
+           p[0] == 0x47) {
+        int pid = AV_RB16(p + 1) & 0x1fff;
+        if (ts->drop_pid[pid] & DROP_PID_STALE)
+            update_drop_pid(ts, pid);
+        if (!ts->drop_pid[pid])
+            break;
+        p += raw_packet_size;
+        n++;
+    }
+    ffio_skip_buffered(pb, p - buf);
+    return n;
+}
+
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
     uint8_t packet[TS_PACKET_SIZE + FF_INPUT_BUFFER_PADDING_SIZE];
     const uint8_t *data;
-    int64_t packet_num;
+    int64_t packet_num, skipped;
     int ret = 0;
 
     if (avio_tell(s->pb) != ts->last_pos) {
@@ -2447,6 +2611,7 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         }
     }
 
+    check_discard_state(ts);
     ts->stop_parse = 0;
     packet_num = 0;
     memset(packet + TS_PACKET_SIZE, 0, FF_INPUT_BUFFER_PADDING_SIZE);
@@ -2460,6 +2625,13 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        skipped = skip_dropped_packets(ts, nb_packets ? nb_packets - packet_num
+                                                      : INT64_MAX);
+        if (skipped) {
+            packet_num += skipped - 1;
+            continue;
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
@@ -2726,6 +2898,10 @@ static void mpegts_free(MpegTSContext *ts)
     for (i = 0; i < NB_PID_MAX; i++)
         if (ts->pids[i])
             mpegts_close_filter(ts, ts->pids[i]);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(ts->pools); i++)
+        av_buffer_pool_uninit(&ts->pools[i]);
+    av_freep(&ts->discard_state);
 }
 
 static int mpegts_read_close(AVFormatContext *s)
@@ -2831,6 +3007,7 @@ int avpriv_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
 
     len1 = len;
     ts->pkt = pkt;
+    check_discard_state(ts);
     for (;;) {
         ts->stop_parse = 0;
         if (len < TS_PACKET_SIZE)
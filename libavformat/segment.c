@@ -31,6 +31,7 @@
 
 #include "avformat.h"
 #include "internal.h"
+#include "segment_io.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/log.h"
@@ -114,6 +115,10 @@ typedef struct SegmentContext {
     SegmentListEntry cur_entry;
     SegmentListEntry *segment_list_entries;
     SegmentListEntry *segment_list_entries_end;
+
+    int async_io;          ///< do the segment boundary I/O in a background thread
+    int nb_preopen;        ///< number of segment files opened ahead
+    SegmentIO *sio;
 } SegmentContext;
 
 static void print_csv_escaped_str(AVIOContext *ctx, const char *str)
@@ -210,6 +215,31 @@ static int set_segment_filename(AVFormatContext *s)
     return 0;
 }
 
+static int segment_open(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    AVFormatContext *oc = seg->avf;
+    char filename[sizeof(oc->filename)];
+    int i, err;
+
+    if ((err = ff_segment_io_open(seg->sio, &oc->pb, oc->filename)) < 0) {
+        av_log(s, AV_LOG_ERROR, "Failed to open segment '%s'\n", oc->filename);
+        return err;
+    }
+
+    /* the names of the next segments are known unless they wrap */
+    if (seg->use_strftime || seg->segment_idx_wrap)
+        return 0;
+    for (i = 1; i <= seg->nb_preopen; i++) {
+        if (av_get_frame_filename(filename, sizeof(filename),
+                                  s->filename, seg->segment_idx + i) < 0)
+            break;
+        if ((err = ff_segment_io_preopen(seg->sio, filename)) < 0)
+            return err;
+    }
+    return 0;
+}
+
 static int segment_start(AVFormatContext *s, int write_header)
 {
     SegmentContext *seg = s->priv_data;
@@ -231,11 +261,8 @@ static int segment_start(AVFormatContext *s, int write_header)
     if ((err = set_segment_filename(s)) < 0)
         return err;
 
-    if ((err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0) {
-        av_log(s, AV_LOG_ERROR, "Failed to open segment '%s'\n", oc->filename);
+    if ((err = segment_open(s)) < 0)
         return err;
-    }
 
     if (oc->oformat->priv_class && oc->priv_data)
         av_opt_set(oc->priv_data, "mpegts_flags", "+resend_headers", 0);
@@ -249,13 +276,23 @@ static int segment_start(AVFormatContext *s, int write_header)
     return 0;
 }
 
+/* lists with a size limit or a header are rewritten for every segment,
+ * the others are appended to */
+static int segment_list_rewritten(SegmentContext *seg)
+{
+    return seg->list_size || seg->list_type == LIST_TYPE_M3U8;
+}
+
 static int segment_list_open(AVFormatContext *s)
 {
     SegmentContext *seg = s->priv_data;
     int ret;
 
-    ret = avio_open2(&seg->list_pb, seg->list, AVIO_FLAG_WRITE,
-                     &s->interrupt_callback, NULL);
+    if (segment_list_rewritten(seg))
+        ret = avio_open_dyn_buf(&seg->list_pb);
+    else
+        ret = avio_open2(&seg->list_pb, seg->list, AVIO_FLAG_WRITE,
+                         &s->interrupt_callback, NULL);
     if (ret < 0) {
         av_log(s, AV_LOG_ERROR, "Failed to open segment list '%s'\n", seg->list);
         return ret;
@@ -284,6 +321,21 @@ static int segment_list_open(AVFormatContext *s)
     return ret;
 }
 
+static int segment_list_close(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    uint8_t *buf;
+    int size;
+
+    if (!seg->list_pb || !segment_list_rewritten(seg))
+        return avio_closep(&seg->list_pb);
+
+    /* replaced through a temporary file and a rename for local files */
+    size = avio_close_dyn_buf(seg->list_pb, &buf);
+    seg->list_pb = NULL;
+    return ff_segment_io_write_file(seg->sio, seg->list, buf, size);
+}
+
 static void segment_list_print_entry(AVIOContext      *list_ioctx,
                                      ListType          list_type,
                                      const SegmentListEntry *list_entry,
@@ -323,7 +375,7 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
 {
     SegmentContext *seg = s->priv_data;
     AVFormatContext *oc = seg->avf;
-    int ret = 0;
+    int ret = 0, ret2;
 
     av_write_frame(oc, NULL); /* Flush any buffered data (fragmented mp4) */
     if (write_trailer)
@@ -333,6 +385,11 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
         av_log(s, AV_LOG_ERROR, "Failure occurred when ending segment '%s'\n",
                oc->filename);
 
+    /* close the segment before listing it */
+    ret2 = ff_segment_io_close(seg->sio, &oc->pb);
+    if (ret >= 0)
+        ret = ret2;
+
     if (seg->list) {
         if (seg->list_size || seg->list_type == LIST_TYPE_M3U8) {
             SegmentListEntry *entry = av_mallocz(sizeof(*entry));
@@ -357,17 +414,18 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
                 av_freep(&entry);
             }
 
-            avio_closep(&seg->list_pb);
             if ((ret = segment_list_open(s)) < 0)
                 goto end;
             for (entry = seg->segment_list_entries; entry; entry = entry->next)
                 segment_list_print_entry(seg->list_pb, seg->list_type, entry, s);
             if (seg->list_type == LIST_TYPE_M3U8 && is_last)
                 avio_printf(seg->list_pb, "#EXT-X-ENDLIST\n");
+            if ((ret = segment_list_close(s)) < 0)
+                goto end;
         } else {
             segment_list_print_entry(seg->list_pb, seg->list_type, &seg->cur_entry, s);
+            avio_flush(seg->list_pb);
         }
-        avio_flush(seg->list_pb);
     }
 
     av_log(s, AV_LOG_VERBOSE, "segment:'%s' count:%d ended\n",
@@ -375,8 +433,6 @@ static int segment_end(AVFormatContext *s, int write_trailer, int is_last)
     seg->segment_count++;
 
 end:
-    avio_closep(&oc->pb);
-
     return ret;
 }
 
@@ -579,6 +635,7 @@ static void seg_free_context(SegmentContext *seg)
     avio_closep(&seg->list_pb);
     avformat_free_context(seg->avf);
     seg->avf = NULL;
+    ff_segment_io_free(&seg->sio);
 }
 
 static int seg_write_header(AVFormatContext *s)
@@ -627,6 +684,10 @@ static int seg_write_header(AVFormatContext *s)
         }
     }
 
+    if ((ret = ff_segment_io_alloc(&seg->sio, s, &s->interrupt_callback,
+                                   seg->async_io, seg->nb_preopen)) < 0)
+        goto fail;
+
     if (seg->list) {
         if (seg->list_type == LIST_TYPE_UNDEFINED) {
             if      (av_match_ext(seg->list, "csv" )) seg->list_type = LIST_TYPE_CSV;
@@ -637,6 +698,8 @@ static int seg_write_header(AVFormatContext *s)
         }
         if ((ret = segment_list_open(s)) < 0)
             goto fail;
+        if (segment_list_rewritten(seg) && (ret = segment_list_close(s)) < 0)
+            goto fail;
     }
     if (seg->list_type == LIST_TYPE_EXT)
         av_log(s, AV_LOG_WARNING, "'ext' list type option is deprecated in favor of 'csv'\n");
@@ -668,11 +731,8 @@ static int seg_write_header(AVFormatContext *s)
         goto fail;
 
     if (seg->write_header_trailer) {
-        if ((ret = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                              &s->interrupt_callback, NULL)) < 0) {
-            av_log(s, AV_LOG_ERROR, "Failed to open segment '%s'\n", oc->filename);
+        if ((ret = segment_open(s)) < 0)
             goto fail;
-        }
     } else {
         if ((ret = open_null_ctx(&oc->pb)) < 0)
             goto fail;
@@ -705,8 +765,7 @@ static int seg_write_header(AVFormatContext *s)
 
     if (!seg->write_header_trailer) {
         close_null_ctxp(&oc->pb);
-        if ((ret = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                              &s->interrupt_callback, NULL)) < 0)
+        if ((ret = segment_open(s)) < 0)
             goto fail;
     }
 
@@ -833,7 +892,7 @@ static int seg_write_trailer(struct AVFormatContext *s)
     SegmentContext *seg = s->priv_data;
     AVFormatContext *oc = seg->avf;
     SegmentListEntry *cur, *next;
-    int ret = 0;
+    int ret = 0, ret2;
 
     if (!oc)
         goto fail;
@@ -850,6 +909,8 @@ static int seg_write_trailer(struct AVFormatContext *s)
 fail:
     if (seg->list)
         avio_closep(&seg->list_pb);
+    if ((ret2 = ff_segment_io_free(&seg->sio)) < 0 && ret >= 0)
+        ret = ret2;
 
     av_dict_free(&seg->format_options);
     av_opt_free(seg);
@@ -906,6 +967,8 @@ static const AVOption options[] = {
     { "write_header_trailer", "write a header to the first segment and a trailer to the last one", OFFSET(write_header_trailer), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, E },
     { "reset_timestamps", "reset timestamps at the begin of each segment", OFFSET(reset_timestamps), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
     { "initial_offset", "set initial timestamp offset", OFFSET(initial_offset), AV_OPT_TYPE_DURATION, {.i64 = 0}, -INT64_MAX, INT64_MAX, E },
+    { "segment_async_io", "close the segments and write the list in a background thread", OFFSET(async_io), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
+    { "segment_preopen", "set number of segment files opened ahead with segment_async_io", OFFSET(nb_preopen), AV_OPT_TYPE_INT, {.i64 = 2}, 0, 16, E },
     { NULL },
 };
 
@@ -0,0 +1,420 @@
+/*
+ * Background output I/O for the segmenting muxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <string.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "libavutil/avstring.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+
+#include "avio.h"
+#include "internal.h"
+#include "os_support.h"
+#include "segment_io.h"
+
+typedef struct SegmentIOOutput {
+    char *filename;
+    AVIOContext *pb;
+    int ret;                ///< result of the open
+    int ready;
+} SegmentIOOutput;
+
+enum SegmentIOJobType {
+    JOB_OPEN,
+    JOB_CLOSE,
+    JOB_WRITE_FILE,
+    JOB_DELETE,
+};
+
+typedef struct SegmentIOJob {
+    enum SegmentIOJobType type;
+    AVIOContext *pb;
+    SegmentIOOutput *output;
+    char *filename;
+    uint8_t *buf;
+    int size;
+    struct SegmentIOJob *next;
+} SegmentIOJob;
+
+struct SegmentIO {
+    void *log_ctx;
+    AVIOInterruptCB int_cb;
+    int threaded;
+
+    SegmentIOOutput **outputs;  ///< outputs opened or being opened ahead
+    int nb_outputs;
+    int nb_preopen;
+
+    SegmentIOJob *jobs;         ///< pending jobs, the first one is running
+    SegmentIOJob **jobs_end;
+    int err;                    ///< first error of a job
+
+#if HAVE_PTHREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        ///< signalled when a job is added or done
+    int exit;
+#endif
+};
+
+/* the path of a local file, NULL for other protocols */
+static const char *local_path(const char *filename)
+{
+    const char *proto = avio_find_protocol_name(filename);
+
+    if (!proto || strcmp(proto, "file"))
+        return NULL;
+    av_strstart(filename, "file:", &filename);
+    return filename;
+}
+
+static int write_file(SegmentIO *sio, const char *filename,
+                      const uint8_t *buf, int size)
+{
+    const char *path = local_path(filename);
+    AVIOContext *pb = NULL;
+    char *temp_filename;
+    int ret;
+
+    temp_filename = path ? av_asprintf("%s.tmp", path) : av_strdup(filename);
+    if (!temp_filename)
+        return AVERROR(ENOMEM);
+    if ((ret = avio_open2(&pb, temp_filename, AVIO_FLAG_WRITE,
+                          &sio->int_cb, NULL)) < 0) {
+        av_log(sio->log_ctx, AV_LOG_ERROR, "Failed to open '%s'\n",
+               temp_filename);
+        goto end;
+    }
+    avio_write(pb, buf, size);
+    avio_flush(pb);
+    ret = pb->error;
+    avio_closep(&pb);
+    if (ret >= 0 && path)
+        ret = ff_rename(temp_filename, path, sio->log_ctx);
+end:
+    av_free(temp_filename);
+    return ret;
+}
+
+static int run_job(SegmentIO *sio, SegmentIOJob *job)
+{
+    const char *path;
+    int ret = 0, ret2;
+
+    switch (job->type) {
+    case JOB_OPEN:
+        ret = avio_open2(&job->output->pb, job->output->filename,
+                         AVIO_FLAG_WRITE, &sio->int_cb, NULL);
+        break;
+    case JOB_CLOSE:
+        avio_flush(job->pb);
+        ret  = job->pb->error;
+        ret2 = avio_closep(&job->pb);
+        if (ret >= 0)
+            ret = ret2;
+        break;
+    case JOB_WRITE_FILE:
+        ret = write_file(sio, job->filename, job->buf, job->size);
+        break;
+    case JOB_DELETE:
+        path = local_path(job->filename);
+        if (unlink(path ? path : job->filename) < 0)
+            av_log(sio->log_ctx, AV_LOG_ERROR, "failed to delete %s: %s\n",
+                   job->filename, strerror(errno));
+        break;
+    }
+    return ret;
+}
+
+/* called with the lock held in threaded mode */
+static void finish_job(SegmentIO *sio, SegmentIOJob *job, int ret)
+{
+    if (job->output) {
+        job->output->ret   = ret;
+        job->output->ready = 1;
+    } else if (ret < 0) {
+        if (job->type == JOB_CLOSE)
+            av_log(sio->log_ctx, AV_LOG_ERROR, "Failed to close a segment: %s\n",
+                   av_err2str(ret));
+        if (!sio->err)
+            sio->err = ret;
+    }
+    av_free(job->filename);
+    av_free(job->buf);
+    av_free(job);
+}
+
+#if HAVE_PTHREADS
+static void *segment_io_thread(void *arg)
+{
+    SegmentIO *sio = arg;
+    SegmentIOJob *job;
+    int ret;
+
+    pthread_mutex_lock(&sio->lock);
+    while (1) {
+        while (!sio->jobs && !sio->exit)
+            pthread_cond_wait(&sio->cond, &sio->lock);
+        if (!(job = sio->jobs))
+            break;
+        pthread_mutex_unlock(&sio->lock);
+
+        ret = run_job(sio, job);
+
+        pthread_mutex_lock(&sio->lock);
+        if (!(sio->jobs = job->next))
+            sio->jobs_end = &sio->jobs;
+        finish_job(sio, job, ret);
+        pthread_cond_broadcast(&sio->cond);
+    }
+    pthread_mutex_unlock(&sio->lock);
+    return NULL;
+}
+#endif
+
+static int submit_job(SegmentIO *sio, SegmentIOJob *job)
+{
+#if HAVE_PTHREADS
+    if (sio->threaded) {
+        int ret;
+
+        pthread_mutex_lock(&sio->lock);
+        *sio->jobs_end = job;
+        sio->jobs_end  = &job->next;
+        pthread_cond_broadcast(&sio->cond);
+        ret = sio->err;
+        pthread_mutex_unlock(&sio->lock);
+        return ret;
+    }
+#endif
+    finish_job(sio, job, run_job(sio, job));
+    return sio->err;
+}
+
+static SegmentIOJob *alloc_job(enum SegmentIOJobType type, const char *filename)
+{
+    SegmentIOJob *job = av_mallocz(sizeof(*job));
+
+    if (!job)
+        return NULL;
+    job->type = type;
+    if (filename && !(job->filename = av_strdup(filename))) {
+        av_free(job);
+        return NULL;
+    }
+    return job;
+}
+
+int ff_segment_io_alloc(SegmentIO **psio, void *log_ctx,
+                        const AVIOInterruptCB *int_cb,
+                        int threaded, int nb_preopen)
+{
+    SegmentIO *sio = av_mallocz(sizeof(*sio));
+
+    if (!sio)
+        return AVERROR(ENOMEM);
+    sio->log_ctx  = log_ctx;
+    sio->jobs_end = &sio->jobs;
+    if (int_cb)
+        sio->int_cb = *int_cb;
+
+#if HAVE_PTHREADS
+    if (threaded) {
+        int ret;
+
+        sio->nb_preopen = nb_preopen;
+        if (nb_preopen &&
+            !(sio->outputs = av_malloc_array(nb_preopen, sizeof(*sio->outputs)))) {
+            av_free(sio);
+            return AVERROR(ENOMEM);
+        }
+        pthread_mutex_init(&sio->lock, NULL);
+        pthread_cond_init(&sio->cond, NULL);
+        if ((ret = pthread_create(&sio->thread, NULL, segment_io_thread, sio))) {
+            av_log(log_ctx, AV_LOG_ERROR, "pthread_create failed: %s\n",
+                   strerror(ret));
+            pthread_cond_destroy(&sio->cond);
+            pthread_mutex_destroy(&sio->lock);
+            av_free(sio->outputs);
+            av_free(sio);
+            return AVERROR(ret);
+        }
+        sio->threaded = 1;
+    }
+#else
+    if (threaded)
+        av_log(log_ctx, AV_LOG_WARNING, "Built without threads, "
+               "the segment I/O is done synchronously\n");
+#endif
+
+    *psio = sio;
+    return 0;
+}
+
+int ff_segment_io_free(SegmentIO **psio)
+{
+    SegmentIO *sio = *psio;
+    int i, ret;
+
+    if (!sio)
+        return 0;
+
+#if HAVE_PTHREADS
+    if (sio->threaded) {
+        pthread_mutex_lock(&sio->lock);
+        sio->exit = 1;
+        pthread_cond_broadcast(&sio->cond);
+        pthread_mutex_unlock(&sio->lock);
+        pthread_join(sio->thread, NULL);
+        pthread_cond_destroy(&sio->cond);
+        pthread_mutex_destroy(&sio->lock);
+    }
+#endif
+
+    for (i = 0; i < sio->nb_outputs; i++) {
+        SegmentIOOutput *output = sio->outputs[i];
+        if (output->pb) {
+            avio_closep(&output->pb);
+            unlink(local_path(output->filename));
+        }
+        av_free(output->filename);
+        av_free(output);
+    }
+    av_free(sio->outputs);
+
+    ret = sio->err;
+    av_freep(psio);
+    return ret;
+}
+
+int ff_segment_io_open(SegmentIO *sio, AVIOContext **pb, const char *filename)
+{
+#if HAVE_PTHREADS
+    SegmentIOOutput *output = NULL;
+    int i, ret;
+
+    if (sio->nb_outputs) {
+        pthread_mutex_lock(&sio->lock);
+        for (i = 0; i < sio->nb_outputs; i++) {
+            if (!strcmp(sio->outputs[i]->filename, filename)) {
+                output = sio->outputs[i];
+                sio->outputs[i] = sio->outputs[--sio->nb_outputs];
+                break;
+            }
+        }
+        while (output && !output->ready)
+            pthread_cond_wait(&sio->cond, &sio->lock);
+        pthread_mutex_unlock(&sio->lock);
+    }
+
+    if (output) {
+        *pb = output->pb;
+        ret = output->ret;
+        av_free(output->filename);
+        av_free(output);
+        if (ret >= 0)
+            return 0;
+        /* try again, the error is reported by the open below */
+    }
+#endif
+    return avio_open2(pb, filename, AVIO_FLAG_WRITE, &sio->int_cb, NULL);
+}
+
+int ff_segment_io_preopen(SegmentIO *sio, const char *filename)
+{
+    SegmentIOOutput *output;
+    SegmentIOJob *job;
+    int i;
+
+    /* an existing file may still be in use, and the outputs that are not
+     * used are deleted at the end */
+    if (sio->nb_outputs >= sio->nb_preopen || !local_path(filename) ||
+        avio_check(filename, 0) >= 0)
+        return 0;
+    /* only the main thread changes the list of outputs */
+    for (i = 0; i < sio->nb_outputs; i++)
+        if (!strcmp(sio->outputs[i]->filename, filename))
+            return 0;
+
+    if (!(output = av_mallocz(sizeof(*output))))
+        return AVERROR(ENOMEM);
+    if (!(output->filename = av_strdup(filename)) ||
+        !(job = alloc_job(JOB_OPEN, NULL))) {
+        av_free(output->filename);
+        av_free(output);
+        return AVERROR(ENOMEM);
+    }
+    job->output = output;
+
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&sio->lock);
+#endif
+    sio->outputs[sio->nb_outputs++] = output;
+#if HAVE_PTHREADS
+    pthread_mutex_unlock(&sio->lock);
+#endif
+    return submit_job(sio, job);
+}
+
+int ff_segment_io_close(SegmentIO *sio, AVIOContext **pb)
+{
+    SegmentIOJob *job;
+
+    if (!*pb)
+        return 0;
+    if (!(job = alloc_job(JOB_CLOSE, NULL))) {
+        avio_closep(pb);
+        return AVERROR(ENOMEM);
+    }
+    job->pb = *pb;
+    *pb = NULL;
+    return submit_job(sio, job);
+}
+
+int ff_segment_io_write_file(SegmentIO *sio, const char *filename,
+                             uint8_t *buf, int size)
+{
+    SegmentIOJob *job;
+
+    if (!(job = alloc_job(JOB_WRITE_FILE, filename))) {
+        av_free(buf);
+        return AVERROR(ENOMEM);
+    }
+    job->buf  = buf;
+    job->size = size;
+    return submit_job(sio, job);
+}
+
+int ff_segment_io_delete(SegmentIO *sio, const char *filename)
+{
+    SegmentIOJob *job;
+
+    if (!(job = alloc_job(JOB_DELETE, filename)))
+        return AVERROR(ENOMEM);
+    return submit_job(sio, job);
+}
@@ -0,0 +1,92 @@
+/*
+ * Background output I/O for the segmenting muxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_SEGMENT_IO_H
+#define AVFORMAT_SEGMENT_IO_H
+
+#include <stdint.h>
+
+#include "avio.h"
+
+/**
+ * The file operations done at segment boundaries: closing the finished
+ * segment, replacing the playlist, deleting old segments and opening the
+ * next segment.
+ *
+ * In threaded mode the jobs run in a background thread, in the order they
+ * were submitted, so a playlist written after a segment was closed only
+ * references complete segments. The outputs of the next segments can also
+ * be opened ahead of time. Otherwise the jobs run when they are submitted.
+ *
+ * The errors of the background jobs are returned by the following calls.
+ */
+typedef struct SegmentIO SegmentIO;
+
+/**
+ * @param log_ctx    context used for logging
+ * @param int_cb     interrupt callback of the muxer, may be NULL
+ * @param threaded   run the jobs in a background thread
+ * @param nb_preopen maximum number of outputs opened ahead, only used in
+ *                   threaded mode
+ */
+int ff_segment_io_alloc(SegmentIO **sio, void *log_ctx,
+                        const AVIOInterruptCB *int_cb,
+                        int threaded, int nb_preopen);
+
+/**
+ * Wait for all the jobs and free the context. The outputs opened ahead
+ * that were not used are closed and their files deleted.
+ *
+ * @return the first error of a job
+ */
+int ff_segment_io_free(SegmentIO **sio);
+
+/**
+ * Open a segment output for writing, using the output opened ahead for
+ * filename if there is one.
+ */
+int ff_segment_io_open(SegmentIO *sio, AVIOContext **pb, const char *filename);
+
+/**
+ * Open the output of a future segment ahead of time. Does nothing if the
+ * pool of outputs is full, if filename is not a local file or if it
+ * already exists.
+ */
+int ff_segment_io_preopen(SegmentIO *sio, const char *filename);
+
+/**
+ * Flush and close a segment output, *pb is set to NULL.
+ */
+int ff_segment_io_close(SegmentIO *sio, AVIOContext **pb);
+
+/**
+ * Replace the content of a file with buf. Local files are written to a
+ * temporary file which is then renamed, so readers never see a partial
+ * file. Takes ownership of buf, which must be allocated with av_malloc().
+ */
+int ff_segment_io_write_file(SegmentIO *sio, const char *filename,
+                             uint8_t *buf, int size);
+
+/**
+ * Delete a local file.
+ */
+int ff_segment_io_delete(SegmentIO *sio, const char *filename);
+
+#endif /* AVFORMAT_SEGMENT_IO_H */
@@ -20,13 +20,29 @@
  */
 
 
+#include "config.h"
 #include "libavutil/avutil.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
+#include "libavutil/threadmessage.h"
 #include "avformat.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #define MAX_SLAVES 16
 
+enum SlaveFailurePolicy {
+    ON_SLAVE_FAILURE_ABORT,
+    ON_SLAVE_FAILURE_IGNORE,
+};
+
+enum SlaveFullPolicy {
+    ON_SLAVE_FULL_BLOCK,
+    ON_SLAVE_FULL_DROP,
+};
+
 typedef struct {
     AVFormatContext *avf;
     AVBitStreamFilterContext **bsfs; ///< bitstream filters per stream
@@ -34,12 +50,29 @@ typedef struct {
     /** map from input to output streams indexes,
      * disabled output streams are set to -1 */
     int *stream_map;
+
+    int failed;          ///< error that disabled the slave, 0 if it is alive
+    uint8_t *wait_key;   ///< per output stream, drop packets until a keyframe
+    int nb_dropped;      ///< packets dropped because the queue was full
+
+    AVThreadMessageQueue *queue; ///< packets waiting for the slave thread
+#if HAVE_PTHREADS
+    pthread_t thread;
+#endif
+    int thread_ret;      ///< first error of the slave thread, read once it is joined
+    int thread_trailer;  ///< the slave thread wrote the trailer
 } TeeSlave;
 
 typedef struct TeeContext {
     const AVClass *class;
     unsigned nb_slaves;
+    unsigned nb_alive;
     TeeSlave slaves[MAX_SLAVES];
+
+    int slave_threads;
+    int queue_size;
+    int onfail;
+    int onfull;
 } TeeContext;
 
 static const char *const slave_delim     = "|";
@@ -48,9 +81,24 @@ static const char *const slave_opt_close = "]";
 static const char *const slave_opt_delim = ":]"; /* must have the close too */
 static const char *const slave_bsfs_spec_sep = "/";
 
+#define OFFSET(x) offsetof(TeeContext, x)
+#define E AV_OPT_FLAG_ENCODING_PARAM
+static const AVOption options[] = {
+    { "slave_threads", "write each slave from its own thread", OFFSET(slave_threads), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, E },
+    { "queue_size", "packets queued per slave thread", OFFSET(queue_size), AV_OPT_TYPE_INT, { .i64 = 64 }, 1, INT_MAX, E },
+    { "onfail", "what to do when a slave fails", OFFSET(onfail), AV_OPT_TYPE_INT, { .i64 = ON_SLAVE_FAILURE_ABORT }, 0, 1, E, "onfail" },
+    { "abort",  "return the error of the slave", 0, AV_OPT_TYPE_CONST, { .i64 = ON_SLAVE_FAILURE_ABORT },  0, 0, E, "onfail" },
+    { "ignore", "stop writing to the slave and go on with the others", 0, AV_OPT_TYPE_CONST, { .i64 = ON_SLAVE_FAILURE_IGNORE }, 0, 0, E, "onfail" },
+    { "onfull", "what to do when the queue of a slave is full", OFFSET(onfull), AV_OPT_TYPE_INT, { .i64 = ON_SLAVE_FULL_BLOCK }, 0, 1, E, "onfull" },
+    { "block", "wait for the slave", 0, AV_OPT_TYPE_CONST, { .i64 = ON_SLAVE_FULL_BLOCK }, 0, 0, E, "onfull" },
+    { "drop",  "drop packets for the slave until the next keyframe", 0, AV_OPT_TYPE_CONST, { .i64 = ON_SLAVE_FULL_DROP }, 0, 0, E, "onfull" },
+    { NULL },
+};
+
 static const AVClass tee_muxer_class = {
     .class_name = "Tee muxer",
     .item_name  = av_default_item_name,
+    .option     = options,
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
@@ -221,7 +269,8 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
 
     tee_slave->avf = avf2;
     tee_slave->bsfs = av_calloc(avf2->nb_streams, sizeof(TeeSlave));
-    if (!tee_slave->bsfs) {
+    tee_slave->wait_key = av_mallocz(avf2->nb_streams);
+    if (!tee_slave->bsfs || !tee_slave->wait_key) {
         ret = AVERROR(ENOMEM);
         goto end;
     }
@@ -304,6 +353,8 @@ static void close_slaves(AVFormatContext *avf)
         }
         av_freep(&tee->slaves[i].stream_map);
         av_freep(&tee->slaves[i].bsfs);
+        av_freep(&tee->slaves[i].wait_key);
+        av_thread_message_queue_free(&tee->slaves[i].queue);
 
         avio_closep(&avf2->pb);
         avformat_free_context(avf2);
@@ -335,6 +386,204 @@ static void log_slave(TeeSlave *slave, void *log_ctx, int log_level)
     }
 }
 
+static int filter_packet(void *log_ctx, AVPacket *pkt,
+                         AVFormatContext *fmt_ctx, AVBitStreamFilterContext *bsf_ctx)
+{
+    AVCodecContext *enc_ctx = fmt_ctx->streams[pkt->stream_index]->codec;
+    int ret = 0;
+
+    while (bsf_ctx) {
+        AVPacket new_pkt = *pkt;
+        ret = av_bitstream_filter_filter(bsf_ctx, enc_ctx, NULL,
+                                             &new_pkt.data, &new_pkt.size,
+                                             pkt->data, pkt->size,
+                                             pkt->flags & AV_PKT_FLAG_KEY);
+        if (ret == 0 && new_pkt.data != pkt->data && new_pkt.destruct) {
+            if ((ret = av_copy_packet(&new_pkt, pkt)) < 0)
+                break;
+            ret = 1;
+        }
+
+        if (ret > 0) {
+            av_free_packet(pkt);
+            new_pkt.buf = av_buffer_create(new_pkt.data, new_pkt.size,
+                                           av_buffer_default_free, NULL, 0);
+            if (!new_pkt.buf)
+                break;
+        }
+        if (ret < 0) {
+            av_log(log_ctx, AV_LOG_ERROR,
+                "Failed to filter bitstream with filter %s for stream %d in file '%s' with codec %s\n",
+                bsf_ctx->filter->name, pkt->stream_index, fmt_ctx->filename,
+                avcodec_get_name(enc_ctx->codec_id));
+        }
+        *pkt = new_pkt;
+
+        bsf_ctx = bsf_ctx->next;
+    }
+
+    return ret;
+}
+
+static int write_slave_packet(TeeSlave *slave, AVPacket *pkt)
+{
+    AVFormatContext *avf2 = slave->avf;
+
+    filter_packet(avf2, pkt, avf2, slave->bsfs[pkt->stream_index]);
+    return av_interleaved_write_frame(avf2, pkt);
+}
+
+static int finish_slave(TeeSlave *slave)
+{
+    AVFormatContext *avf2 = slave->avf;
+    int ret_all, ret;
+
+    ret_all = av_write_trailer(avf2);
+    if (!(avf2->oformat->flags & AVFMT_NOFILE)) {
+        if ((ret = avio_closep(&avf2->pb)) < 0)
+            if (!ret_all)
+                ret_all = ret;
+    }
+    return ret_all;
+}
+
+/**
+ * Disable a failed slave if the failure policy allows it.
+ *
+ * @return 0 if the muxing can go on with the other slaves, err otherwise
+ */
+static int slave_failed(AVFormatContext *avf, TeeSlave *slave, int err)
+{
+    TeeContext *tee = avf->priv_data;
+
+    if (tee->onfail == ON_SLAVE_FAILURE_ABORT)
+        return err;
+    if (!slave->failed) {
+        av_log(avf, AV_LOG_ERROR, "Slave '%s' failed: %s, disabling it\n",
+               slave->avf->filename, av_err2str(err));
+        slave->failed = err;
+        tee->nb_alive--;
+    }
+    return tee->nb_alive ? 0 : err;
+}
+
+#if HAVE_PTHREADS
+/* The slave thread owns the muxer of the slave until its queue is closed:
+ * AVERROR_EOF writes the trailer, AVERROR_EXIT just stops the thread. No
+ * trailer is written after a failed packet. */
+static void *slave_thread(void *arg)
+{
+    TeeSlave *slave = arg;
+    AVPacket pkt;
+    int ret;
+
+    while ((ret = av_thread_message_queue_recv(slave->queue, &pkt, 0)) >= 0) {
+        if ((ret = write_slave_packet(slave, &pkt)) < 0) {
+            slave->thread_ret = ret;
+            av_thread_message_queue_set_err_send(slave->queue, ret);
+            break;
+        }
+    }
+    if (ret != AVERROR_EXIT && !slave->thread_ret) {
+        slave->thread_ret     = finish_slave(slave);
+        slave->thread_trailer = 1;
+    }
+    return NULL;
+}
+
+/* does nothing if the thread is already stopped */
+static void stop_slave_thread(TeeSlave *slave, int err)
+{
+    AVPacket pkt;
+
+    if (!slave->queue)
+        return;
+    av_thread_message_queue_set_err_send(slave->queue, err);
+    av_thread_message_queue_set_err_recv(slave->queue, err);
+    pthread_join(slave->thread, NULL);
+    while (av_thread_message_queue_recv(slave->queue, &pkt,
+                                        AV_THREAD_MESSAGE_NONBLOCK) >= 0)
+        av_packet_unref(&pkt);
+    av_thread_message_queue_free(&slave->queue);
+}
+
+static int start_slave_threads(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
+    unsigned i;
+    int ret;
+
+    for (i = 0; i < tee->nb_slaves; i++) {
+        TeeSlave *slave = &tee->slaves[i];
+
+        ret = av_thread_message_queue_alloc(&slave->queue, tee->queue_size,
+                                            sizeof(AVPacket));
+        if (ret < 0)
+            goto fail;
+        if ((ret = pthread_create(&slave->thread, NULL, slave_thread, slave))) {
+            av_log(avf, AV_LOG_ERROR, "pthread_create failed: %s\n",
+                   strerror(ret));
+            av_thread_message_queue_free(&slave->queue);
+            ret = AVERROR(ret);
+            goto fail;
+        }
+    }
+    return 0;
+
+fail:
+    while (i--)
+        stop_slave_thread(&tee->slaves[i], AVERROR_EXIT);
+    return ret;
+}
+
+static int send_slave_packet(AVFormatContext *avf, TeeSlave *slave, AVPacket *pkt)
+{
+    TeeContext *tee = avf->priv_data;
+    int s2 = pkt->stream_index, ret;
+
+    if (slave->wait_key[s2]) {
+        if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+            slave->nb_dropped++;
+            av_packet_unref(pkt);
+            return 0;
+        }
+        slave->wait_key[s2] = 0;
+    }
+
+    ret = av_thread_message_queue_send(slave->queue, pkt,
+                                       tee->onfull == ON_SLAVE_FULL_DROP ?
+                                       AV_THREAD_MESSAGE_NONBLOCK : 0);
+    if (ret == AVERROR(EAGAIN)) {
+        if (!slave->nb_dropped)
+            av_log(avf, AV_LOG_WARNING, "Slave '%s' is lagging, "
+                   "dropping packets\n", slave->avf->filename);
+        slave->nb_dropped++;
+        slave->wait_key[s2] = 1;
+        ret = 0;
+    }
+    if (ret < 0 || slave->wait_key[s2])
+        av_packet_unref(pkt);
+    return ret;
+}
+#else
+static int start_slave_threads(AVFormatContext *avf)
+{
+    av_log(avf, AV_LOG_WARNING, "Built without threads, "
+           "the slaves are written serially\n");
+    ((TeeContext *)avf->priv_data)->slave_threads = 0;
+    return 0;
+}
+
+static void stop_slave_thread(TeeSlave *slave, int err)
+{
+}
+
+static int send_slave_packet(AVFormatContext *avf, TeeSlave *slave, AVPacket *pkt)
+{
+    return write_slave_packet(slave, pkt);
+}
+#endif
+
 static int tee_write_header(AVFormatContext *avf)
 {
     TeeContext *tee = avf->priv_data;
@@ -365,7 +614,7 @@ static int tee_write_header(AVFormatContext *avf)
         av_freep(&slaves[i]);
     }
 
-    tee->nb_slaves = nb_slaves;
+    tee->nb_slaves = tee->nb_alive = nb_slaves;
 
     for (i = 0; i < avf->nb_streams; i++) {
         int j, mapped = 0;
@@ -375,6 +624,11 @@ static int tee_write_header(AVFormatContext *avf)
             av_log(avf, AV_LOG_WARNING, "Input stream #%d is not mapped "
                    "to any slave.\n", i);
     }
+
+    if (tee->slave_threads && (ret = start_slave_threads(avf)) < 0) {
+        close_slaves(avf);
+        return ret;
+    }
     return 0;
 
 fail:
@@ -384,62 +638,32 @@ fail:
     return ret;
 }
 
-static int filter_packet(void *log_ctx, AVPacket *pkt,
-                         AVFormatContext *fmt_ctx, AVBitStreamFilterContext *bsf_ctx)
-{
-    AVCodecContext *enc_ctx = fmt_ctx->streams[pkt->stream_index]->codec;
-    int ret = 0;
-
-    while (bsf_ctx) {
-        AVPacket new_pkt = *pkt;
-        ret = av_bitstream_filter_filter(bsf_ctx, enc_ctx, NULL,
-                                             &new_pkt.data, &new_pkt.size,
-                                             pkt->data, pkt->size,
-                                             pkt->flags & AV_PKT_FLAG_KEY);
-        if (ret == 0 && new_pkt.data != pkt->data && new_pkt.destruct) {
-            if ((ret = av_copy_packet(&new_pkt, pkt)) < 0)
-                break;
-            ret = 1;
-        }
-
-        if (ret > 0) {
-            av_free_packet(pkt);
-            new_pkt.buf = av_buffer_create(new_pkt.data, new_pkt.size,
-                                           av_buffer_default_free, NULL, 0);
-            if (!new_pkt.buf)
-                break;
-        }
-        if (ret < 0) {
-            av_log(log_ctx, AV_LOG_ERROR,
-                "Failed to filter bitstream with filter %s for stream %d in file '%s' with codec %s\n",
-                bsf_ctx->filter->name, pkt->stream_index, fmt_ctx->filename,
-                avcodec_get_name(enc_ctx->codec_id));
-        }
-        *pkt = new_pkt;
-
-        bsf_ctx = bsf_ctx->next;
-    }
-
-    return ret;
-}
-
 static int tee_write_trailer(AVFormatContext *avf)
 {
     TeeContext *tee = avf->priv_data;
-    AVFormatContext *avf2;
+    TeeSlave *slave;
     int ret_all = 0, ret;
     unsigned i;
 
+    /* the threads write their trailers concurrently */
+    if (tee->slave_threads)
+        for (i = 0; i < tee->nb_slaves; i++)
+            if (!tee->slaves[i].failed)
+                stop_slave_thread(&tee->slaves[i], AVERROR_EOF);
+
     for (i = 0; i < tee->nb_slaves; i++) {
-        avf2 = tee->slaves[i].avf;
-        if ((ret = av_write_trailer(avf2)) < 0)
+        slave = &tee->slaves[i];
+        if (slave->failed)
+            continue;
+        /* the threads stopped on an abort left the trailer to be written */
+        ret = tee->slave_threads && (slave->thread_trailer || slave->thread_ret) ?
+              slave->thread_ret : finish_slave(slave);
+        if (slave->nb_dropped)
+            av_log(avf, AV_LOG_WARNING, "Slave '%s': %d packets dropped\n",
+                   slave->avf->filename, slave->nb_dropped);
+        if (ret < 0 && (ret = slave_failed(avf, slave, ret)) < 0)
             if (!ret_all)
                 ret_all = ret;
-        if (!(avf2->oformat->flags & AVFMT_NOFILE)) {
-            if ((ret = avio_closep(&avf2->pb)) < 0)
-                if (!ret_all)
-                    ret_all = ret;
-        }
     }
     close_slaves(avf);
     return ret_all;
@@ -448,38 +672,59 @@ static int tee_write_trailer(AVFormatContext *avf)
 static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
 {
     TeeContext *tee = avf->priv_data;
-    AVFormatContext *avf2;
-    AVPacket pkt2;
+    TeeSlave *slave;
+    AVPacket ref, pkt2;
     int ret_all = 0, ret;
-    unsigned i, s;
+    unsigned i, j, s;
     int s2;
     AVRational tb, tb2;
 
+    /* the slaves share the data of a single reference; av_packet_ref()
+     * points data at the start of the buffer, keep the offset of pkt */
+    av_init_packet(&ref);
+    if ((ret = av_packet_ref(&ref, pkt)) < 0)
+        return ret;
+    if (pkt->buf)
+        ref.data = pkt->data;
+
     for (i = 0; i < tee->nb_slaves; i++) {
-        avf2 = tee->slaves[i].avf;
+        slave = &tee->slaves[i];
         s = pkt->stream_index;
-        s2 = tee->slaves[i].stream_map[s];
-        if (s2 < 0)
+        s2 = slave->stream_map[s];
+        if (s2 < 0 || slave->failed)
             continue;
 
-        if ((ret = av_copy_packet(&pkt2, pkt)) < 0 ||
-            (ret = av_dup_packet(&pkt2))< 0)
-            if (!ret_all) {
+        av_init_packet(&pkt2);
+        if ((ret = av_packet_ref(&pkt2, &ref)) < 0) {
+            if (!ret_all)
                 ret_all = ret;
-                continue;
-            }
-        tb  = avf ->streams[s ]->time_base;
-        tb2 = avf2->streams[s2]->time_base;
+            continue;
+        }
+        pkt2.data = ref.data;
+        tb  = avf        ->streams[s ]->time_base;
+        tb2 = slave->avf->streams[s2]->time_base;
         pkt2.pts      = av_rescale_q(pkt->pts,      tb, tb2);
         pkt2.dts      = av_rescale_q(pkt->dts,      tb, tb2);
         pkt2.duration = av_rescale_q(pkt->duration, tb, tb2);
         pkt2.stream_index = s2;
 
-        filter_packet(avf2, &pkt2, avf2, tee->slaves[i].bsfs[s2]);
-        if ((ret = av_interleaved_write_frame(avf2, &pkt2)) < 0)
-            if (!ret_all)
+        ret = tee->slave_threads ? send_slave_packet(avf, slave, &pkt2) :
+                           write_slave_packet(slave, &pkt2);
+        /* the error of a slave thread is the send error of its queue */
+        if (ret < 0) {
+            if ((ret = slave_failed(avf, slave, ret)) < 0 && !ret_all)
                 ret_all = ret;
+            if (slave->failed && tee->slave_threads)
+                stop_slave_thread(slave, AVERROR_EXIT);
+            /* aborting, no slave thread may go on writing */
+            if (ret < 0 && tee->slave_threads) {
+                for (j = 0; j < tee->nb_slaves; j++)
+                    stop_slave_thread(&tee->slaves[j], AVERROR_EXIT);
+                break;
+            }
+        }
     }
+    av_packet_unref(&ref);
     return ret_all;
 }
 
@@ -31,6 +31,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "config.h"
 #include "rgb2rgb.h"
 #include "swscale_internal.h"
@@ -345,6 +346,8 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     const int chrSrcSliceH           = FF_CEIL_RSHIFT(srcSliceH,   c->chrSrcVSubSample);
     int should_dither                = is9_OR_10BPS(c->srcFormat) ||
                                        is16BPS(c->srcFormat);
+    const int band_end               = c->band_end;
+    const int dstYEnd                = band_end ? band_end : dstH;
     int lastDstY;
 
     /* vars which will change and which we need to store back in the context */
@@ -408,10 +411,10 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     /* Note the user might start scaling the picture in the middle so this
      * will not get executed. This is not really intended but works
      * currently, so people might do it. */
-    if (srcSliceY == 0) {
+    if (srcSliceY == 0 || band_end) {
         lumBufIndex  = -1;
         chrBufIndex  = -1;
-        dstY         = 0;
+        dstY         = c->band_start;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -421,7 +424,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     }
     lastDstY = dstY;
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstYEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         uint8_t *dest[4]  = {
             dst[0] + dstStride[0] * dstY,
@@ -881,6 +884,238 @@ static void rgb48Toxyz12(struct SwsContext *c, uint16_t *dst,
     }
 }
 
+/**
+ * Compute the destination rows [*y, *y + *h) covered by one band. Band
+ * boundaries are aligned to 16 rows so that chroma subsampling and the 8x8
+ * ordered dither tables see the same row parity as a full frame scale.
+ */
+static void get_band_bounds(SwsContext *c, int band, int nb_bands, int *y, int *h)
+{
+    int y0 = (int64_t)c->dstH *  band      / nb_bands & ~15;
+    int y1 = (int64_t)c->dstH * (band + 1) / nb_bands & ~15;
+
+    if (band == nb_bands - 1)
+        y1 = c->dstH;
+    *y = y0;
+    *h = FFMAX(y1 - y0, 0);
+}
+
+static int scale_band(SwsContext *c, const uint8_t * const src[],
+                      const int srcStride[], uint8_t *const dst[],
+                      const int dstStride[], int y, int h)
+{
+    const uint8_t *src2[4];
+    uint8_t *dst2[4];
+    int srcStride2[4], dstStride2[4];
+    int i, ret;
+
+    if (!h)
+        return 0;
+
+    memcpy(src2,       src,       sizeof(src2));
+    memcpy(dst2,       dst,       sizeof(dst2));
+    memcpy(srcStride2, srcStride, sizeof(srcStride2));
+    memcpy(dstStride2, dstStride, sizeof(dstStride2));
+    reset_ptr(src2, c->srcFormat);
+    reset_ptr((void*)dst2, c->dstFormat);
+
+    if (c->swscale == swscale) {
+        /* the vertical scaler reads whichever source rows the band needs */
+        c->band_start = y;
+        c->band_end   = y + h;
+        ret = swscale(c, src2, srcStride2, 0, c->srcH, dst2, dstStride2);
+        c->band_start = c->band_end = 0;
+    } else {
+        /* unscaled converters map source rows 1:1 to destination rows */
+        for (i = 0; i < 4; i++) {
+            int vsub = (i == 1 || i == 2) ? c->chrSrcVSubSample : 0;
+            if (src2[i])
+                src2[i] += (y >> vsub) * srcStride2[i];
+        }
+        ret = c->swscale(c, src2, srcStride2, y, h, dst2, dstStride2);
+    }
+    return ret;
+}
+
+int ff_sws_scale_band(struct SwsContext *c, const uint8_t *const src[],
+                      const int srcStride[], uint8_t *const dst[],
+                      const int dstStride[], int band, int nb_bands)
+{
+    int y, h;
+
+    if (band < 0 || band >= nb_bands)
+        return AVERROR(EINVAL);
+
+    if (!c->nb_slice_ctx) {
+        /* this conversion cannot be split, the first band does it all */
+        return band ? 0 : sws_scale(c, src, srcStride, 0, c->srcH, dst, dstStride);
+    }
+    if (nb_bands > c->nb_slice_ctx)
+        return AVERROR(EINVAL);
+
+    get_band_bounds(c, band, nb_bands, &y, &h);
+    return scale_band(c->slice_ctx[band], src, srcStride, dst, dstStride, y, h);
+}
+
+#if HAVE_THREADS
+typedef struct SwsWorker {
+    struct SwsThreadPool *pool;
+    pthread_t thread;
+    int band;
+} SwsWorker;
+
+/* The workers started by sws_init_context() for sws_scale(). Worker i scales
+ * band i + 1 of each frame, the calling thread scales band 0 and the bands
+ * of workers that could not be started. */
+struct SwsThreadPool {
+    SwsContext *c;
+    SwsWorker workers[SWS_MAX_THREADS];
+    int nb_workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  job_cond;       ///< signalled when a frame is submitted
+    pthread_cond_t  done_cond;      ///< signalled when the last band is done
+    unsigned job_id;                ///< incremented for each submitted frame
+    int nb_pending;                 ///< bands of the current frame not done yet
+    int exit;
+
+    const uint8_t * const *src;
+    const int *srcStride;
+    uint8_t * const *dst;
+    const int *dstStride;
+    int ret[SWS_MAX_THREADS];
+};
+
+static void *band_worker(void *arg)
+{
+    SwsWorker *w = arg;
+    struct SwsThreadPool *pool = w->pool;
+    unsigned job_id = 0;
+    int ret;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (!pool->exit && pool->job_id == job_id)
+            pthread_cond_wait(&pool->job_cond, &pool->lock);
+        if (pool->exit)
+            break;
+        job_id = pool->job_id;
+        pthread_mutex_unlock(&pool->lock);
+
+        ret = ff_sws_scale_band(pool->c, pool->src, pool->srcStride,
+                             pool->dst, pool->dstStride,
+                             w->band, pool->c->nb_slice_ctx);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->ret[w->band] = ret;
+        if (!--pool->nb_pending)
+            pthread_cond_signal(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+av_cold int ff_sws_init_thread_pool(SwsContext *c)
+{
+    struct SwsThreadPool *pool;
+    int i;
+
+    if (c->nb_slice_ctx < 2)
+        return 0;
+
+    pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return AVERROR(ENOMEM);
+    pool->c = c;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->job_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    c->thread_pool = pool;
+
+    for (i = 1; i < c->nb_slice_ctx; i++) {
+        SwsWorker *w = &pool->workers[pool->nb_workers];
+        w->pool = pool;
+        w->band = i;
+        if (pthread_create(&w->thread, NULL, band_worker, w)) {
+            av_log(c, AV_LOG_WARNING, "Could only start %d of %d threads\n",
+                   pool->nb_workers + 1, c->nb_slice_ctx);
+            break;
+        }
+        pool->nb_workers++;
+    }
+    return 0;
+}
+
+av_cold void ff_sws_free_thread_pool(SwsContext *c)
+{
+    struct SwsThreadPool *pool = c->thread_pool;
+    int i;
+
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->exit = 1;
+    pthread_cond_broadcast(&pool->job_cond);
+    pthread_mutex_unlock(&pool->lock);
+    for (i = 0; i < pool->nb_workers; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->job_cond);
+    pthread_mutex_destroy(&pool->lock);
+    av_freep(&c->thread_pool);
+}
+
+/**
+ * Scale a complete frame with one band per slice context on the threads of
+ * the pool.
+ */
+static int scale_threaded(SwsContext *c, const uint8_t * const src[],
+                          const int srcStride[], uint8_t *const dst[],
+                          const int dstStride[])
+{
+    struct SwsThreadPool *pool = c->thread_pool;
+    int nb_bands = c->nb_slice_ctx;
+    int i, ret = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->src        = src;
+    pool->srcStride  = srcStride;
+    pool->dst        = dst;
+    pool->dstStride  = dstStride;
+    pool->nb_pending = pool->nb_workers;
+    pool->job_id++;
+    pthread_cond_broadcast(&pool->job_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    pool->ret[0] = ff_sws_scale_band(c, src, srcStride, dst, dstStride, 0, nb_bands);
+    for (i = pool->nb_workers + 1; i < nb_bands; i++)
+        pool->ret[i] = ff_sws_scale_band(c, src, srcStride, dst, dstStride, i, nb_bands);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->nb_pending)
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < nb_bands; i++) {
+        if (pool->ret[i] < 0)
+            return pool->ret[i];
+        ret += pool->ret[i];
+    }
+    return ret;
+}
+#else
+int ff_sws_init_thread_pool(SwsContext *c)
+{
+    return 0;
+}
+
+void ff_sws_free_thread_pool(SwsContext *c)
+{
+}
+#endif
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
@@ -932,6 +1167,12 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         av_log(c, AV_LOG_ERROR, "Slices start in the middle!\n");
         return 0;
     }
+#if HAVE_THREADS
+    if (c->thread_pool && c->sliceDir == 0 &&
+        srcSliceY == 0 && srcSliceH == c->srcH)
+        return scale_threaded(c, srcSlice, srcStride, dst, dstStride);
+#endif
+
     if (c->sliceDir == 0) {
         if (srcSliceY == 0) c->sliceDir = 1; else c->sliceDir = -1;
     }
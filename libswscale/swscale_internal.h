@@ -43,6 +43,8 @@
 
 #define MAX_FILTER_SIZE SWS_MAX_FILTER_SIZE
 
+#define SWS_MAX_THREADS 64
+
 #define DITHER1XBPP
 
 #if HAVE_BIGENDIAN
@@ -311,6 +313,17 @@ typedef struct SwsContext {
     int cascaded_tmpStride[4];
     uint8_t *cascaded_tmp[4];
 
+    /* The slice_ctx fields allow splitting the destination image into
+     * horizontal bands which are scaled concurrently, each band by its own
+     * context so that no line buffer is shared between threads.
+     */
+    struct SwsContext **slice_ctx;
+    int nb_slice_ctx;
+    struct SwsThreadPool *thread_pool; ///< Threads scaling the bands of a complete frame in sws_scale().
+    int nb_threads;               ///< Number of threads requested by the user, 0 for automatic.
+    int band_start;               ///< First destination row of the band being scaled.
+    int band_end;                 ///< Destination row following the band being scaled, 0 if not scaling a band.
+
     uint32_t pal_yuv[256];
     uint32_t pal_rgb[256];
 
@@ -853,6 +866,44 @@ void ff_get_unscaled_swscale_arm(SwsContext *c);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+/**
+ * Start the threads scaling the bands of the slice contexts of c in
+ * sws_scale(). Does nothing if c has less than two slice contexts.
+ */
+int ff_sws_init_thread_pool(SwsContext *c);
+void ff_sws_free_thread_pool(SwsContext *c);
+
+/**
+ * Scale one horizontal band of the destination image from a complete
+ * source image.
+ *
+ * The destination is split into nb_bands bands of consecutive rows. Bands
+ * of the same frame may be scaled concurrently from different threads, as
+ * long as nb_bands does not exceed the value of the "threads" option the
+ * context was initialized with. The result is identical to scaling the
+ * whole frame with sws_scale().
+ *
+ * If the conversion cannot be split, the first band scales the whole image
+ * and the other bands do nothing.
+ *
+ * @param c         the scaling context previously created with
+ *                  sws_getContext() or sws_init_context()
+ * @param src       the array containing the pointers to the planes of
+ *                  the complete source image
+ * @param srcStride the array containing the strides for each plane of
+ *                  the source image
+ * @param dst       the array containing the pointers to the planes of
+ *                  the destination image
+ * @param dstStride the array containing the strides for each plane of
+ *                  the destination image
+ * @param band      the index of the band to scale, 0 <= band < nb_bands
+ * @param nb_bands  the number of bands the destination is split into
+ * @return          the height of the output band or a negative error code
+ */
+int ff_sws_scale_band(struct SwsContext *c, const uint8_t *const src[],
+                      const int srcStride[], uint8_t *const dst[],
+                      const int dstStride[], int band, int nb_bands);
+
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2planar1_fn *yuv2plane1,
@@ -825,6 +825,12 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
     int need_reinit = 0;
+    int i;
+
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_setColorspaceDetails(c->slice_ctx[i], inv_table, srcRange, table,
+                                 dstRange, brightness, contrast, saturation);
+
     memmove(c->srcColorspaceTable, inv_table, sizeof(int) * 4);
     memmove(c->dstColorspaceTable, table, sizeof(int) * 4);
 
@@ -960,6 +966,49 @@ SwsContext *sws_alloc_context(void)
     return c;
 }
 
+/**
+ * Allocate one context per destination band when the conversion can be split
+ * into independent bands producing the same output as a full frame scale.
+ * Conversions keeping state from one line to the next (error diffusion,
+ * palettes, XYZ or bayer input, cascaded scalers) stay single threaded.
+ */
+static av_cold int init_slice_contexts(SwsContext *c, SwsFilter *srcFilter,
+                                       SwsFilter *dstFilter)
+{
+    int nb_threads = c->nb_threads ? c->nb_threads : av_cpu_count();
+    int i, ret;
+
+    nb_threads = FFMIN3(nb_threads, SWS_MAX_THREADS, c->dstH / 16);
+    c->nb_threads = FFMAX(nb_threads, 1);
+
+    if (c->nb_threads < 2 || c->cascaded_context[0] ||
+        c->dither == SWS_DITHER_ED || c->vChrDrop ||
+        usePal(c->srcFormat) || isBayer(c->srcFormat) ||
+        c->srcXYZ || c->dstXYZ || (c->src0Alpha && !c->dst0Alpha))
+        return 0;
+
+    c->slice_ctx = av_mallocz_array(c->nb_threads, sizeof(*c->slice_ctx));
+    if (!c->slice_ctx)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < c->nb_threads; i++) {
+        SwsContext *slice = sws_alloc_context();
+        if (!slice)
+            return AVERROR(ENOMEM);
+        c->slice_ctx[c->nb_slice_ctx++] = slice;
+
+        if ((ret = av_opt_copy(slice, c)) < 0)
+            return ret;
+        slice->nb_threads = 1;
+        if ((ret = sws_init_context(slice, srcFilter, dstFilter)) < 0)
+            return ret;
+        sws_setColorspaceDetails(slice, c->srcColorspaceTable, c->srcRange,
+                                 c->dstColorspaceTable, c->dstRange,
+                                 c->brightness, c->contrast, c->saturation);
+    }
+    return ff_sws_init_thread_pool(c);
+}
+
 av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                              SwsFilter *dstFilter)
 {
@@ -1516,12 +1565,12 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                 av_log(c, AV_LOG_INFO,
                        "using unscaled %s -> %s special converter\n",
                        av_get_pix_fmt_name(srcFormat), av_get_pix_fmt_name(dstFormat));
-            return 0;
+            return init_slice_contexts(c, srcFilter, dstFilter);
         }
     }
 
     c->swscale = ff_getSwsFunc(c);
-    return 0;
+    return init_slice_contexts(c, srcFilter, dstFilter);
 fail: // FIXME replace things by appropriate error codes
     if (ret == RETCODE_USE_CASCADE)  {
         int tmpW = sqrt(srcW * (int64_t)dstW);
@@ -1974,6 +2023,12 @@ void sws_freeContext(SwsContext *c)
     memset(c->cascaded_context, 0, sizeof(c->cascaded_context));
     av_freep(&c->cascaded_tmp[0]);
 
+    ff_sws_free_thread_pool(c);
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+    c->nb_slice_ctx = 0;
+
     av_free(c);
 }
 
@@ -0,0 +1,38 @@
+/* @@--
+ * 
+ * Copyright (C) 2010-2015 Alberto Vigata
+ *       
+ * This file is part of vgtmpeg
+ * 
+ * a Versed Generalist Transcoder
+ * 
+ * vgtmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ * 
+ * vgtmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __NLANALYZE_H
+#define __NLANALYZE_H
+
+#include "libavformat/avformat.h"
+#include "libavutil/dict.h"
+
+/* quick crop/interlacing analysis of an input. The input is reopened and
+ * nb_samples evenly spaced byte positions are visited, decoding a few frames
+ * from the first keyframe found at each of them. On dvd:// and bd:// urls
+ * the byte seeks land on VOBU/clip boundaries through the protocol seek.
+ * Results are logged, and sent as an analysisinfo message with -output_xml */
+int nl_analyze_input(const char *filename, AVInputFormat *fmt,
+                     AVDictionary *format_opts, int index, int nb_samples);
+
+#endif /* __NLANALYZE_H */
@@ -31,6 +31,7 @@
 
 #define FFMSG_MSGTYPE_STREAMINFO "streaminfo"
 #define FFMSG_MSGTYPE_PROGRESSINFO "progressinfo"
+#define FFMSG_MSGTYPE_ANALYSISINFO "analysisinfo"
 
 
 #define FFMSG_START "<nlffmsg>\n"
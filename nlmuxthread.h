@@ -0,0 +1,59 @@
+/* @@--
+ *
+ * Copyright (C) 2010-2015 Alberto Vigata
+ *
+ * This file is part of vgtmpeg
+ *
+ * a Versed Generalist Transcoder
+ *
+ * vgtmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * vgtmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __NLMUXTHREAD_H
+#define __NLMUXTHREAD_H
+
+#include "ffmpeg.h"
+
+typedef struct NLMuxThread NLMuxThread;
+
+/* asynchronous muxing. Once the header is written, the packets of an output
+ * file go through a queue of queue_size packets to a thread that passes
+ * them to av_interleaved_write_frame() in the same order, so the output is
+ * the same as when muxing synchronously. A full queue blocks the caller.
+ * The first muxing error is returned by the following writes and by stop,
+ * after which the queued packets are dropped. Raw pictures point to frames
+ * of the caller and packets without timestamps get them from the muxer, so
+ * files with them are muxed synchronously and of->mux_thread is left NULL */
+int nl_mux_thread_start(OutputFile *of, int queue_size);
+/* takes ownership of the packet */
+int nl_mux_thread_write(OutputFile *of, AVPacket *pkt);
+/* the field order the muxer gets with the next packets of the stream,
+ * the muxer itself belongs to the thread */
+void nl_mux_thread_set_field_order(OutputFile *of, int stream_index,
+                                   enum AVFieldOrder field_order);
+/* writes what is still queued and joins the thread, so the trailer can be
+ * written; returns the first muxing error */
+int nl_mux_thread_stop(OutputFile *of);
+/* bytes written so far, readable while the thread runs */
+int64_t nl_mux_thread_size(OutputFile *of);
+/* av_stream_get_end_pts() and st->nb_frames of an output stream, from the
+ * muxer or as published by the thread if there is one */
+int64_t nl_mux_end_pts(OutputFile *of, int stream_index);
+int64_t nl_mux_nb_frames(OutputFile *of, int stream_index);
+/* st->cur_dts of an output stream as it is when muxing synchronously, for
+ * choosing the stream to encode next */
+int64_t nl_mux_cur_dts(OutputFile *of, int stream_index);
+
+#endif /* __NLMUXTHREAD_H */
@@ -0,0 +1,61 @@
+/* @@--
+ *
+ * Copyright (C) 2010-2015 Alberto Vigata
+ *
+ * This file is part of vgtmpeg
+ *
+ * a Versed Generalist Transcoder
+ *
+ * vgtmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * vgtmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __NLPKTQUEUE_H
+#define __NLPKTQUEUE_H
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/threadmessage.h"
+
+/* packet queue between one input thread and the main thread. The packets
+ * go through a lock-free ring, the mutex is only taken by a side that has
+ * to sleep, and a sleeping side is woken once a batch of packets or of free
+ * room is available rather than on every packet. A full queue grows up to
+ * max_size packets when sending with AV_THREAD_MESSAGE_NONBLOCK.
+ * Same calling conventions as AVThreadMessageQueue: exactly one thread
+ * sends and one receives */
+typedef struct NLPacketQueue NLPacketQueue;
+
+typedef struct NLPacketQueueStats {
+    int size;           /* current capacity in packets */
+    int max_fill;       /* most packets queued at once */
+    int nb_packets;     /* packets sent through the queue */
+    int nb_wakeups;     /* times a sleeping side was signalled */
+    int nb_send_waits;  /* times the sender slept on a full queue */
+    int nb_recv_waits;  /* times the receiver slept on an empty queue */
+    int nb_grows;       /* times the queue was enlarged */
+} NLPacketQueueStats;
+
+int  nl_pktqueue_alloc(NLPacketQueue **q, int size, int max_size);
+void nl_pktqueue_free(NLPacketQueue **q);
+int  nl_pktqueue_send(NLPacketQueue *q, AVPacket *pkt, unsigned flags);
+int  nl_pktqueue_recv(NLPacketQueue *q, AVPacket *pkt, unsigned flags);
+/* the error returned to the sender, and the one returned to the receiver
+ * once the queue is empty */
+void nl_pktqueue_set_err_send(NLPacketQueue *q, int err);
+void nl_pktqueue_set_err_recv(NLPacketQueue *q, int err);
+/* the counters are updated without locking, they may lag a little while
+ * the sender runs */
+void nl_pktqueue_get_stats(NLPacketQueue *q, NLPacketQueueStats *stats);
+
+#endif /* __NLPKTQUEUE_H */
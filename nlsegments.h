@@ -0,0 +1,39 @@
+/* @@--
+ *
+ * Copyright (C) 2010-2015 Alberto Vigata
+ *
+ * This file is part of vgtmpeg
+ *
+ * a Versed Generalist Transcoder
+ *
+ * vgtmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * vgtmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __NLSEGMENTS_H
+#define __NLSEGMENTS_H
+
+#include "cmdutils.h"
+
+/* parallel segment encoding. The input timeline is split at video keyframes
+ * into nb_segments chunks, one child process running the same command line
+ * encodes each chunk to a temporary file next to the output, and the chunks
+ * are then remuxed in order into the output through the concat demuxer.
+ * Only one input and one output file are supported, without -ss, -t or -to.
+ * Returns 0 when the output was written, AVERROR(ENOSYS) when the command
+ * can't be split and has to run normally, or another error */
+int nl_parallel_segments(OptionGroupList *inputs, OptionGroupList *outputs,
+                         int argc, char **argv, int nb_segments);
+
+#endif /* __NLSEGMENTS_H */
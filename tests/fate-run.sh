@@ -84,20 +84,35 @@ probeframes(){
     run ffprobe -show_frames -v 0 "$@"
 }
 
-ffmpeg(){
+# $1=program, ffmpeg or a driver taking the same options
+ffmpeg_prog(){
+    prog=$1
+    shift
     dec_opts="-threads $threads -thread_type $thread_type"
     ffmpeg_args="-nostats -cpuflags $cpuflags"
     for arg in $@; do
         [ x${arg} = x-i ] && ffmpeg_args="${ffmpeg_args} ${dec_opts}"
         ffmpeg_args="${ffmpeg_args} ${arg}"
     done
-    run ffmpeg ${ffmpeg_args}
+    run ${prog}${PROGSUF}${EXECSUF} ${ffmpeg_args}
+}
+
+ffmpeg(){
+    ffmpeg_prog ffmpeg "$@"
+}
+
+vgtmpeg(){
+    ffmpeg_prog vgtmpeg "$@"
 }
 
 framecrc(){
     ffmpeg "$@" -flags +bitexact -f framecrc -
 }
 
+vgtmpeg_framecrc(){
+    vgtmpeg -nostdin "$@" -flags +bitexact -f framecrc -
+}
+
 framemd5(){
     ffmpeg "$@" -flags +bitexact -f framemd5 -
 }
@@ -133,6 +148,134 @@ enc_dec_pcm(){
     ffmpeg -flags +bitexact -i ${encfile} -c:a pcm_${pcm_fmt} -f ${dec_fmt} -
 }
 
+# encode with one thread and with nb_threads threads, the outputs must be
+# identical and match the reference md5
+enc_cmp_threads(){
+    nb_threads=$1
+    out_fmt=$2
+    src_file=$(target_path $3)
+    shift 3
+    encfile1="${outdir}/${test}.1.${out_fmt}"
+    encfilen="${outdir}/${test}.${nb_threads}.${out_fmt}"
+    cleanfiles="$encfile1 $encfilen"
+    ffmpeg -i $src_file "$@" -threads 1 -flags +bitexact -f $out_fmt \
+        -y $(target_path $encfile1) || return
+    ffmpeg -i $src_file "$@" -threads $nb_threads -flags +bitexact -f $out_fmt \
+        -y $(target_path $encfilen) || return
+    cmp $encfile1 $encfilen || return
+    do_md5sum $encfilen
+}
+
+# mux the inputs to a transport stream, then demux the stream with the given
+# index alone, which drops the packets of the other pids before parsing them,
+# and along with all the other streams; its packets must be identical
+ts_map_cmp(){
+    index=$1
+    shift
+    tsfile="${outdir}/${test}.ts"
+    allfile="${outdir}/${test}.all.framecrc"
+    selfile="${outdir}/${test}.sel.framecrc"
+    onefile="${outdir}/${test}.one.framecrc"
+    cleanfiles="$tsfile $allfile $selfile $onefile"
+    ffmpeg "$@" -flags +bitexact -fflags +bitexact -f mpegts \
+        -y $(target_path $tsfile) || return
+    ffmpeg -i $(target_path $tsfile) -map 0 -c copy -flags +bitexact \
+        -f framecrc -y $(target_path $allfile) || return
+    ffmpeg -i $(target_path $tsfile) -map 0:$index -c copy -flags +bitexact \
+        -f framecrc -y $(target_path $onefile) || return
+    sed -n "s/^$index,/0,/p" $allfile > $selfile
+    grep "^0," $onefile | cmp - $selfile || return
+    cat $onefile
+}
+
+tee_cmp_threads(){
+    queue_size=$1
+    shift
+    for t in 0 1; do
+        slaves="[f=framecrc]$(target_path ${outdir}/${test}.${t}.framecrc)"
+        slaves="${slaves}|[f=nut:fflags=+bitexact]$(target_path ${outdir}/${test}.${t}.nut)"
+        ffmpeg -nostdin -y "$@" -flags +bitexact \
+            -f tee -slave_threads $t -queue_size $queue_size "$slaves" || return
+    done
+    cleanfiles="${outdir}/${test}.0.framecrc ${outdir}/${test}.0.nut"
+    cleanfiles="$cleanfiles ${outdir}/${test}.1.framecrc ${outdir}/${test}.1.nut"
+    cmp ${outdir}/${test}.0.framecrc ${outdir}/${test}.1.framecrc &&
+        cmp ${outdir}/${test}.0.nut ${outdir}/${test}.1.nut && echo identical
+}
+
+# a framecrc slave along with one failing to write, written serially and from
+# threads; the framecrc slave must be complete both times
+tee_onfail_ignore(){
+    failing_slave=$1
+    shift
+    for t in 0 1; do
+        slaves="[f=framecrc]$(target_path ${outdir}/${test}.${t}.framecrc)|${failing_slave}"
+        ffmpeg -nostdin -y "$@" -flags +bitexact \
+            -f tee -slave_threads $t -onfail ignore "$slaves" || return
+    done
+    cleanfiles="${outdir}/${test}.0.framecrc ${outdir}/${test}.1.framecrc"
+    cmp ${outdir}/${test}.0.framecrc ${outdir}/${test}.1.framecrc || return
+    cat ${outdir}/${test}.0.framecrc
+}
+
+# segment with the boundary I/O done inline and in a background thread,
+# $1=option enabling the thread, $2=option giving the playlist if it is not
+# the output, $3=output name; the segments and playlists must be identical
+segment_async_cmp(){
+    async_opt=$1
+    list_opt=$2
+    out_name=$3
+    shift 3
+    for a in 0 1; do
+        dir="${outdir}/${test}.${a}"
+        rm -rf $dir && mkdir -p $dir || return
+        list_args=${list_opt:+"-$list_opt $(target_path $dir/list.m3u8)"}
+        ffmpeg -nostdin -y "$@" -flags +bitexact -fflags +bitexact \
+            -$async_opt $a $list_args $(target_path $dir/$out_name) || return
+    done
+    dir0="${outdir}/${test}.0"
+    dir1="${outdir}/${test}.1"
+    ls $dir0 > ${outdir}/${test}.files || return
+    ls $dir1 | cmp - ${outdir}/${test}.files || return
+    for f in $(cat ${outdir}/${test}.files); do
+        cmp $dir0/$f $dir1/$f || return
+    done
+    cat ${outdir}/${test}.files
+    rm -rf $dir0 $dir1 ${outdir}/${test}.files
+}
+
+mux_queue_cmp(){
+    queue_size=$1
+    out_fmt=$2
+    src_fmt=$3
+    src_file=$(target_path $4)
+    shift 4
+    outfile0="${outdir}/${test}.0.${out_fmt}"
+    outfilen="${outdir}/${test}.${queue_size}.${out_fmt}"
+    cleanfiles="$outfile0 $outfilen"
+    vgtmpeg -nostdin -y -f $src_fmt -i $src_file "$@" \
+        -f $out_fmt $(target_path $outfile0) || return
+    vgtmpeg -nostdin -y -f $src_fmt -i $src_file "$@" -mux_queue_size $queue_size \
+        -f $out_fmt $(target_path $outfilen) || return
+    cmp $outfile0 $outfilen && echo identical
+}
+
+# $1=number of segments, $2=options of the parallel encode, then the
+# arguments making the source file
+parallel_segments(){
+    nb_segments=$1
+    enc_opts=$2
+    shift 2
+    srcfile="${outdir}/${test}.src.nut"
+    encfile="${outdir}/${test}.nut"
+    cleanfiles="$srcfile $encfile"
+    ffmpeg "$@" $ENC_OPTS -f nut -y $(target_path $srcfile) || return
+    vgtmpeg -nostdin -y -idct simple -i $(target_path $srcfile) \
+        -parallel_segments $nb_segments $enc_opts -flags +bitexact -f nut \
+        $(target_path $encfile) || return
+    framecrc -i $(target_path $encfile)
+}
+
 FLAGS="-flags +bitexact -sws_flags +accurate_rnd+bitexact -fflags +bitexact"
 DEC_OPTS="-threads $threads -idct simple $FLAGS"
 ENC_OPTS="-threads 1        -idct simple -dct fastint"
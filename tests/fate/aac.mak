@@ -95,6 +95,10 @@ fate-aac-aref-encode: CMP_TARGET = 434
 fate-aac-aref-encode: SIZE_TOLERANCE = 2464
 fate-aac-aref-encode: FUZZ = 5
 
+FATE_AAC_ENCODE += fate-aac-aref-encode-threads
+fate-aac-aref-encode-threads: ./tests/data/asynth-44100-2.wav
+fate-aac-aref-encode-threads: CMD = enc_cmp_threads 4 adts ./tests/data/asynth-44100-2.wav -strict -2 -c:a aac -b:a 512k
+
 FATE_AAC_ENCODE += fate-aac-ln-encode
 fate-aac-ln-encode: CMD = enc_dec_pcm adts wav s16le $(TARGET_SAMPLES)/audio-reference/luckynight_2ch_44kHz_s16.wav -strict -2 -c:a aac -b:a 512k
 fate-aac-ln-encode: CMP = stddev
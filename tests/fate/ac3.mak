@@ -78,6 +78,27 @@ fate-ac3-fixed-encode: CMD = md5 -i $(SRC) -c ac3_fixed -ab 128k -f ac3 -flags +
 fate-ac3-fixed-encode: CMP = oneline
 fate-ac3-fixed-encode: REF = a1d1fc116463b771abf5aef7ed37d7b1
 
+FATE_AC3-$(call ENCMUX, AC3_FIXED, AC3) += fate-ac3-fixed-encode-parallel
+fate-ac3-fixed-encode-parallel: tests/data/asynth-44100-2.wav
+fate-ac3-fixed-encode-parallel: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
+fate-ac3-fixed-encode-parallel: CMD = md5 -i $(SRC) -c ac3_fixed -ab 128k -parallel_frames 4 -threads 4 -f ac3 -flags +bitexact
+fate-ac3-fixed-encode-parallel: CMP = oneline
+fate-ac3-fixed-encode-parallel: REF = a1d1fc116463b771abf5aef7ed37d7b1
+
+FATE_AC3-$(call ENCMUX, AC3, AC3) += fate-ac3-encode-parallel
+fate-ac3-encode-parallel: tests/data/asynth-44100-2.wav
+fate-ac3-encode-parallel: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
+fate-ac3-encode-parallel: CMD = md5 -i $(SRC) -c ac3 -ab 128k -parallel_frames 4 -threads 4 -f ac3 -flags +bitexact
+fate-ac3-encode-parallel: CMP = oneline
+fate-ac3-encode-parallel: REF = d7df88f4b06f41736717e2382ec291c2
+
+FATE_EAC3-$(call ENCMUX, EAC3, EAC3) += fate-eac3-encode-parallel
+fate-eac3-encode-parallel: tests/data/asynth-44100-2.wav
+fate-eac3-encode-parallel: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
+fate-eac3-encode-parallel: CMD = md5 -i $(SRC) -c eac3 -ab 128k -parallel_frames 4 -threads 4 -f eac3 -flags +bitexact
+fate-eac3-encode-parallel: CMP = oneline
+fate-eac3-encode-parallel: REF = 4a954bb4d9ac7fc84d89408f6bb2bfde
+
 FATE_SAMPLES_AVCONV += $(FATE_AC3-yes) $(FATE_EAC3-yes)
 
 fate-ac3: $(FATE_AC3-yes) $(FATE_EAC3-yes)
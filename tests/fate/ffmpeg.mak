@@ -21,6 +21,118 @@ fate-ffmpeg-filter_complex: CMD = framecrc -filter_complex color=d=1:r=5
 FATE_FFMPEG-$(CONFIG_COLOR_FILTER) += fate-ffmpeg-lavfi
 fate-ffmpeg-lavfi: CMD = framecrc -lavfi color=d=1:r=5
 
+FATE_FFMPEG-$(call ALLYES, WAV_DEMUXER PCM_S16LE_DECODER) += fate-ffmpeg-max_buffer_size
+fate-ffmpeg-max_buffer_size: tests/data/asynth-44100-2.wav
+fate-ffmpeg-max_buffer_size: CMD = framecrc -max_buffer_size 1048576 -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -c copy
+
+FATE_FFMPEG-$(call ALLYES, WAV_DEMUXER PCM_S16LE_DECODER) += fate-ffmpeg-max_buffer_size-seek
+fate-ffmpeg-max_buffer_size-seek: tests/data/asynth-44100-2.wav
+fate-ffmpeg-max_buffer_size-seek: CMD = framecrc -max_buffer_size 1048576 -ss 2 -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -c copy
+
+# a framecrc and a nut slave, written serially and from threads
+FATE_FFMPEG-$(call ALLYES, RAWVIDEO_DEMUXER WAV_DEMUXER TEE_MUXER FRAMECRC_MUXER NUT_MUXER MPEG4_ENCODER PCM_S16LE_DECODER PCM_S16LE_ENCODER) += fate-tee-slave_threads
+fate-tee-slave_threads: tests/data/vsynth1.yuv tests/data/asynth-44100-2.wav
+fate-tee-slave_threads: CMD = tee_cmp_threads 2 \
+  -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv \
+  -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav \
+  -map 0:v -map 1:a -c:v mpeg4 -c:a pcm_s16le -shortest
+fate-tee-slave_threads: CMP = oneline
+fate-tee-slave_threads: REF = identical
+
+# a slave failing to write to a full device is dropped, the other one goes on
+ifneq ($(wildcard /dev/full),)
+FATE_FFMPEG-$(call ALLYES, RAWVIDEO_DEMUXER TEE_MUXER FRAMECRC_MUXER M4V_MUXER MPEG4_ENCODER) += fate-tee-onfail-ignore
+endif
+fate-tee-onfail-ignore: tests/data/vsynth1.yuv
+fate-tee-onfail-ignore: CMD = tee_onfail_ignore "[f=m4v]/dev/full" \
+  -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv \
+  -map 0:v -c:v mpeg4
+
+# only the second audio stream of a transport stream, compared to demuxing all
+FATE_FFMPEG-$(call ALLYES, RAWVIDEO_DEMUXER WAV_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER FRAMECRC_MUXER MPEG2VIDEO_ENCODER MP2_ENCODER PCM_S16LE_DECODER) += fate-mpegts-map-discard
+fate-mpegts-map-discard: tests/data/vsynth1.yuv tests/data/asynth-44100-2.wav
+fate-mpegts-map-discard: CMD = ts_map_cmp 2 \
+  -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv \
+  -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav \
+  -map 0:v -map 1:a -map 1:a -c:v mpeg2video -c:a mp2 -shortest
+
+# three inputs read by their threads, vgtmpeg must give the output of ffmpeg
+MULTI_INPUT_ARGS = -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv \
+  -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -i $(TARGET_PATH)/tests/data/asynth-22050-1.wav \
+  -map 0 -map 1 -map 2 -c copy -t 2
+
+FATE_FFMPEG-$(call ALLYES, RAWVIDEO_DEMUXER WAV_DEMUXER FRAMECRC_MUXER) += fate-ffmpeg-multi_input
+fate-ffmpeg-multi_input: tests/data/vsynth1.yuv tests/data/asynth-44100-2.wav tests/data/asynth-22050-1.wav
+fate-ffmpeg-multi_input: CMD = framecrc $(MULTI_INPUT_ARGS)
+
+FATE_FFMPEG-$(call ALLYES, RAWVIDEO_DEMUXER WAV_DEMUXER FRAMECRC_MUXER) += fate-vgtmpeg-multi_input
+fate-vgtmpeg-multi_input: tests/data/vsynth1.yuv tests/data/asynth-44100-2.wav tests/data/asynth-22050-1.wav vgtmpeg$(PROGSSUF)$(EXESUF)
+fate-vgtmpeg-multi_input: CMD = vgtmpeg_framecrc $(MULTI_INPUT_ARGS)
+fate-vgtmpeg-multi_input: REF = $(SRC_PATH)/tests/ref/fate/ffmpeg-multi_input
+
+# muxed by a thread through a queue of 4 packets, compared to muxing synchronously
+FATE_MUX_QUEUE-$(call ALLYES, RAWVIDEO_DEMUXER MOV_MUXER MPEG2VIDEO_ENCODER SETFIELD_FILTER) += fate-vgtmpeg-mux_queue_size-mov
+fate-vgtmpeg-mux_queue_size-mov: tests/data/vsynth1.yuv vgtmpeg$(PROGSSUF)$(EXESUF)
+fate-vgtmpeg-mux_queue_size-mov: CMD = mux_queue_cmp 4 mov \
+  "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv \
+  -vf setfield=tff -c:v mpeg2video -flags +ildct+bitexact -fflags +bitexact
+
+FATE_MUX_QUEUE-$(call ALLYES, RAWVIDEO_DEMUXER YUV4MPEGPIPE_MUXER RAWVIDEO_ENCODER) += fate-vgtmpeg-mux_queue_size-rawpicture
+fate-vgtmpeg-mux_queue_size-rawpicture: tests/data/vsynth1.yuv vgtmpeg$(PROGSSUF)$(EXESUF)
+fate-vgtmpeg-mux_queue_size-rawpicture: CMD = mux_queue_cmp 4 yuv4mpegpipe \
+  "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv \
+  -c:v rawvideo -flags +bitexact -fflags +bitexact
+
+# the encoded stream is chosen from the dts of the last packet sent, so audio
+# and video are interleaved as when muxing synchronously
+FATE_MUX_QUEUE-$(call ALLYES, RAWVIDEO_DEMUXER WAV_DEMUXER NUT_MUXER MPEG4_ENCODER MP2_ENCODER PCM_S16LE_DECODER) += fate-vgtmpeg-mux_queue_size-av
+fate-vgtmpeg-mux_queue_size-av: tests/data/vsynth1.yuv tests/data/asynth-44100-2.wav vgtmpeg$(PROGSSUF)$(EXESUF)
+fate-vgtmpeg-mux_queue_size-av: CMD = mux_queue_cmp 4 nut \
+  "rawvideo -s 352x288 -pix_fmt yuv420p" tests/data/vsynth1.yuv \
+  -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -map 0:v -map 1:a -shortest \
+  -c:v mpeg4 -c:a mp2 -flags +bitexact -fflags +bitexact
+
+fate-vgtmpeg-mux_queue_size-%: CMP = oneline
+fate-vgtmpeg-mux_queue_size-%: REF = identical
+
+FATE_FFMPEG += $(FATE_MUX_QUEUE-yes)
+fate-mux_queue_size: $(FATE_MUX_QUEUE-yes)
+
+# segments, a rewritten list and the files opened ahead by the segment I/O
+# thread, compared to closing and writing them inline
+FATE_SEGMENT_ASYNC-$(call ALLYES, RAWVIDEO_DEMUXER SEGMENT_MUXER MPEGTS_MUXER MPEG2VIDEO_ENCODER) += fate-segment-async_io
+fate-segment-async_io: tests/data/vsynth1.yuv
+fate-segment-async_io: CMD = segment_async_cmp segment_async_io segment_list out%03d.ts \
+  -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv \
+  -c:v mpeg2video -g 6 -f segment -segment_time 0.4 -segment_list_size 3 -segment_preopen 3
+
+FATE_SEGMENT_ASYNC-$(call ALLYES, RAWVIDEO_DEMUXER HLS_MUXER MPEGTS_MUXER MPEG2VIDEO_ENCODER) += fate-hls-async_io
+fate-hls-async_io: tests/data/vsynth1.yuv
+fate-hls-async_io: CMD = segment_async_cmp hls_async_io "" out.m3u8 \
+  -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv \
+  -c:v mpeg2video -g 5 -f hls -hls_time 0.2 -hls_list_size 2 -hls_flags delete_segments
+
+FATE_FFMPEG += $(FATE_SEGMENT_ASYNC-yes)
+fate-async_io: $(FATE_SEGMENT_ASYNC-yes)
+
+# encoded in 4 segments by concurrent processes, the reference is a single run
+FATE_PARALLEL_SEGMENTS-$(call ALLYES, RAWVIDEO_DEMUXER NUT_MUXER NUT_DEMUXER MPEG2VIDEO_ENCODER MPEG2VIDEO_DECODER FFV1_ENCODER FFV1_DECODER CONCAT_DEMUXER) += fate-vgtmpeg-parallel_segments
+fate-vgtmpeg-parallel_segments: tests/data/vsynth1.yuv vgtmpeg$(PROGSSUF)$(EXESUF)
+fate-vgtmpeg-parallel_segments: CMD = parallel_segments 4 "-c:v ffv1" \
+  -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv \
+  -c:v mpeg2video -g 12 -bf 2 -sc_threshold 1000000000 -q:v 4 -flags +cgop+bitexact
+
+# with an audio stream, cut at the packet before the video keyframes
+FATE_PARALLEL_SEGMENTS-$(call ALLYES, RAWVIDEO_DEMUXER WAV_DEMUXER NUT_MUXER NUT_DEMUXER MPEG2VIDEO_ENCODER MPEG2VIDEO_DECODER MP2_ENCODER MP2_DECODER FFV1_ENCODER FFV1_DECODER PCM_S16LE_ENCODER CONCAT_DEMUXER) += fate-vgtmpeg-parallel_segments-audio
+fate-vgtmpeg-parallel_segments-audio: tests/data/vsynth1.yuv tests/data/asynth-44100-2.wav vgtmpeg$(PROGSSUF)$(EXESUF)
+fate-vgtmpeg-parallel_segments-audio: CMD = parallel_segments 4 "-c:v ffv1 -c:a pcm_s16le" \
+  -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv \
+  -i $(TARGET_PATH)/tests/data/asynth-44100-2.wav -map 0:v -map 1:a -shortest \
+  -c:v mpeg2video -g 12 -bf 2 -sc_threshold 1000000000 -q:v 4 -flags +cgop+bitexact -c:a mp2
+
+FATE_FFMPEG += $(FATE_PARALLEL_SEGMENTS-yes)
+fate-parallel_segments: $(FATE_PARALLEL_SEGMENTS-yes)
+
 FATE_SAMPLES_FFMPEG-$(CONFIG_RAWVIDEO_DEMUXER) += fate-force_key_frames
 fate-force_key_frames: tests/data/vsynth_lena.yuv
 fate-force_key_frames: CMD = enc_dec \
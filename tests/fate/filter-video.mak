@@ -66,6 +66,25 @@ fate-filter-lavd-scalenorm: CMD = framecrc -f lavfi -graph_file $(TARGET_PATH)/t
 FATE_FILTER_VSYNTH-$(CONFIG_BOXBLUR_FILTER) += fate-filter-boxblur
 fate-filter-boxblur: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf boxblur=2:1
 
+FATE_BWDIF += fate-filter-bwdif-mode0
+fate-filter-bwdif-mode0: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf bwdif=0 -threads 1
+
+FATE_BWDIF += fate-filter-bwdif-mode1
+fate-filter-bwdif-mode1: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf bwdif=1 -threads 1
+
+FATE_BWDIF += fate-filter-bwdif-mode1-threads
+fate-filter-bwdif-mode1-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf bwdif=1 -threads 4
+fate-filter-bwdif-mode1-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-bwdif-mode1
+
+FATE_BWDIF += fate-filter-bwdif-mode1-c
+fate-filter-bwdif-mode1-c: CMD = framecrc -cpuflags 0 -c:v pgmyuv -i $(SRC) -vf bwdif=1 -threads 1
+fate-filter-bwdif-mode1-c: REF = $(SRC_PATH)/tests/ref/fate/filter-bwdif-mode1
+
+FATE_BWDIF += fate-filter-bwdif10
+fate-filter-bwdif10: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf format=yuv420p10le,bwdif=0 -threads 1
+
+FATE_FILTER_VSYNTH-$(CONFIG_BWDIF_FILTER) += $(FATE_BWDIF)
+
 FATE_FILTER_VSYNTH-$(call ALLYES, COLORCHANNELMIXER_FILTER FORMAT_FILTER PERMS_FILTER) += fate-filter-colorchannelmixer
 fate-filter-colorchannelmixer: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf format=rgb24,perms=random,colorchannelmixer=.31415927:.4:.31415927:0:.27182818:.8:.27182818:0:.2:.6:.2:0 -flags +bitexact -sws_flags +accurate_rnd+bitexact
 
@@ -91,9 +110,26 @@ fate-filter-framepack: $(FATE_FILTER_FRAMEPACK)
 FATE_FILTER_VSYNTH-$(CONFIG_GRADFUN_FILTER) += fate-filter-gradfun
 fate-filter-gradfun: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf gradfun
 
+FATE_FIELDMATCH += fate-filter-fieldmatch
+fate-filter-fieldmatch: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf telecine,fieldmatch=mode=pcn_ub:combmatch=full -threads 1
+
+FATE_FIELDMATCH += fate-filter-fieldmatch-threads
+fate-filter-fieldmatch-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf telecine,fieldmatch=mode=pcn_ub:combmatch=full -threads 4
+fate-filter-fieldmatch-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-fieldmatch
+
+FATE_FIELDMATCH += fate-filter-fieldmatch-c
+fate-filter-fieldmatch-c: CMD = framecrc -cpuflags 0 -c:v pgmyuv -i $(SRC) -vf telecine,fieldmatch=mode=pcn_ub:combmatch=full -threads 4
+fate-filter-fieldmatch-c: REF = $(SRC_PATH)/tests/ref/fate/filter-fieldmatch
+
+FATE_FILTER_VSYNTH-$(call ALLYES, TELECINE_FILTER FIELDMATCH_FILTER) += $(FATE_FIELDMATCH)
+
 FATE_FILTER_VSYNTH-$(CONFIG_HQDN3D_FILTER) += fate-filter-hqdn3d
 fate-filter-hqdn3d: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf hqdn3d
 
+FATE_FILTER_VSYNTH-$(CONFIG_HQDN3D_FILTER) += fate-filter-hqdn3d-threads
+fate-filter-hqdn3d-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf hqdn3d -threads 4
+fate-filter-hqdn3d-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-hqdn3d
+
 FATE_FILTER_VSYNTH-$(CONFIG_INTERLACE_FILTER) += fate-filter-interlace
 fate-filter-interlace: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf interlace
 
@@ -110,6 +146,11 @@ FATE_FILTER_VSYNTH-$(CONFIG_OVERLAY_FILTER) += fate-filter-overlay
 fate-filter-overlay: tests/data/filtergraphs/overlay
 fate-filter-overlay: CMD = framecrc -c:v pgmyuv -i $(SRC) -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay
 
+FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER OVERLAY_FILTER) += fate-filter-overlay-threads
+fate-filter-overlay-threads: tests/data/filtergraphs/overlay-threads
+fate-filter-overlay-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_script $(TARGET_PATH)/tests/data/filtergraphs/overlay-threads -threads 4
+fate-filter-overlay-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-overlay
+
 FATE_FILTER_VSYNTH-$(call ALLYES, SPLIT_FILTER SCALE_FILTER PAD_FILTER OVERLAY_FILTER) += fate-filter-overlay_rgb
 fate-filter-overlay_rgb: tests/data/filtergraphs/overlay_rgb
 fate-filter-overlay_rgb: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/overlay_rgb
@@ -171,6 +212,26 @@ FATE_FILTER_VSYNTH-$(CONFIG_TRIM_FILTER) += $(FATE_TRIM)
 FATE_FILTER_VSYNTH-$(CONFIG_UNSHARP_FILTER) += fate-filter-unsharp
 fate-filter-unsharp: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf unsharp=11:11:-1.5:11:11:-1.5
 
+FATE_FILTER_VSYNTH-$(CONFIG_UNSHARP_FILTER) += fate-filter-unsharp-threads
+fate-filter-unsharp-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf unsharp=11:11:-1.5:11:11:-1.5 -threads 4
+fate-filter-unsharp-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-unsharp
+
+FATE_W3FDIF += fate-filter-w3fdif-simple
+fate-filter-w3fdif-simple: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf w3fdif=simple -threads 1
+
+FATE_W3FDIF += fate-filter-w3fdif-complex
+fate-filter-w3fdif-complex: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf w3fdif=complex -threads 1
+
+FATE_W3FDIF += fate-filter-w3fdif-complex-threads
+fate-filter-w3fdif-complex-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf w3fdif=complex -threads 4
+fate-filter-w3fdif-complex-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-w3fdif-complex
+
+FATE_W3FDIF += fate-filter-w3fdif-complex-c
+fate-filter-w3fdif-complex-c: CMD = framecrc -cpuflags 0 -c:v pgmyuv -i $(SRC) -vf w3fdif=complex -threads 4
+fate-filter-w3fdif-complex-c: REF = $(SRC_PATH)/tests/ref/fate/filter-w3fdif-complex
+
+FATE_FILTER_VSYNTH-$(CONFIG_W3FDIF_FILTER) += $(FATE_W3FDIF)
+
 FATE_FILTER-$(call ALLYES, SMJPEG_DEMUXER MJPEG_DECODER PERMS_FILTER HQDN3D_FILTER) += fate-filter-hqdn3d-sample
 fate-filter-hqdn3d-sample: tests/data/filtergraphs/hqdn3d
 fate-filter-hqdn3d-sample: CMD = framecrc -idct simple -i $(TARGET_SAMPLES)/smjpeg/scenwin.mjpg -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/hqdn3d -an
@@ -208,6 +269,10 @@ FATE_FILTER_VSYNTH-$(call ALLYES, FORMAT_FILTER SPLIT_FILTER ALPHAEXTRACT_FILTER
 fate-filter-alphaextract_alphamerge_yuv: tests/data/filtergraphs/alphamerge_alphaextract_yuv
 fate-filter-alphaextract_alphamerge_yuv: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/alphamerge_alphaextract_yuv
 
+FATE_FILTER_VSYNTH-$(call ALLYES, FORMAT_FILTER CASCADESCALE_FILTER) += fate-filter-cascadescale
+fate-filter-cascadescale: tests/data/filtergraphs/cascadescale
+fate-filter-cascadescale: CMD = framecrc -c:v pgmyuv -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/cascadescale
+
 FATE_FILTER_VSYNTH-$(CONFIG_CROP_FILTER) += fate-filter-crop
 fate-filter-crop: CMD = video_filter "crop=iw-100:ih-100:100:100"
 
@@ -229,6 +294,22 @@ fate-filter-scale200: CMD = video_filter "scale=w=200:h=200"
 FATE_FILTER_VSYNTH-$(CONFIG_SCALE_FILTER) += fate-filter-scale500
 fate-filter-scale500: CMD = video_filter "scale=w=500:h=500"
 
+FATE_SCALE_THREADS += fate-filter-scale-threads
+fate-filter-scale-threads: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf scale=w=500:h=500:threads=1
+
+FATE_SCALE_THREADS += fate-filter-scale-threads-4
+fate-filter-scale-threads-4: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf scale=w=500:h=500:threads=4
+fate-filter-scale-threads-4: REF = $(SRC_PATH)/tests/ref/fate/filter-scale-threads
+
+FATE_SCALE_THREADS += fate-filter-scale-threads-rgb24
+fate-filter-scale-threads-rgb24: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf scale=threads=1,format=rgb24
+
+FATE_SCALE_THREADS += fate-filter-scale-threads-rgb24-4
+fate-filter-scale-threads-rgb24-4: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf scale=threads=4,format=rgb24
+fate-filter-scale-threads-rgb24-4: REF = $(SRC_PATH)/tests/ref/fate/filter-scale-threads-rgb24
+
+FATE_FILTER_VSYNTH-$(call ALLYES, FORMAT_FILTER SCALE_FILTER) += $(FATE_SCALE_THREADS)
+
 FATE_FILTER_VSYNTH-$(CONFIG_VFLIP_FILTER) += fate-filter-vflip
 fate-filter-vflip: CMD = video_filter "vflip"
 
@@ -441,6 +522,29 @@ fate-filter-metadata-ebur128: CMD = run $(FILTER_METADATA_COMMAND) "amovie='$(SR
 
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
 
+CROPDETECT_DEPS = FFPROBE AVDEVICE LAVFI_INDEV TESTSRC_FILTER COLOR_FILTER OVERLAY_FILTER \
+                  FORMAT_FILTER CROPDETECT_FILTER
+CROPDETECT_SRC = testsrc=s=176x144:r=25:d=0.4[fg];color=c=black:s=352x288:r=25:d=0.4[bg];[bg][fg]overlay=x=8*n:y=4*n,format=yuv420p
+FATE_CROPDETECT += fate-filter-metadata-cropdetect
+fate-filter-metadata-cropdetect: CMD = run $(FILTER_METADATA_COMMAND) -threads 1 "$(CROPDETECT_SRC),cropdetect=round=2"
+
+FATE_CROPDETECT += fate-filter-metadata-cropdetect-threads
+fate-filter-metadata-cropdetect-threads: CMD = run $(FILTER_METADATA_COMMAND) -threads 4 "$(CROPDETECT_SRC),cropdetect=round=2"
+fate-filter-metadata-cropdetect-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-metadata-cropdetect
+
+FATE_CROPDETECT += fate-filter-metadata-cropdetect-frame_step
+fate-filter-metadata-cropdetect-frame_step: CMD = run $(FILTER_METADATA_COMMAND) -threads 1 "$(CROPDETECT_SRC),cropdetect=round=2:frame_step=3"
+
+FATE_CROPDETECT += fate-filter-metadata-cropdetect-sample_step
+fate-filter-metadata-cropdetect-sample_step: CMD = run $(FILTER_METADATA_COMMAND) -threads 1 "$(CROPDETECT_SRC),cropdetect=round=2:sample_step=8"
+
+FATE_CROPDETECT += fate-filter-metadata-cropdetect-sample_step-threads
+fate-filter-metadata-cropdetect-sample_step-threads: CMD = run $(FILTER_METADATA_COMMAND) -threads 4 "$(CROPDETECT_SRC),cropdetect=round=2:sample_step=8"
+fate-filter-metadata-cropdetect-sample_step-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-metadata-cropdetect-sample_step
+
+FATE_FILTER_FFPROBE-$(call ALLYES, $(CROPDETECT_DEPS)) += $(FATE_CROPDETECT)
+FATE_FFPROBE += $(FATE_FILTER_FFPROBE-yes)
+
 fate-vfilter: $(FATE_FILTER-yes) $(FATE_FILTER_VSYNTH-yes)
 
-fate-filter: fate-afilter fate-vfilter $(FATE_METADATA_FILTER-yes)
+fate-filter: fate-afilter fate-vfilter $(FATE_METADATA_FILTER-yes) $(FATE_FILTER_FFPROBE-yes)
@@ -1,3 +1,11 @@
+FATE_LIBAVFORMAT-$(CONFIG_CACHE_PROTOCOL) += fate-cache-shared
+fate-cache-shared: libavformat/cache-test$(EXESUF)
+fate-cache-shared: CMD = run libavformat/cache-test $(TARGET_PATH)/tests/data/fate/cache-shared.d
+
+FATE_LIBAVFORMAT-$(HAVE_MMAP) += fate-file-mmap
+fate-file-mmap: libavformat/file-test$(EXESUF)
+fate-file-mmap: CMD = run libavformat/file-test $(TARGET_PATH)/tests/data/fate/file-mmap.dat
+
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/noproxy-test$(EXESUF)
 fate-noproxy: CMD = run libavformat/noproxy-test
@@ -139,6 +139,7 @@ FATE_MPEG2 = mpeg2                                                      \
              mpeg2-ilace                                                \
              mpeg2-ivlc-qprd                                            \
              mpeg2-thread                                               \
+             mpeg2-thread-dec                                           \
              mpeg2-thread-ivlc
 
 FATE_VCODEC-$(call ENCDEC, MPEG2VIDEO, MPEG2VIDEO MPEGVIDEO) += $(FATE_MPEG2)
@@ -170,6 +171,12 @@ fate-vsynth%-mpeg2-thread:       ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
 fate-vsynth%-mpeg2-thread-ivlc:  ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
                                            -intra_vlc 1 -threads 2 -slices 2
 
+# same stream as mpeg2-thread, decoded with frame threads
+fate-vsynth%-mpeg2-thread-dec:   ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
+                                           -threads 2 -slices 2
+fate-vsynth%-mpeg2-thread-dec:   THREADS = 4
+fate-vsynth%-mpeg2-thread-dec:   THREAD_TYPE = frame
+
 FATE_MPEG4_MP4 = mpeg4
 FATE_MPEG4_AVI = mpeg4-rc                                               \
                  mpeg4-adv                                              \
@@ -117,6 +117,9 @@ fi
 if [ -n "$do_mov" ] ; then
 mov_common_opt="-acodec pcm_alaw -vcodec mpeg4 -threads 1"
 do_lavf mov "" "-movflags +rtphint $mov_common_opt"
+do_lavf mov "" "-movflags +faststart -expected_duration 1 $mov_common_opt"
+do_lavf mov "" "-movflags +faststart -moov_size 1024 $mov_common_opt"
+do_lavf mov "" "-movflags +cmaf+separate_moof $mov_common_opt"
 do_lavf_timecode mov "-movflags +faststart $mov_common_opt"
 fi
 
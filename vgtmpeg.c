@@ -452,6 +452,7 @@ static void ffmpeg_cleanup(int ret)
 
     /* write the trailers if not yet written */
     for(i=0;i<nb_output_files;i++) {
+        nl_mux_thread_stop(output_files[i]);
         if( output_files[i]->wrote_header && !(output_files[i]->wrote_trailer) ) {
             av_write_trailer(output_files[i]->ctx);
         }
@@ -750,6 +751,18 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
               );
     }
 
+    /* --vgtmpeg */
+    if (output_files[ost->file_index]->mux_thread) {
+        /* the muxing thread reports its errors itself */
+        ret = nl_mux_thread_write(output_files[ost->file_index], pkt);
+        if (ret < 0) {
+            main_return_code = 1;
+            close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
+        }
+        return;
+    }
+    /* --vgtmpeg */
+
     ret = av_interleaved_write_frame(s, pkt);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
@@ -991,6 +1004,17 @@ static void output_nlpicmsg(AVFrame *pic) {
 }
 /*-- vgtmpeg */
 
+/* --vgtmpeg: the muxer belongs to the muxing thread when there is one */
+static void set_field_order(OutputStream *ost, enum AVFieldOrder field_order)
+{
+    OutputFile *of = output_files[ost->file_index];
+
+    if (of->mux_thread)
+        nl_mux_thread_set_field_order(of, ost->index, field_order);
+    else
+        ost->st->codec->field_order = field_order;
+}
+
 static void do_video_out(AVFormatContext *s,
                          OutputStream *ost,
                          AVFrame *next_picture,
@@ -1162,11 +1186,11 @@ static void do_video_out(AVFormatContext *s,
 
         if (in_picture->interlaced_frame) {
             if (enc->codec->id == AV_CODEC_ID_MJPEG)
-                mux_enc->field_order = in_picture->top_field_first ? AV_FIELD_TT:AV_FIELD_BB;
+                set_field_order(ost, in_picture->top_field_first ? AV_FIELD_TT:AV_FIELD_BB);
             else
-                mux_enc->field_order = in_picture->top_field_first ? AV_FIELD_TB:AV_FIELD_BT;
+                set_field_order(ost, in_picture->top_field_first ? AV_FIELD_TB:AV_FIELD_BT);
         } else
-            mux_enc->field_order = AV_FIELD_PROGRESSIVE;
+            set_field_order(ost, AV_FIELD_PROGRESSIVE);
 
         in_picture->quality = enc->global_quality;
         in_picture->pict_type = 0;
@@ -1296,14 +1320,14 @@ static void do_video_stats(OutputStream *ost, int frame_size)
 
     enc = ost->enc_ctx;
     if (enc->codec_type == AVMEDIA_TYPE_VIDEO) {
-        frame_number = ost->st->nb_frames;
+        frame_number = nl_mux_nb_frames(output_files[ost->file_index], ost->index);
         fprintf(vstats_file, "frame= %5d q= %2.1f ", frame_number, enc->coded_frame ? enc->coded_frame->quality / (float)FF_QP2LAMBDA : 0);
         if (enc->coded_frame && (enc->flags&CODEC_FLAG_PSNR))
             fprintf(vstats_file, "PSNR= %6.2f ", psnr(enc->coded_frame->error[0] / (enc->width * enc->height * 255.0 * 255.0)));
 
         fprintf(vstats_file,"f_size= %6d ", frame_size);
         /* compute pts value */
-        ti1 = av_stream_get_end_pts(ost->st) * av_q2d(ost->st->time_base);
+        ti1 = nl_mux_end_pts(output_files[ost->file_index], ost->index) * av_q2d(ost->st->time_base);
         if (ti1 < 0.01)
             ti1 = 0.01;
 
@@ -1544,7 +1568,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     AVCodecContext *enc;
     int frame_number, vid, i;
     double bitrate;
-    int64_t pts = INT64_MIN;
+    int64_t pts = INT64_MIN, end_pts;
     static int64_t last_time = -1;
     static int qp_histogram[52];
     int hours, mins, secs, us;
@@ -1571,9 +1595,15 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 
     oc = output_files[0]->ctx;
 
+    /* --vgtmpeg */
+    if (output_files[0]->mux_thread) {
+        total_size = nl_mux_thread_size(output_files[0]);
+    } else {
+    /* --vgtmpeg */
     total_size = avio_size(oc->pb);
     if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
         total_size = avio_tell(oc->pb);
+    }
 
     buf[0] = '\0';
     vid = 0;
@@ -1642,9 +1672,11 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
             vid = 1;
         }
         /* compute min output value */
-        if (av_stream_get_end_pts(ost->st) != AV_NOPTS_VALUE)
-            pts = FFMAX(pts, av_rescale_q(av_stream_get_end_pts(ost->st),
-                                          ost->st->time_base, AV_TIME_BASE_Q));
+        /* --vgtmpeg */
+        end_pts = nl_mux_end_pts(output_files[ost->file_index], ost->index);
+        if (end_pts != AV_NOPTS_VALUE)
+            pts = FFMAX(pts, av_rescale_q(end_pts, ost->st->time_base, AV_TIME_BASE_Q));
+        /* --vgtmpeg */
         if (is_last_report)
             nb_frames_drop += ost->last_droped;
     }
@@ -3343,8 +3375,9 @@ static int need_output(void)
         OutputFile *of       = output_files[ost->file_index];
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
 
+        /* --vgtmpeg: the pb belongs to the muxing thread when there is one */
         if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+            (os->pb && (of->mux_thread ? nl_mux_thread_size(of) : avio_tell(os->pb)) >= of->limit_filesize))
             continue;
         if (ost->frame_number >= ost->max_frames) {
             int j;
@@ -3372,8 +3405,8 @@ static OutputStream *choose_output(void)
 
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost = output_streams[i];
-        int64_t opts = av_rescale_q(ost->st->cur_dts, ost->st->time_base,
-                                    AV_TIME_BASE_Q);
+        int64_t opts = av_rescale_q(nl_mux_cur_dts(output_files[ost->file_index], ost->index),
+                                    ost->st->time_base, AV_TIME_BASE_Q);
         if (!ost->finished && opts < opts_min) {
             opts_min = opts;
             ost_min  = ost->unavailable ? NULL : ost;
@@ -3480,6 +3513,8 @@ static int check_keyboard_interaction(int64_t cur_time)
 }
 
 #if HAVE_PTHREADS
+#define INPUT_QUEUE_GROWTH 16 /* --vgtmpeg: how much a full input queue may grow */
+
 static void *input_thread(void *arg)
 {
     InputFile *f = arg;
@@ -3495,26 +3530,32 @@ static void *input_thread(void *arg)
             continue;
         }
         if (ret < 0) {
-            av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
+            nl_pktqueue_set_err_recv(f->in_pkt_queue, ret);
             break;
         }
         av_dup_packet(&pkt);
-        ret = av_thread_message_queue_send(f->in_thread_queue, &pkt, flags);
+        /* --vgtmpeg */
+        /* the queue grows when full up to INPUT_QUEUE_GROWTH times
+         * thread_queue_size before blocking */
+        ret = nl_pktqueue_send(f->in_pkt_queue, &pkt, flags);
         if (flags && ret == AVERROR(EAGAIN)) {
             flags = 0;
-            ret = av_thread_message_queue_send(f->in_thread_queue, &pkt, flags);
+            ret = nl_pktqueue_send(f->in_pkt_queue, &pkt, flags);
             av_log(f->ctx, AV_LOG_WARNING,
-                   "Thread message queue blocking; consider raising the "
-                   "thread_queue_size option (current value: %d)\n",
-                   f->thread_queue_size);
+                   "Input packet queue full at %d packets, blocking; consider "
+                   "raising the thread_queue_size option (current value: %d, "
+                   "the queue grows up to %d times that)\n",
+                   f->thread_queue_size * INPUT_QUEUE_GROWTH,
+                   f->thread_queue_size, INPUT_QUEUE_GROWTH);
         }
+        /* --vgtmpeg */
         if (ret < 0) {
             if (ret != AVERROR_EOF)
                 av_log(f->ctx, AV_LOG_ERROR,
                        "Unable to send packet to main thread: %s\n",
                        av_err2str(ret));
             av_free_packet(&pkt);
-            av_thread_message_queue_set_err_recv(f->in_thread_queue, ret);
+            nl_pktqueue_set_err_recv(f->in_pkt_queue, ret);
             break;
         }
     }
@@ -3528,17 +3569,23 @@ static void free_input_threads(void)
 
     for (i = 0; i < nb_input_files; i++) {
         InputFile *f = input_files[i];
+        NLPacketQueueStats stats;
         AVPacket pkt;
 
-        if (!f->in_thread_queue)
+        if (!f->in_pkt_queue)
             continue;
-        av_thread_message_queue_set_err_send(f->in_thread_queue, AVERROR_EOF);
-        while (av_thread_message_queue_recv(f->in_thread_queue, &pkt, 0) >= 0)
+        nl_pktqueue_set_err_send(f->in_pkt_queue, AVERROR_EOF);
+        while (nl_pktqueue_recv(f->in_pkt_queue, &pkt, 0) >= 0)
             av_free_packet(&pkt);
 
         pthread_join(f->thread, NULL);
         f->joined = 1;
-        av_thread_message_queue_free(&f->in_thread_queue);
+        nl_pktqueue_get_stats(f->in_pkt_queue, &stats);
+        av_log(f->ctx, AV_LOG_VERBOSE, "Input queue: %d packets, size %d "
+               "(%d grows, max fill %d), %d wakeups, %d send waits, %d receive waits\n",
+               stats.nb_packets, stats.size, stats.nb_grows, stats.max_fill,
+               stats.nb_wakeups, stats.nb_send_waits, stats.nb_recv_waits);
+        nl_pktqueue_free(&f->in_pkt_queue);
     }
 }
 
@@ -3583,14 +3630,14 @@ static int init_input_threads(void)
         if (f->ctx->pb ? !f->ctx->pb->seekable :
             strcmp(f->ctx->iformat->name, "lavfi"))
             f->non_blocking = 1;
-        ret = av_thread_message_queue_alloc(&f->in_thread_queue,
-                                            f->thread_queue_size, sizeof(AVPacket));
+        ret = nl_pktqueue_alloc(&f->in_pkt_queue, f->thread_queue_size,
+                                f->thread_queue_size * INPUT_QUEUE_GROWTH);
         if (ret < 0)
             return ret;
 
         if ((ret = pthread_create(&f->thread, NULL, input_thread, f))) {
             av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
-            av_thread_message_queue_free(&f->in_thread_queue);
+            nl_pktqueue_free(&f->in_pkt_queue);
             return AVERROR(ret);
         }
     }
@@ -3599,9 +3646,9 @@ static int init_input_threads(void)
 
 static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
 {
-    return av_thread_message_queue_recv(f->in_thread_queue, pkt,
-                                        f->non_blocking ?
-                                        AV_THREAD_MESSAGE_NONBLOCK : 0);
+    return nl_pktqueue_recv(f->in_pkt_queue, pkt,
+                            f->non_blocking ?
+                            AV_THREAD_MESSAGE_NONBLOCK : 0);
 }
 #endif
 
@@ -3991,6 +4038,13 @@ static int transcode(void)
         goto fail;
 #endif
 
+    /* --vgtmpeg */
+    if (mux_queue_size > 0)
+        for (i = 0; i < nb_output_files; i++)
+            if ((ret = nl_mux_thread_start(output_files[i], mux_queue_size)) < 0)
+                goto fail;
+    /* --vgtmpeg */
+
     /* --vgtmpeg start */
     while (!received_sigterm && (!nli || (!nli->exit && !nli->cancel_transcode ))) {
     /* --vgtmpeg end */
@@ -4035,6 +4089,13 @@ static int transcode(void)
 
     term_exit();
 
+    /* --vgtmpeg */
+    /* the trailers are written from this thread */
+    for (i = 0; i < nb_output_files; i++)
+        if (nl_mux_thread_stop(output_files[i]) < 0)
+            main_return_code = 1;
+    /* --vgtmpeg */
+
     /* write the trailer if needed and close file */
     for (i = 0; i < nb_output_files; i++) {
         os = output_files[i]->ctx;
@@ -4072,6 +4133,10 @@ static int transcode(void)
 #if HAVE_PTHREADS
     free_input_threads();
 #endif
+    /* --vgtmpeg */
+    for (i = 0; i < nb_output_files; i++)
+        nl_mux_thread_stop(output_files[i]);
+    /* --vgtmpeg */
 
     if (output_streams) {
         for (i = 0; i < nb_output_streams; i++) {
@@ -4147,6 +4212,9 @@ int main(int argc, char **argv)
     av_log_set_flags(AV_LOG_SKIP_REPEATED);
     parse_loglevel(argc, argv, options);
 
+    /* --vgtmpeg */
+    program_path = argv[0];
+    /* --vgtmpeg */
     if(argc>1 && !strcmp(argv[1], "-d")){
         run_as_daemon=1;
         av_log_set_callback(log_callback_null);
@@ -4179,6 +4247,9 @@ int main(int argc, char **argv)
         run_as_daemon = 1;
     }
 
+    /* the output was already written by the segment encoders */
+    if (parallel_segments > 1)
+        exit_program(0);
     /* --vgtmpeg */
 
 
@@ -4188,6 +4259,12 @@ int main(int argc, char **argv)
         exit_program(1);
     }
 
+    /* --vgtmpeg */
+    /* the analysis is reported while opening the inputs */
+    if (nb_output_files <= 0 && analyze_samples > 0)
+        exit_program(0);
+    /* --vgtmpeg */
+
     /* file converter / grab */
     if (nb_output_files <= 0) {
         av_log(NULL, AV_LOG_FATAL, "At least one output file must be specified\n");
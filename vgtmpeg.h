@@ -29,6 +29,10 @@
 #include "nlinput.h"
 #include "nldump_format.h"
 #include "nlreport.h"
+#include "nlanalyze.h"
+#include "nlsegments.h"
+#include "nlpktqueue.h"
+#include "nlmuxthread.h"
 
 /* optical media public functions */
 #include "libavformat/optmedia.h"
@@ -36,6 +40,10 @@ extern int output_xml;
 extern int server_mode;
 extern int banner;
 extern int default_program_id;
+extern int analyze_samples;
+extern int parallel_segments;
+extern const char *program_path;   /* argv[0], before -d is removed */
+extern int mux_queue_size;
 
 /* running options */
 
@@ -4,4 +4,7 @@
     { "formats_json", OPT_EXIT, {(void*)&show_formats_json}, "show formats  in json format" },
     { "options_json", OPT_EXIT, {(void*)&show_options_json}, "show options in json format" },
     { "banner", OPT_BOOL, {(void*)&banner}, "shows vgtmpeg banner" },
+    { "analyze", HAS_ARG | OPT_INT, {(void*)&analyze_samples}, "report crop and interlacing of each input sampled at this many positions", "count" },
+    { "parallel_segments", HAS_ARG | OPT_INT, {(void*)&parallel_segments}, "encode the input split at keyframes in this many segments concurrently", "count" },
+    { "mux_queue_size", HAS_ARG | OPT_INT, {(void*)&mux_queue_size}, "mux each output file from its own thread through a queue of this many packets", "count" },
 
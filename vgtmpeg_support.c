@@ -29,10 +29,31 @@
 #include "nlinput.h"
 #include "nlreport.h"
 #include "nldump_format.h"
+#include "nlanalyze.h"
+#include "nlsegments.h"
+#include "nlpktqueue.h"
+#include "nlmuxthread.h"
+#include "vgtmpeg.h"
 #include "libavcodec/avcodec.h"
 #include "libavformat/avformat.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+#include "libavutil/atomic.h"
+#include "libavutil/avstring.h"
+#include "libavutil/cpu.h"
+#include "libavutil/time.h"
 #include "cmdutils.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+#if HAVE_FORK
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 
 
 /****************************************************************/
@@ -952,6 +973,1382 @@ void dump_nlformat(AVFormatContext *ic,
 
 
 
+/****************************************************************/
+/* nlanalyze                                                    */
+/****************************************************************/
+#define ANALYZE_RUN_FRAMES   8     /* consecutive frames decoded at each position */
+#define ANALYZE_MAX_PACKETS  2048  /* give up on a position after this many packets */
+
+typedef struct {
+    AVFilterGraph *graph;
+    AVFilterContext *src;
+    AVFilterContext *sink;
+    AVRational time_base;
+
+    int nb_frames;
+    int nb_flag_interlaced;     /* frames the decoder flagged as interlaced */
+    int nb_flag_repeat;         /* frames with repeat_pict set (soft telecine) */
+    int nb_tff, nb_bff, nb_progressive, nb_undetermined;
+    int nb_repeat_top, nb_repeat_bottom;
+    int x1, y1, x2, y2;         /* union of the non black areas of all the runs */
+} nlanalysis_t;
+
+static int analyze_graph_init(nlanalysis_t *a, AVFrame *frame)
+{
+    char args[256];
+    AVFilterContext *idet, *crop;
+    int ret;
+
+    avfilter_graph_free(&a->graph);
+    a->graph = avfilter_graph_alloc();
+    if (!a->graph)
+        return AVERROR(ENOMEM);
+
+    snprintf(args, sizeof(args), "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
+             frame->width, frame->height, frame->format,
+             a->time_base.num, a->time_base.den,
+             frame->sample_aspect_ratio.num, FFMAX(frame->sample_aspect_ratio.den, 1));
+
+    if ((ret = avfilter_graph_create_filter(&a->src, avfilter_get_by_name("buffer"),
+                                            "in", args, NULL, a->graph)) < 0 ||
+        (ret = avfilter_graph_create_filter(&idet, avfilter_get_by_name("idet"),
+                                            "idet", NULL, NULL, a->graph)) < 0 ||
+        (ret = avfilter_graph_create_filter(&crop, avfilter_get_by_name("cropdetect"),
+                                            "cropdetect", "round=2", NULL, a->graph)) < 0 ||
+        (ret = avfilter_graph_create_filter(&a->sink, avfilter_get_by_name("buffersink"),
+                                            "out", NULL, NULL, a->graph)) < 0)
+        return ret;
+
+    if ((ret = avfilter_link(a->src, 0, idet, 0)) < 0 ||
+        (ret = avfilter_link(idet, 0, crop, 0)) < 0 ||
+        (ret = avfilter_link(crop, 0, a->sink, 0)) < 0)
+        return ret;
+
+    return avfilter_graph_config(a->graph, NULL);
+}
+
+static int analyze_dict_int(AVDictionary *m, const char *key, int def)
+{
+    AVDictionaryEntry *e = av_dict_get(m, key, NULL, 0);
+    return e ? atoi(e->value) : def;
+}
+
+/* collect the per frame results of idet and cropdetect. cropdetect keeps
+ * growing its area during a run, so the last frame holds the run extents */
+static int analyze_graph_drain(nlanalysis_t *a, AVFrame *frame)
+{
+    int ret, x1 = INT_MAX, y1 = INT_MAX, x2 = -1, y2 = -1;
+
+    while ((ret = av_buffersink_get_frame(a->sink, frame)) >= 0) {
+        AVDictionary *m = av_frame_get_metadata(frame);
+        AVDictionaryEntry *e;
+
+        if ((e = av_dict_get(m, "lavfi.idet.single.current_frame", NULL, 0))) {
+            if      (!strcmp(e->value, "tff"))         a->nb_tff++;
+            else if (!strcmp(e->value, "bff"))         a->nb_bff++;
+            else if (!strcmp(e->value, "progressive")) a->nb_progressive++;
+            else                                       a->nb_undetermined++;
+        }
+        if ((e = av_dict_get(m, "lavfi.idet.repeated.current_frame", NULL, 0))) {
+            if      (!strcmp(e->value, "top"))         a->nb_repeat_top++;
+            else if (!strcmp(e->value, "bottom"))      a->nb_repeat_bottom++;
+        }
+        if (av_dict_get(m, "lavfi.cropdetect.x1", NULL, 0)) {
+            x1 = analyze_dict_int(m, "lavfi.cropdetect.x1", x1);
+            y1 = analyze_dict_int(m, "lavfi.cropdetect.y1", y1);
+            x2 = analyze_dict_int(m, "lavfi.cropdetect.x2", x2);
+            y2 = analyze_dict_int(m, "lavfi.cropdetect.y2", y2);
+        }
+        av_frame_unref(frame);
+    }
+
+    if (x1 <= x2 && y1 <= y2) {
+        a->x1 = FFMIN(a->x1, x1);
+        a->y1 = FFMIN(a->y1, y1);
+        a->x2 = FFMAX(a->x2, x2);
+        a->y2 = FFMAX(a->y2, y2);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+/* seek to pos and run the frames decoded from the next keyframe on
+ * through idet and cropdetect */
+static int analyze_position(nlanalysis_t *a, AVFormatContext *ic, AVCodecContext *dec,
+                            int stream_index, int64_t pos)
+{
+    AVFrame *frame;
+    AVPacket pkt;
+    int ret = 0, got_frame, nb_packets = 0, nb_decoded = 0;
+
+    if ((ret = av_seek_frame(ic, -1, pos, AVSEEK_FLAG_BYTE)) < 0)
+        return ret;
+    avcodec_flush_buffers(dec);
+    avfilter_graph_free(&a->graph);
+
+    frame = av_frame_alloc();
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    /* only decode keyframes until the first picture comes out */
+    dec->skip_frame = AVDISCARD_NONKEY;
+
+    while (nb_decoded < ANALYZE_RUN_FRAMES && nb_packets++ < ANALYZE_MAX_PACKETS) {
+        if ((ret = av_read_frame(ic, &pkt)) < 0)
+            break;
+        if (pkt.stream_index != stream_index) {
+            av_free_packet(&pkt);
+            continue;
+        }
+        ret = avcodec_decode_video2(dec, frame, &got_frame, &pkt);
+        av_free_packet(&pkt);
+        if (ret < 0 || !got_frame) {
+            ret = 0;
+            continue;
+        }
+
+        dec->skip_frame = AVDISCARD_DEFAULT;
+        nb_decoded++;
+        a->nb_frames++;
+        a->nb_flag_interlaced += frame->interlaced_frame;
+        a->nb_flag_repeat     += frame->repeat_pict > 0;
+
+        if (!a->graph && (ret = analyze_graph_init(a, frame)) < 0)
+            break;
+        ret = av_buffersrc_add_frame_flags(a->src, frame, 0);
+        av_frame_unref(frame);
+        if (ret < 0)
+            break;
+    }
+
+    if (a->graph) {
+        av_buffersrc_add_frame_flags(a->src, NULL, 0);
+        ret = analyze_graph_drain(a, frame);
+    }
+
+    av_frame_free(&frame);
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+int nl_analyze_input(const char *filename, AVInputFormat *fmt,
+                     AVDictionary *format_opts, int index, int nb_samples)
+{
+    AVFormatContext *ic = NULL;
+    AVCodecContext *dec = NULL;
+    AVCodec *codec = NULL;
+    AVDictionary *opts = NULL;
+    nlanalysis_t a = { 0 };
+    int64_t size, start_time;
+    int i, ret, stream_index, log_level, w, h, x, y;
+    int interlaced, telecine;
+    const char *scan, *field_order, *telecine_str, *filter;
+    char crop[64];
+
+    av_dict_copy(&opts, format_opts, 0);
+    ret = avformat_open_input(&ic, filename, fmt, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        goto end;
+    if ((ret = avformat_find_stream_info(ic, NULL)) < 0)
+        goto end;
+
+    ret = stream_index = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (ret < 0)
+        goto end;
+
+    size = avio_size(ic->pb);
+    if (size <= 0 || !ic->pb->seekable || (ic->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+        ret = AVERROR(ENOSYS);
+        goto end;
+    }
+
+    dec = avcodec_alloc_context3(codec);
+    if (!dec) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = avcodec_copy_context(dec, ic->streams[stream_index]->codec)) < 0 ||
+        (ret = avcodec_open2(dec, codec, NULL)) < 0)
+        goto end;
+
+    a.time_base = ic->streams[stream_index]->time_base;
+    a.x1 = a.y1 = INT_MAX;
+    a.x2 = a.y2 = -1;
+
+    /* keep the per frame logging of the analysis filters quiet */
+    log_level = av_log_get_level();
+    if (log_level < AV_LOG_VERBOSE)
+        av_log_set_level(AV_LOG_WARNING);
+
+    start_time = av_gettime();
+    for (i = 0; i < nb_samples; i++) {
+        /* the middle of each of nb_samples equal parts of the input */
+        int64_t pos = av_rescale(size, 2 * i + 1, 2 * nb_samples);
+        if ((ret = analyze_position(&a, ic, dec, stream_index, pos)) < 0)
+            break;
+    }
+    avfilter_graph_free(&a.graph);
+
+    av_log_set_level(log_level);
+    if (ret < 0)
+        goto end;
+
+    /* crop, rounded inwards to even values */
+    w = dec->width;
+    h = dec->height;
+    if (a.x1 <= a.x2 && a.y1 <= a.y2) {
+        x = (a.x1 + 1) & ~1;
+        y = (a.y1 + 1) & ~1;
+        w = (a.x2 - x + 1) & ~1;
+        h = (a.y2 - y + 1) & ~1;
+    } else {
+        x = y = 0;
+    }
+    snprintf(crop, sizeof(crop), "%d:%d:%d:%d", w, h, x, y);
+
+    /* a repeated field every few frames means 3:2 pulldown. with the
+     * repeat flags set by the decoder it only needs honoring the flags,
+     * with the fields actually repeated it needs field matching */
+    telecine = 0;
+    if (a.nb_flag_repeat * 5 >= a.nb_frames && a.nb_flag_repeat)
+        telecine = 1;
+    else if ((a.nb_repeat_top + a.nb_repeat_bottom) * 5 >= a.nb_frames && a.nb_frames)
+        telecine = 2;
+
+    interlaced  = a.nb_tff + a.nb_bff > a.nb_progressive;
+    scan        = telecine == 2 ? "telecined" : interlaced ? "interlaced" : "progressive";
+    field_order = !interlaced && telecine != 2 ? "progressive" : a.nb_tff >= a.nb_bff ? "tff" : "bff";
+    telecine_str = telecine == 1 ? "soft" : telecine == 2 ? "hard" : "none";
+    filter      = telecine == 2 ? "fieldmatch,decimate" : interlaced ? "bwdif=mode=send_frame" : "";
+
+    av_log(NULL, AV_LOG_INFO,
+           "Analysis of input #%d: %d frames at %d positions in %0.2fs, crop=%s scan:%s field_order:%s "
+           "telecine:%s (single frame tff:%d bff:%d progressive:%d undetermined:%d, "
+           "repeated fields top:%d bottom:%d, flagged interlaced:%d repeat:%d)\n",
+           index, a.nb_frames, nb_samples, (av_gettime() - start_time) / 1000000.0,
+           crop, scan, field_order, telecine_str,
+           a.nb_tff, a.nb_bff, a.nb_progressive, a.nb_undetermined,
+           a.nb_repeat_top, a.nb_repeat_bottom, a.nb_flag_interlaced, a.nb_flag_repeat);
+
+    if( output_xml ) {
+        FFMSG_START_MSGTYPE( FFMSG_MSGTYPE_ANALYSISINFO, analysis );
+        FFMSG_LOG( FFMSG_INT32_FMT(index), index );
+        FFMSG_LOG( FFMSG_INT32_FMT(positions), nb_samples );
+        FFMSG_LOG( FFMSG_INT32_FMT(frames), a.nb_frames );
+        FFMSG_LOG( FFMSG_INT32_FMT(crop_w), w );
+        FFMSG_LOG( FFMSG_INT32_FMT(crop_h), h );
+        FFMSG_LOG( FFMSG_INT32_FMT(crop_x), x );
+        FFMSG_LOG( FFMSG_INT32_FMT(crop_y), y );
+        FFMSG_LOG( FFMSG_STRING_FMT(crop), crop );
+        FFMSG_LOG( FFMSG_STRING_FMT(scan), scan );
+        FFMSG_LOG( FFMSG_STRING_FMT(field_order), field_order );
+        FFMSG_LOG( FFMSG_STRING_FMT(telecine), telecine_str );
+        FFMSG_LOG( FFMSG_STRING_FMT(filter), filter );
+        FFMSG_LOG( FFMSG_INT32_FMT(idet_tff), a.nb_tff );
+        FFMSG_LOG( FFMSG_INT32_FMT(idet_bff), a.nb_bff );
+        FFMSG_LOG( FFMSG_INT32_FMT(idet_progressive), a.nb_progressive );
+        FFMSG_LOG( FFMSG_INT32_FMT(idet_undetermined), a.nb_undetermined );
+        FFMSG_LOG( FFMSG_INT32_FMT(idet_repeated_top), a.nb_repeat_top );
+        FFMSG_LOG( FFMSG_INT32_FMT(idet_repeated_bottom), a.nb_repeat_bottom );
+        FFMSG_LOG( FFMSG_INT32_FMT(flagged_interlaced), a.nb_flag_interlaced );
+        FFMSG_LOG( FFMSG_INT32_FMT(flagged_repeat), a.nb_flag_repeat );
+        FFMSG_STOP_MSGTYPE( FFMSG_MSGTYPE_ANALYSISINFO, analysis );
+    }
+
+end:
+    if (ret < 0)
+        av_log(NULL, AV_LOG_WARNING, "%s: could not analyze input: %s\n",
+               filename, av_err2str(ret));
+    avcodec_free_context(&dec);
+    avformat_close_input(&ic);
+    return ret;
+}
+
+
+
+/****************************************************************/
+/* nlsegments                                                   */
+/****************************************************************/
+#define SEGMENTS_MAX_SCAN_PACKETS 20000 /* packets read looking for a keyframe */
+#define SEGMENTS_MAX_SEEK_TRIES   8     /* frames stepped back to seek on a keyframe */
+
+/* the timestamp of the first video keyframe read after seeking to ts, the
+ * way -ss seeks */
+static int64_t segments_seek_keyframe(AVFormatContext *ic, int stream_index, int64_t ts)
+{
+    AVStream *st = ic->streams[stream_index];
+    AVPacket pkt;
+    int64_t kf = AV_NOPTS_VALUE;
+    int i;
+
+    if (avformat_seek_file(ic, -1, INT64_MIN, ts, ts, 0) < 0)
+        return AV_NOPTS_VALUE;
+    for (i = 0; i < SEGMENTS_MAX_SCAN_PACKETS && kf == AV_NOPTS_VALUE; i++) {
+        if (av_read_frame(ic, &pkt) < 0)
+            break;
+        if (pkt.stream_index == stream_index && pkt.flags & AV_PKT_FLAG_KEY)
+            kf = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : pkt.dts;
+        av_free_packet(&pkt);
+    }
+    return kf == AV_NOPTS_VALUE ? kf : av_rescale_q(kf, st->time_base, AV_TIME_BASE_Q);
+}
+
+/* the start of a stream, from its first packet. st->start_time can't be
+ * used, lavf sets it to the start of the file when the demuxer doesn't know
+ * it. must be called before anything else is read */
+static int64_t segments_stream_start(AVFormatContext *ic, int stream_index)
+{
+    AVStream *st = ic->streams[stream_index];
+    AVPacket pkt;
+    int64_t ts = AV_NOPTS_VALUE;
+    int i;
+
+    for (i = 0; i < SEGMENTS_MAX_SCAN_PACKETS && ts == AV_NOPTS_VALUE; i++) {
+        if (av_read_frame(ic, &pkt) < 0)
+            break;
+        if (pkt.stream_index == stream_index)
+            ts = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : pkt.dts;
+        av_free_packet(&pkt);
+    }
+    return ts == AV_NOPTS_VALUE ? ts : av_rescale_q(ts, st->time_base, AV_TIME_BASE_Q);
+}
+
+/* the segment start times relative to the input start, at the video keyframes
+ * found from nb_segments evenly spaced positions, and the times to seek to so
+ * the decoding of each segment starts at its keyframe. returns the number of
+ * segments */
+static int segments_split(const char *filename, AVInputFormat *fmt,
+                          AVDictionary *format_opts, int nb_segments,
+                          int64_t *starts, int64_t *seeks)
+{
+    AVFormatContext *ic = NULL;
+    AVDictionary *opts = NULL;
+    AVStream *st;
+    int64_t start_time, video_start, step;
+    int i, j, ret, stream_index, n = 1;
+
+    av_dict_copy(&opts, format_opts, 0);
+    ret = avformat_open_input(&ic, filename, fmt, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        goto end;
+    if ((ret = avformat_find_stream_info(ic, NULL)) < 0)
+        goto end;
+
+    ret = stream_index = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (ret < 0)
+        goto end;
+    if (!ic->pb || !ic->pb->seekable || ic->duration <= 0) {
+        ret = AVERROR(ENOSYS);
+        goto end;
+    }
+    st         = ic->streams[stream_index];
+    start_time = ic->start_time == AV_NOPTS_VALUE ? 0 : ic->start_time;
+    step       = st->avg_frame_rate.num && st->avg_frame_rate.den ?
+                 av_rescale_q(1, av_inv_q(st->avg_frame_rate), AV_TIME_BASE_Q) :
+                 AV_TIME_BASE / 25;
+
+    /* the first segment isn't seeked, its -t counts from the first frame */
+    starts[0] = seeks[0] = 0;
+    video_start = segments_stream_start(ic, stream_index);
+    if (video_start != AV_NOPTS_VALUE)
+        starts[0] = FFMAX(video_start - start_time, 0);
+    for (i = 1; i < nb_segments; i++) {
+        int64_t ts = segments_seek_keyframe(ic, stream_index,
+                                            start_time + av_rescale(ic->duration, i, nb_segments));
+        int64_t seek = ts;
+
+        if (ts == AV_NOPTS_VALUE || ts - start_time <= starts[n - 1])
+            continue;
+        /* demuxers seeking on dts can land on the next keyframe when asked
+         * for the pts of this one, so step back until they don't. seeking
+         * earlier than the keyframe must land on it exactly, or the frames
+         * in between would be encoded twice */
+        for (j = 0; j < SEGMENTS_MAX_SEEK_TRIES; j++) {
+            int64_t kf = segments_seek_keyframe(ic, stream_index, seek);
+            if (kf == ts || (kf < ts && seek == ts))
+                break;
+            seek = ts - (j + 1) * step;
+        }
+        if (j == SEGMENTS_MAX_SEEK_TRIES || seek - start_time <= starts[n - 1])
+            continue;
+        starts[n] = ts   - start_time;
+        seeks[n]  = seek - start_time;
+        n++;
+    }
+    ret = n;
+
+end:
+    avformat_close_input(&ic);
+    return ret;
+}
+
+/* remux the segments listed in an ffconcat file into the output */
+static int segments_concat(const char *list, const char *filename,
+                           const char *format, AVDictionary *format_opts)
+{
+    AVFormatContext *ic = NULL, *oc = NULL;
+    AVDictionary *opts = NULL;
+    AVPacket pkt;
+    int64_t *last_dts = NULL;
+    int i, ret;
+
+    av_dict_set(&opts, "safe", "0", 0);
+    ret = avformat_open_input(&ic, list, av_find_input_format("concat"), &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        goto end;
+    if ((ret = avformat_find_stream_info(ic, NULL)) < 0)
+        goto end;
+    if ((ret = avformat_alloc_output_context2(&oc, NULL, format, filename)) < 0)
+        goto end;
+    if (!(last_dts = av_malloc_array(ic->nb_streams, sizeof(*last_dts)))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    av_dict_copy(&oc->metadata, ic->metadata, 0);
+    for (i = 0; i < ic->nb_streams; i++) {
+        AVStream *ist = ic->streams[i];
+        AVStream *ost = avformat_new_stream(oc, NULL);
+        unsigned int tag = ist->codec->codec_tag, codec_tag;
+
+        if (!ost) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if ((ret = avcodec_copy_context(ost->codec, ist->codec)) < 0)
+            goto end;
+        /* keep the input tag only where the output format agrees with it,
+         * as stream copy does */
+        if (oc->oformat->codec_tag &&
+            av_codec_get_id(oc->oformat->codec_tag, tag) != ist->codec->codec_id &&
+            av_codec_get_tag2(oc->oformat->codec_tag, ist->codec->codec_id, &codec_tag))
+            tag = 0;
+        ost->codec->codec_tag   = tag;
+        ost->codec->time_base   = ist->time_base;
+        ost->time_base          = ist->time_base;
+        ost->sample_aspect_ratio = ist->sample_aspect_ratio;
+        ost->disposition        = ist->disposition;
+        if (oc->oformat->flags & AVFMT_GLOBALHEADER)
+            ost->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+        av_dict_copy(&ost->metadata, ist->metadata, 0);
+        last_dts[i] = AV_NOPTS_VALUE;
+    }
+
+    if (!(oc->oformat->flags & AVFMT_NOFILE) &&
+        (ret = avio_open2(&oc->pb, filename, AVIO_FLAG_WRITE, NULL, NULL)) < 0)
+        goto end;
+    av_dict_copy(&opts, format_opts, 0);
+    ret = avformat_write_header(oc, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        goto end;
+
+    while ((ret = av_read_frame(ic, &pkt)) >= 0) {
+        if (pkt.stream_index >= oc->nb_streams) {
+            av_free_packet(&pkt);
+            continue;
+        }
+        /* the segments are cut at the video keyframes, the other streams
+         * can overlap by a few packets at the seams */
+        if (pkt.dts != AV_NOPTS_VALUE) {
+            if (last_dts[pkt.stream_index] != AV_NOPTS_VALUE &&
+                pkt.dts <= last_dts[pkt.stream_index]) {
+                av_free_packet(&pkt);
+                continue;
+            }
+            last_dts[pkt.stream_index] = pkt.dts;
+        }
+        av_packet_rescale_ts(&pkt, ic->streams[pkt.stream_index]->time_base,
+                             oc->streams[pkt.stream_index]->time_base);
+        pkt.pos = -1;
+        if ((ret = av_interleaved_write_frame(oc, &pkt)) < 0)
+            break;
+    }
+    if (ret == AVERROR_EOF)
+        ret = av_write_trailer(oc);
+
+end:
+    if (oc && !(oc->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&oc->pb);
+    avformat_free_context(oc);
+    avformat_close_input(&ic);
+    av_free(last_dts);
+    return ret;
+}
+
+/* how much later the video of an encoded segment starts than the segment
+ * itself, which the concat demuxer starts at the previous one's end */
+static int segments_video_delay(const char *filename, int64_t *delay)
+{
+    AVFormatContext *ic = NULL;
+    int64_t start;
+    int ret;
+
+    *delay = 0;
+    if ((ret = avformat_open_input(&ic, filename, NULL, NULL)) < 0)
+        return ret;
+    if ((ret = avformat_find_stream_info(ic, NULL)) < 0)
+        goto end;
+    ret = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (ret < 0) {
+        ret = 0;
+        goto end;
+    }
+    start = segments_stream_start(ic, ret);
+    if (start != AV_NOPTS_VALUE)
+        *delay = start - (ic->start_time != AV_NOPTS_VALUE ? ic->start_time : 0);
+    ret = 0;
+
+end:
+    avformat_close_input(&ic);
+    return ret;
+}
+
+static const char *segments_group_opt(OptionGroup *g, const char *name)
+{
+    int i;
+    for (i = 0; i < g->nb_opts; i++)
+        if (!strcmp(g->opts[i].key, name))
+            return g->opts[i].val;
+    return NULL;
+}
+
+/* the thread count of one of nb_segments concurrent encoders, out of
+ * threads for a single encode, 0 meaning one per cpu */
+static char *segments_threads_str(const char *threads, int nb_segments)
+{
+    int n = threads ? atoi(threads) : 0;
+
+    if (n <= 0)
+        n = av_cpu_count();
+    return av_asprintf("%d", FFMAX(n / nb_segments, 1));
+}
+
+/* a time in seconds as accepted by -ss, -t and the concat duration */
+static char *segments_time_str(int64_t t)
+{
+    return av_asprintf("%"PRId64".%06d", t / AV_TIME_BASE, (int)(t % AV_TIME_BASE));
+}
+
+int nl_parallel_segments(OptionGroupList *inputs, OptionGroupList *outputs,
+                         int argc, char **argv, int nb_segments)
+{
+#if HAVE_FORK
+    static const char * const time_opts[] = { "ss", "t", "to", "sseof" };
+    OptionGroup *input, *output;
+    const char *reason = NULL, *ext, *slash, *fmt_name;
+    AVInputFormat *fmt = NULL;
+    int64_t *starts = NULL, *seeks = NULL, *offsets = NULL;
+    const char **child_argv = NULL;
+    char **names = NULL, **threads = NULL, *list = NULL;
+    pid_t *pids = NULL;
+    int i, j, k, n, ret = 0, out_index = -1, in_index = -1, failed = 0, owned = 0;
+    int in_threads = 0, out_threads = 0;
+    int64_t start_time = av_gettime();
+    AVIOContext *pb = NULL;
+
+    if (inputs->nb_groups != 1 || outputs->nb_groups != 1) {
+        reason = "exactly one input and one output are needed";
+        goto unsupported;
+    }
+    input  = &inputs->groups[0];
+    output = &outputs->groups[0];
+    for (i = 0; i < FF_ARRAY_ELEMS(time_opts); i++)
+        if (segments_group_opt(input, time_opts[i]) ||
+            segments_group_opt(output, time_opts[i])) {
+            reason = "-ss, -t and -to can't be combined with it";
+            goto unsupported;
+        }
+    /* scanning a pipe would eat the input of the normal run */
+    fmt_name = avio_find_protocol_name(input->arg);
+    if (!fmt_name || !strcmp(fmt_name, "pipe")) {
+        reason = "the input is not seekable";
+        goto unsupported;
+    }
+    fmt_name = avio_find_protocol_name(output->arg);
+    if (!fmt_name || strcmp(fmt_name, "file") || !strcmp(output->arg, "-")) {
+        reason = "the output must be a file";
+        goto unsupported;
+    }
+    /* the output file name as it appears on the command line */
+    for (i = argc - 1; i > 0 && out_index < 0; i--)
+        if (!strcmp(argv[i], output->arg) && strcmp(argv[i - 1], "-i"))
+            out_index = i;
+    for (i = 1; i < out_index && in_index < 0; i++)
+        if (!strcmp(argv[i - 1], "-i") && !strcmp(argv[i], input->arg))
+            in_index = i - 1;
+    if (out_index < 0 || in_index < 0) {
+        reason = "the input or output file name was not found";
+        goto unsupported;
+    }
+
+    if ((fmt_name = segments_group_opt(input, "f")) &&
+        !(fmt = av_find_input_format(fmt_name))) {
+        reason = "unknown input format";
+        goto unsupported;
+    }
+    starts = av_malloc_array(nb_segments, sizeof(*starts));
+    seeks  = av_malloc_array(nb_segments, sizeof(*seeks));
+    if (!starts || !seeks) {
+        av_free(starts);
+        av_free(seeks);
+        return AVERROR(ENOMEM);
+    }
+    n = segments_split(input->arg, fmt, input->format_opts, nb_segments, starts, seeks);
+    if (n < 2) {
+        reason = n == AVERROR(ENOSYS) ? "the input is not seekable or has no duration" :
+                 n < 0                ? "the input could not be scanned" :
+                                        "no keyframes to split at";
+        goto unsupported;
+    }
+
+    /* the segments are written next to the output, with the same extension */
+    slash = strrchr(output->arg, '/');
+    ext   = strrchr(slash ? slash : output->arg, '.');
+    if (!ext)
+        ext = output->arg + strlen(output->arg);
+    names      = av_mallocz_array(n, sizeof(*names));
+    pids       = av_mallocz_array(n, sizeof(*pids));
+    offsets    = av_malloc_array(n, sizeof(*offsets));
+    threads    = av_mallocz_array(argc + 1, sizeof(*threads));
+    child_argv = av_mallocz_array(argc + 16, sizeof(*child_argv));
+    list       = av_asprintf("%s.%d.ffconcat", output->arg, (int)getpid());
+    if (!names || !pids || !offsets || !threads || !child_argv || !list) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    /* the segments share the threads of a single encode, given to the
+     * decoders before -i and to the encoders before the output, or one per
+     * cpu when not set */
+    for (i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-threads") && !av_strstart(argv[i], "-threads:", NULL))
+            continue;
+        if (!(threads[i + 1] = segments_threads_str(argv[i + 1], n))) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if (i < in_index)
+            in_threads = 1;
+        else if (i < out_index)
+            out_threads = 1;
+    }
+    if (!(threads[argc] = segments_threads_str(NULL, n))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    /* the temporary files are named after the output and this process, and
+     * files that already exist are never overwritten or removed */
+    for (k = 0; k < n; k++)
+        if (!(names[k] = av_asprintf("%.*s.%d.seg%03d%s", (int)(ext - output->arg),
+                                     output->arg, (int)getpid(), k, ext))) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    for (k = 0; k <= n; k++) {
+        const char *name = k < n ? names[k] : list;
+        if (avio_check(name, 0) >= 0) {
+            av_log(NULL, AV_LOG_ERROR, "Temporary file %s already exists\n", name);
+            ret = AVERROR(EEXIST);
+            goto end;
+        }
+    }
+    owned = 1;
+
+    av_log(NULL, AV_LOG_INFO, "Encoding %s in %d segments\n", input->arg, n);
+
+    for (k = 0; k < n; k++) {
+        /* -t trims from the first decoded frame, the segment keyframe */
+        char *ss = segments_time_str(seeks[k]);
+        char *t  = k < n - 1 ? segments_time_str(starts[k + 1] - starts[k]) : NULL;
+
+        if (!ss || (k < n - 1 && !t)) {
+            av_free(ss);
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        av_log(NULL, AV_LOG_VERBOSE, "Segment %d starts at %0.3fs, seeking to %0.3fs\n",
+               k, starts[k] / 1000000.0, seeks[k] / 1000000.0);
+        /* same command line, quiet, with the input limited to the segment
+         * and the segment file as output */
+        j = 0;
+        child_argv[j++] = program_path ? program_path : argv[0];
+        child_argv[j++] = "-nostdin";
+        child_argv[j++] = "-nostats";
+        child_argv[j++] = "-loglevel";
+        child_argv[j++] = "error";
+        child_argv[j++] = "-n";
+        for (i = 1; i < argc; i++) {
+            if (!strcmp(argv[i], "-parallel_segments")) {
+                i++;
+                continue;
+            }
+            /* -y would conflict with the -n above */
+            if (!strcmp(argv[i], "-y") || !strcmp(argv[i], "-n"))
+                continue;
+            if (i == in_index) {
+                if (!in_threads) {
+                    child_argv[j++] = "-threads";
+                    child_argv[j++] = threads[argc];
+                }
+                /* the first segment starts like a single encode would, with
+                 * the frames before the first keyframe */
+                if (k) {
+                    child_argv[j++] = "-ss";
+                    child_argv[j++] = ss;
+                }
+                if (t) {
+                    child_argv[j++] = "-t";
+                    child_argv[j++] = t;
+                }
+            }
+            if (i == out_index && !out_threads) {
+                child_argv[j++] = "-threads";
+                child_argv[j++] = threads[argc];
+            }
+            child_argv[j++] = i == out_index ? names[k] :
+                              threads[i]     ? threads[i] : argv[i];
+        }
+        child_argv[j] = NULL;
+
+        pids[k] = fork();
+        if (!pids[k]) {
+            /* in child */
+            if (!freopen("/dev/null", "w", stdout))
+                av_log(NULL, AV_LOG_WARNING, "failed to redirect stdout to /dev/null\n");
+            execvp(child_argv[0], (char * const *)child_argv);
+            _exit(1);
+        }
+        av_free(ss);
+        av_free(t);
+        if (pids[k] < 0) {
+            av_log(NULL, AV_LOG_ERROR, "Unable to start the encoder of segment %d\n", k);
+            ret = AVERROR(errno);
+            pids[k] = 0;
+            break;
+        }
+    }
+
+    for (k = 0; k < n; k++) {
+        int status;
+        if (!pids[k])
+            continue;
+        if (waitpid(pids[k], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+            av_log(NULL, AV_LOG_ERROR, "Segment %d of %s failed\n", k, input->arg);
+            failed = 1;
+        } else {
+            av_log(NULL, AV_LOG_INFO, "Segment %d/%d encoded after %0.2fs\n",
+                   k + 1, n, (av_gettime() - start_time) / 1000000.0);
+        }
+    }
+    if (ret < 0)
+        goto end;
+    if (failed) {
+        ret = AVERROR_EXTERNAL;
+        goto end;
+    }
+
+    /* each segment starts where the previous one ends in the concat
+     * demuxer, so that its video lands where it was in the input */
+    for (k = 0; k < n; k++) {
+        int64_t delay;
+        if ((ret = segments_video_delay(names[k], &delay)) < 0)
+            goto end;
+        offsets[k] = starts[k] - starts[0] - delay;
+    }
+
+    /* the segments are in the same directory as the list */
+    if ((ret = avio_open2(&pb, list, AVIO_FLAG_WRITE, NULL, NULL)) < 0)
+        goto end;
+    avio_printf(pb, "ffconcat version 1.0\n");
+    for (k = 0; k < n; k++) {
+        const char *name = names[k] + (slash ? slash + 1 - output->arg : 0);
+        avio_printf(pb, "file '");
+        for (; *name; name++) {
+            if (*name == '\'')
+                avio_printf(pb, "'\\''");
+            else
+                avio_w8(pb, *name);
+        }
+        avio_printf(pb, "'\n");
+        /* the distance between the segments rather than their length, so
+         * the timestamps line up at the seams whatever the audio padding */
+        if (k < n - 1) {
+            char *t = segments_time_str(offsets[k + 1] - offsets[k]);
+            if (!t) {
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+            avio_printf(pb, "duration %s\n", t);
+            av_free(t);
+        }
+    }
+    avio_closep(&pb);
+    if (ret < 0)
+        goto end;
+
+    ret = segments_concat(list, output->arg, segments_group_opt(output, "f"),
+                          output->format_opts);
+    if (ret >= 0)
+        av_log(NULL, AV_LOG_INFO, "%s written from %d segments in %0.2fs\n",
+               output->arg, n, (av_gettime() - start_time) / 1000000.0);
+
+end:
+    for (k = 0; names && k < n; k++) {
+        if (owned && names[k])
+            unlink(names[k]);
+        av_free(names[k]);
+    }
+    if (owned)
+        unlink(list);
+    av_free(list);
+    for (i = 0; threads && i <= argc; i++)
+        av_free(threads[i]);
+    av_free(names);
+    av_free(threads);
+    av_free(pids);
+    av_free(offsets);
+    av_free(child_argv);
+    av_free(starts);
+    av_free(seeks);
+    return ret;
+
+unsupported:
+    av_free(starts);
+    av_free(seeks);
+#else
+    const char *reason = "processes can't be started on this platform";
+#endif
+    av_log(NULL, AV_LOG_WARNING, "Parallel segment encoding disabled: %s\n", reason);
+    return AVERROR(ENOSYS);
+}
+
+/****************************************************************/
+/* nlpktqueue                                                   */
+/****************************************************************/
+#if HAVE_PTHREADS
+#define PKTQUEUE_MAX_WAKE_BATCH 16 /* packets or free slots before waking the other side */
+
+/* the positions run over twice the size, so that a full ring can be told
+ * from an empty one */
+typedef struct NLPacketRing {
+    AVPacket *pkts;
+    int size;
+    volatile int head;                    /* written by the sender */
+    volatile int tail;                    /* written by the receiver */
+    struct NLPacketRing * volatile next;  /* the bigger ring the sender moved to */
+} NLPacketRing;
+
+struct NLPacketQueue {
+    NLPacketRing *send_ring;
+    NLPacketRing *recv_ring;
+    int max_size;
+    int wake_batch;
+    volatile int err_send;
+    volatile int err_recv;
+    volatile int send_waiting;
+    volatile int recv_waiting;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    /* sender counters */
+    int size, max_fill, nb_packets, nb_send_waits, nb_grows, nb_send_wakeups;
+    /* receiver counters */
+    int nb_recv_waits, nb_recv_wakeups;
+};
+
+static NLPacketRing *pktqueue_ring_alloc(int size)
+{
+    NLPacketRing *ring = av_mallocz(sizeof(*ring));
+    int n = 1;
+
+    while (n < size)
+        n <<= 1;
+    if (!ring || !(ring->pkts = av_malloc_array(n, sizeof(*ring->pkts)))) {
+        av_free(ring);
+        return NULL;
+    }
+    ring->size = n;
+    return ring;
+}
+
+static void pktqueue_ring_free(NLPacketRing *ring)
+{
+    int tail;
+
+    for (tail = ring->tail; tail != ring->head; tail = (tail + 1) & (2 * ring->size - 1))
+        av_free_packet(&ring->pkts[tail & (ring->size - 1)]);
+    av_free(ring->pkts);
+    av_free(ring);
+}
+
+static int pktqueue_ring_fill(NLPacketRing *ring)
+{
+    return (avpriv_atomic_int_get(&ring->head) - avpriv_atomic_int_get(&ring->tail)) &
+           (2 * ring->size - 1);
+}
+
+static NLPacketRing *pktqueue_ring_next(NLPacketRing *ring)
+{
+    return avpriv_atomic_ptr_cas((void * volatile *)&ring->next, NULL, NULL);
+}
+
+/* the flag is cleared here so a side is only woken once per sleep */
+static void pktqueue_wake(NLPacketQueue *q, volatile int *waiting, int *nb_wakeups)
+{
+    pthread_mutex_lock(&q->lock);
+    if (*waiting) {
+        avpriv_atomic_int_set(waiting, 0);
+        pthread_cond_broadcast(&q->cond);
+        (*nb_wakeups)++;
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+int nl_pktqueue_alloc(NLPacketQueue **pq, int size, int max_size)
+{
+    NLPacketQueue *q;
+    int ret;
+
+    if (size <= 0 || size > INT_MAX / 4 || max_size > INT_MAX / 4)
+        return AVERROR(EINVAL);
+    if (!(q = av_mallocz(sizeof(*q))))
+        return AVERROR(ENOMEM);
+    if (!(q->send_ring = q->recv_ring = pktqueue_ring_alloc(size))) {
+        av_free(q);
+        return AVERROR(ENOMEM);
+    }
+    if ((ret = pthread_mutex_init(&q->lock, NULL))) {
+        pktqueue_ring_free(q->recv_ring);
+        av_free(q);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&q->cond, NULL))) {
+        pthread_mutex_destroy(&q->lock);
+        pktqueue_ring_free(q->recv_ring);
+        av_free(q);
+        return AVERROR(ret);
+    }
+    q->size       = q->send_ring->size;
+    q->max_size   = FFMAX(max_size, q->size);
+    q->wake_batch = av_clip(q->size / 2, 1, PKTQUEUE_MAX_WAKE_BATCH);
+    *pq = q;
+    return 0;
+}
+
+void nl_pktqueue_free(NLPacketQueue **pq)
+{
+    NLPacketQueue *q = *pq;
+    NLPacketRing *ring, *next;
+
+    if (!q)
+        return;
+    for (ring = q->recv_ring; ring; ring = next) {
+        next = ring->next;
+        pktqueue_ring_free(ring);
+    }
+    pthread_cond_destroy(&q->cond);
+    pthread_mutex_destroy(&q->lock);
+    av_freep(pq);
+}
+
+int nl_pktqueue_send(NLPacketQueue *q, AVPacket *pkt, unsigned flags)
+{
+    NLPacketRing *ring = q->send_ring;
+    int fill;
+
+    while (1) {
+        int err = avpriv_atomic_int_get(&q->err_send);
+        if (err)
+            return err;
+        if ((fill = pktqueue_ring_fill(ring)) < ring->size)
+            break;
+
+        if (flags & AV_THREAD_MESSAGE_NONBLOCK) {
+            NLPacketRing *bigger;
+            if (ring->size >= q->max_size)
+                return AVERROR(EAGAIN);
+            if (!(bigger = pktqueue_ring_alloc(FFMIN(2 * ring->size, q->max_size))))
+                return AVERROR(ENOMEM);
+            /* the receiver moves on once it has emptied the full ring */
+            avpriv_atomic_ptr_cas((void * volatile *)&ring->next, NULL, bigger);
+            q->send_ring = ring = bigger;
+            q->size      = ring->size;
+            q->nb_grows++;
+            continue;
+        }
+
+        pthread_mutex_lock(&q->lock);
+        avpriv_atomic_int_set(&q->send_waiting, 1);
+        if (!avpriv_atomic_int_get(&q->err_send) && pktqueue_ring_fill(ring) == ring->size) {
+            q->nb_send_waits++;
+            pthread_cond_wait(&q->cond, &q->lock);
+        }
+        avpriv_atomic_int_set(&q->send_waiting, 0);
+        pthread_mutex_unlock(&q->lock);
+    }
+
+    ring->pkts[ring->head & (ring->size - 1)] = *pkt;
+    avpriv_atomic_int_set(&ring->head, (ring->head + 1) & (2 * ring->size - 1));
+
+    q->nb_packets++;
+    q->max_fill = FFMAX(q->max_fill, fill + 1);
+    if (avpriv_atomic_int_get(&q->recv_waiting) && fill + 1 >= q->wake_batch)
+        pktqueue_wake(q, &q->recv_waiting, &q->nb_send_wakeups);
+    return 0;
+}
+
+int nl_pktqueue_recv(NLPacketQueue *q, AVPacket *pkt, unsigned flags)
+{
+    while (1) {
+        NLPacketRing *ring = q->recv_ring, *next;
+        int fill = pktqueue_ring_fill(ring), err;
+
+        if (fill) {
+            *pkt = ring->pkts[ring->tail & (ring->size - 1)];
+            avpriv_atomic_int_set(&ring->tail, (ring->tail + 1) & (2 * ring->size - 1));
+            if (avpriv_atomic_int_get(&q->send_waiting) &&
+                ring->size - fill + 1 >= q->wake_batch)
+                pktqueue_wake(q, &q->send_waiting, &q->nb_recv_wakeups);
+            return 0;
+        }
+        /* the sender doesn't write to a ring any more once it has a next
+         * one, so an empty ring with a next one is done with */
+        if ((next = pktqueue_ring_next(ring))) {
+            if (!pktqueue_ring_fill(ring)) {
+                q->recv_ring = next;
+                pktqueue_ring_free(ring);
+            }
+            continue;
+        }
+        if ((err = avpriv_atomic_int_get(&q->err_recv))) {
+            /* packets sent before the error was set come first */
+            if (pktqueue_ring_fill(ring) || pktqueue_ring_next(ring))
+                continue;
+            return err;
+        }
+        if (flags & AV_THREAD_MESSAGE_NONBLOCK)
+            return AVERROR(EAGAIN);
+
+        pthread_mutex_lock(&q->lock);
+        avpriv_atomic_int_set(&q->recv_waiting, 1);
+        if (!avpriv_atomic_int_get(&q->err_recv) &&
+            !pktqueue_ring_fill(ring) && !pktqueue_ring_next(ring)) {
+            q->nb_recv_waits++;
+            pthread_cond_wait(&q->cond, &q->lock);
+        }
+        avpriv_atomic_int_set(&q->recv_waiting, 0);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+
+void nl_pktqueue_set_err_send(NLPacketQueue *q, int err)
+{
+    avpriv_atomic_int_set(&q->err_send, err);
+    pktqueue_wake(q, &q->send_waiting, &q->nb_recv_wakeups);
+}
+
+void nl_pktqueue_set_err_recv(NLPacketQueue *q, int err)
+{
+    avpriv_atomic_int_set(&q->err_recv, err);
+    pktqueue_wake(q, &q->recv_waiting, &q->nb_send_wakeups);
+}
+
+void nl_pktqueue_get_stats(NLPacketQueue *q, NLPacketQueueStats *stats)
+{
+    stats->size          = q->size;
+    stats->max_fill      = q->max_fill;
+    stats->nb_packets    = q->nb_packets;
+    stats->nb_wakeups    = q->nb_send_wakeups + q->nb_recv_wakeups;
+    stats->nb_send_waits = q->nb_send_waits;
+    stats->nb_recv_waits = q->nb_recv_waits;
+    stats->nb_grows      = q->nb_grows;
+}
+#endif /* HAVE_PTHREADS */
+
+
+
+/****************************************************************/
+/* nlmuxthread                                                  */
+/****************************************************************/
+struct NLMuxThread {
+#if HAVE_PTHREADS
+    pthread_t thread;
+    NLPacketQueue *queue;
+    AVFormatContext *ctx;
+    int error;
+
+    /* the field order of the video frames, set on the muxer by the thread
+     * before writing the packets encoded from them, as do_video_out() does
+     * when muxing synchronously */
+    enum AVFieldOrder *field_order;         /* of the next packet of each stream */
+    enum AVFieldOrder *queued_field_order;  /* of each queued packet */
+    int nb_queued_field_order;  /* the queue plus the packet being taken */
+    int send_index, recv_index;
+
+    /* the dts of the last packet sent of each stream, the st->cur_dts the
+     * muxer would have when muxing synchronously. kept by the main thread,
+     * which chooses the stream to encode next from it */
+    int64_t *cur_dts;
+
+    /* published by the thread for the progress reports */
+    pthread_mutex_t lock;
+    int64_t size;
+    int64_t *end_pts;
+    int64_t *nb_frames;
+#endif
+};
+
+#if HAVE_PTHREADS
+static void mux_thread_publish(NLMuxThread *mt)
+{
+    int i;
+
+    pthread_mutex_lock(&mt->lock);
+    if (mt->ctx->pb)
+        mt->size = avio_tell(mt->ctx->pb);
+    for (i = 0; i < mt->ctx->nb_streams; i++) {
+        mt->end_pts[i]   = av_stream_get_end_pts(mt->ctx->streams[i]);
+        mt->nb_frames[i] = mt->ctx->streams[i]->nb_frames;
+    }
+    pthread_mutex_unlock(&mt->lock);
+}
+
+static void *mux_thread(void *arg)
+{
+    NLMuxThread *mt = arg;
+    AVPacket pkt;
+    int ret;
+
+    while (nl_pktqueue_recv(mt->queue, &pkt, 0) >= 0) {
+        mt->ctx->streams[pkt.stream_index]->codec->field_order =
+            mt->queued_field_order[mt->recv_index];
+        mt->recv_index = (mt->recv_index + 1) % mt->nb_queued_field_order;
+        ret = av_interleaved_write_frame(mt->ctx, &pkt);
+        av_free_packet(&pkt);
+        if (ret < 0) {
+            print_error("av_interleaved_write_frame()", ret);
+            mt->error = ret;
+            nl_pktqueue_set_err_send(mt->queue, ret);
+            break;
+        }
+        mux_thread_publish(mt);
+    }
+    return NULL;
+}
+
+static void mux_thread_free(NLMuxThread **pmt)
+{
+    NLMuxThread *mt = *pmt;
+
+    nl_pktqueue_free(&mt->queue);
+    pthread_mutex_destroy(&mt->lock);
+    av_free(mt->field_order);
+    av_free(mt->queued_field_order);
+    av_free(mt->cur_dts);
+    av_free(mt->end_pts);
+    av_free(mt->nb_frames);
+    av_freep(pmt);
+}
+
+int nl_mux_thread_start(OutputFile *of, int queue_size)
+{
+    AVFormatContext *s = of->ctx;
+    NLMuxThread *mt;
+    NLPacketQueueStats stats;
+    int i, ret;
+
+    /* raw pictures are sent as AVPicture structures pointing to the frames
+     * of the main thread */
+    if (s->oformat->flags & AVFMT_RAWPICTURE)
+        for (i = 0; i < s->nb_streams; i++)
+            if (s->streams[i]->codec->codec_id == AV_CODEC_ID_RAWVIDEO) {
+                av_log(s, AV_LOG_VERBOSE, "Raw pictures are muxed synchronously\n");
+                return 0;
+            }
+    /* packets without timestamps get them from the muxer, so the dts the
+     * output streams are interleaved on is only known once muxed */
+    if (s->oformat->flags & AVFMT_NOTIMESTAMPS ||
+        video_sync_method == VSYNC_DROP || audio_sync_method < 0) {
+        av_log(s, AV_LOG_VERBOSE, "Packets without timestamps are muxed synchronously\n");
+        return 0;
+    }
+
+    if (!(mt = av_mallocz(sizeof(*mt))))
+        return AVERROR(ENOMEM);
+    if ((ret = pthread_mutex_init(&mt->lock, NULL))) {
+        av_free(mt);
+        return AVERROR(ret);
+    }
+    mt->ctx = s;
+    if ((ret = nl_pktqueue_alloc(&mt->queue, queue_size, queue_size)) < 0) {
+        mux_thread_free(&mt);
+        return ret;
+    }
+    nl_pktqueue_get_stats(mt->queue, &stats);
+    mt->nb_queued_field_order = stats.size + 2;
+    mt->field_order        = av_malloc_array(s->nb_streams, sizeof(*mt->field_order));
+    mt->queued_field_order = av_malloc_array(mt->nb_queued_field_order,
+                                             sizeof(*mt->queued_field_order));
+    mt->cur_dts            = av_malloc_array(s->nb_streams, sizeof(*mt->cur_dts));
+    mt->end_pts            = av_malloc_array(s->nb_streams, sizeof(*mt->end_pts));
+    mt->nb_frames          = av_malloc_array(s->nb_streams, sizeof(*mt->nb_frames));
+    if (!mt->field_order || !mt->queued_field_order || !mt->cur_dts ||
+        !mt->end_pts || !mt->nb_frames) {
+        mux_thread_free(&mt);
+        return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < s->nb_streams; i++) {
+        mt->field_order[i] = s->streams[i]->codec->field_order;
+        mt->cur_dts[i]     = s->streams[i]->cur_dts;
+    }
+    mux_thread_publish(mt);
+
+    if ((ret = pthread_create(&mt->thread, NULL, mux_thread, mt))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+        mux_thread_free(&mt);
+        return AVERROR(ret);
+    }
+    of->mux_thread = mt;
+    return 0;
+}
+
+int nl_mux_thread_write(OutputFile *of, AVPacket *pkt)
+{
+    NLMuxThread *mt = of->mux_thread;
+    int stream_index = pkt->stream_index;
+    int64_t dts = pkt->dts;
+    int ret;
+
+    /* the thread reads the field order of a packet after taking it from the
+     * queue, so the slots of the queued packets and of the one being taken
+     * are in use */
+    mt->queued_field_order[mt->send_index] = mt->field_order[pkt->stream_index];
+    if ((ret = av_dup_packet(pkt)) < 0 ||
+        (ret = nl_pktqueue_send(mt->queue, pkt, 0)) < 0) {
+        av_free_packet(pkt);
+        return ret;
+    }
+    mt->send_index = (mt->send_index + 1) % mt->nb_queued_field_order;
+    if (dts != AV_NOPTS_VALUE)
+        mt->cur_dts[stream_index] = dts;
+    return 0;
+}
+
+void nl_mux_thread_set_field_order(OutputFile *of, int stream_index,
+                                   enum AVFieldOrder field_order)
+{
+    of->mux_thread->field_order[stream_index] = field_order;
+}
+
+int nl_mux_thread_stop(OutputFile *of)
+{
+    NLMuxThread *mt = of->mux_thread;
+    NLPacketQueueStats stats;
+    int ret;
+
+    if (!mt)
+        return 0;
+    nl_pktqueue_set_err_recv(mt->queue, AVERROR_EOF);
+    pthread_join(mt->thread, NULL);
+
+    nl_pktqueue_get_stats(mt->queue, &stats);
+    av_log(of->ctx, AV_LOG_VERBOSE, "Muxing thread: %d packets, "
+           "waited %d times for room in a queue of %d\n",
+           stats.nb_packets, stats.nb_send_waits, stats.size);
+    ret = mt->error;
+    mux_thread_free(&of->mux_thread);
+    return ret;
+}
+
+int64_t nl_mux_thread_size(OutputFile *of)
+{
+    NLMuxThread *mt = of->mux_thread;
+    int64_t size;
+
+    pthread_mutex_lock(&mt->lock);
+    size = mt->size;
+    pthread_mutex_unlock(&mt->lock);
+    return size;
+}
+
+int64_t nl_mux_end_pts(OutputFile *of, int stream_index)
+{
+    NLMuxThread *mt = of->mux_thread;
+    int64_t pts;
+
+    if (!mt)
+        return av_stream_get_end_pts(of->ctx->streams[stream_index]);
+    pthread_mutex_lock(&mt->lock);
+    pts = mt->end_pts[stream_index];
+    pthread_mutex_unlock(&mt->lock);
+    return pts;
+}
+
+int64_t nl_mux_cur_dts(OutputFile *of, int stream_index)
+{
+    NLMuxThread *mt = of->mux_thread;
+
+    return mt ? mt->cur_dts[stream_index] : of->ctx->streams[stream_index]->cur_dts;
+}
+
+int64_t nl_mux_nb_frames(OutputFile *of, int stream_index)
+{
+    NLMuxThread *mt = of->mux_thread;
+    int64_t nb_frames;
+
+    if (!mt)
+        return of->ctx->streams[stream_index]->nb_frames;
+    pthread_mutex_lock(&mt->lock);
+    nb_frames = mt->nb_frames[stream_index];
+    pthread_mutex_unlock(&mt->lock);
+    return nb_frames;
+}
+#else
+int nl_mux_thread_start(OutputFile *of, int queue_size)
+{
+    return AVERROR(ENOSYS);
+}
+
+int nl_mux_thread_write(OutputFile *of, AVPacket *pkt)
+{
+    av_free_packet(pkt);
+    return AVERROR(ENOSYS);
+}
+
+void nl_mux_thread_set_field_order(OutputFile *of, int stream_index,
+                                   enum AVFieldOrder field_order)
+{
+}
+
+int nl_mux_thread_stop(OutputFile *of)
+{
+    return 0;
+}
+
+int64_t nl_mux_thread_size(OutputFile *of)
+{
+    return 0;
+}
+
+int64_t nl_mux_end_pts(OutputFile *of, int stream_index)
+{
+    return av_stream_get_end_pts(of->ctx->streams[stream_index]);
+}
+
+int64_t nl_mux_cur_dts(OutputFile *of, int stream_index)
+{
+    return of->ctx->streams[stream_index]->cur_dts;
+}
+
+int64_t nl_mux_nb_frames(OutputFile *of, int stream_index)
+{
+    return of->ctx->streams[stream_index]->nb_frames;
+}
+#endif /* HAVE_PTHREADS */
+
+
+
 /****************************************************************/
 /* nlreport                                                     */
 /****************************************************************/
@@ -995,11 +2392,15 @@ void print_nlreport( OutputFile **output_files,
 
     oc = output_files[0]->ctx;
 
-    total_size = avio_size(oc->pb);
-    if (total_size < 0) { // FIXME improve avio_size() so it works with non seekable output too
-        total_size= avio_tell(oc->pb);
-        if (total_size < 0)
-            total_size = 0;
+    if (output_files[0]->mux_thread) {
+        total_size = nl_mux_thread_size(output_files[0]);
+    } else {
+        total_size = avio_size(oc->pb);
+        if (total_size < 0) { // FIXME improve avio_size() so it works with non seekable output too
+            total_size= avio_tell(oc->pb);
+            if (total_size < 0)
+                total_size = 0;
+        }
     }
 
     //buf[0] = '\0';
@@ -1032,7 +2433,8 @@ void print_nlreport( OutputFile **output_files,
             vid = 1;
         }
         /* compute min output value */
-        pts = (double)ost->st->pts.val * av_q2d(ost->st->time_base);
+        pts = (double)nl_mux_end_pts(output_files[ost->file_index], ost->index) *
+              av_q2d(ost->st->time_base);
         if ((pts < ti1) && (pts > 0))
             ti1 = pts;
     }
@@ -1053,6 +2455,26 @@ void print_nlreport( OutputFile **output_files,
         FFMSG_LOG( FFMSG_INT32_FMT(is_last_report), is_last_report );
         FFMSG_LOG( FFMSG_INT32_FMT(curtime), (int)(ti1*1000.0) );
 
+#if HAVE_PTHREADS
+        /* queues of the input threads */
+        for (i = 0; i < nb_input_files; i++) {
+            NLPacketQueueStats stats;
+
+            if (!input_files[i]->in_pkt_queue)
+                continue;
+            nl_pktqueue_get_stats(input_files[i]->in_pkt_queue, &stats);
+            FFMSG_LOG( FFMSG_NODE_START_FMT("input_queue_%d"), i );
+            FFMSG_LOG( FFMSG_INT32_FMT(size), stats.size );
+            FFMSG_LOG( FFMSG_INT32_FMT(max_fill), stats.max_fill );
+            FFMSG_LOG( FFMSG_INT32_FMT(packets), stats.nb_packets );
+            FFMSG_LOG( FFMSG_INT32_FMT(wakeups), stats.nb_wakeups );
+            FFMSG_LOG( FFMSG_INT32_FMT(send_waits), stats.nb_send_waits );
+            FFMSG_LOG( FFMSG_INT32_FMT(recv_waits), stats.nb_recv_waits );
+            FFMSG_LOG( FFMSG_INT32_FMT(grows), stats.nb_grows );
+            FFMSG_LOG( FFMSG_NODE_STOP_FMT("input_queue_%d"), i );
+        }
+#endif
+
 //        if (nb_frames_dup || nb_frames_drop)
 //          snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), " dup=%d drop=%d",
 //                  nb_frames_dup, nb_frames_drop);